@@ -635,6 +635,14 @@ agnes_color_t agnes_get_screen_pixel(const agnes_t *agnes, int x, int y) {
     return g_colors[color_ix & 0x3f];
 }
 
+const uint8_t *agnes_get_screen_buffer(const agnes_t *agnes) {
+    return agnes->ppu.screen_buffer;
+}
+
+agnes_color_t agnes_get_palette_color(uint8_t color_ix) {
+    return g_colors[color_ix & 0x3f];
+}
+
 void agnes_destroy(agnes_t *agnes) {
     free(agnes);
 }
@@ -80,6 +80,8 @@ bool agnes_tick(agnes_t *agnes, bool *out_new_frame);
 bool agnes_next_frame(agnes_t *agnes);
 
 agnes_color_t agnes_get_screen_pixel(const agnes_t *agnes, int x, int y);
+const uint8_t *agnes_get_screen_buffer(const agnes_t *agnes);
+agnes_color_t agnes_get_palette_color(uint8_t color_ix);
 
 #ifdef __cplusplus
 }
@@ -19,7 +19,8 @@ const romData = @embedFile("croom.nes");
 const WIDTH = 256;
 const HEIGHT = 240;
 
-var gfxFramebuffer: [WIDTH * HEIGHT]u32 = undefined;
+// NES colour for each screen buffer value, expanded by the host
+var palette: [256]u32 = undefined;
 
 fn consoleWriteFn(data:[]const u8) void {
     _ = console.print("{s}", .{data}) catch 0;
@@ -64,6 +65,9 @@ fn submain() !void {
     // init zepto with a memory allocator and console writer
     zeptolibc.init(uvm.allocator(), consoleWriteFn);
 
+    // poll keys from the host's info page when offered, rather than a syscall each time
+    _ = uvm.mapInfo();
+
     ag = agnes.agnes_make();
     if (agnes.agnes_load_ines_data(ag, @ptrCast(romData), romData.len)) {
         try console.print("load rom ok\n", .{});
@@ -74,6 +78,12 @@ fn submain() !void {
     
     agnes.agnes_set_input(ag, &ag_input, 0);
 
+    // the NES colours never change, so expand them once before the first frame
+    for (&palette, 0..) |*p, i| {
+        const c = agnes.agnes_get_palette_color(@intCast(i));
+        p.* = @as(u32, @intCast(0xFF)) << 24 | @as(u32, @intCast(c.b)) << 16 | @as(u32, @intCast(c.g)) << 8 | @as(u32, @intCast(c.r));
+    }
+
     while(true) {
         var new_frame:bool = false;
         _ = agnes.agnes_tick(ag, &new_frame);
@@ -84,17 +94,7 @@ fn submain() !void {
                 try console.flush();
             }
 
-            var i:usize = 0;
-            for (0..agnes.AGNES_SCREEN_HEIGHT) |y| {
-                for (0..agnes.AGNES_SCREEN_WIDTH) |x| {
-                    const c = agnes.agnes_get_screen_pixel(ag, @intCast(x), @intCast(y));
-                    const c_val = @as(u32, @intCast(0xFF)) << 24 | @as(u32, @intCast(c.b)) << 16 | @as(u32, @intCast(c.g)) << 8 | @as(u32, @intCast(c.r));
-                    gfxFramebuffer[i] = c_val;
-                    i+=1;
-                }
-            }
-
-            uvm.render(@ptrCast(&gfxFramebuffer), WIDTH * HEIGHT * 4);
+            uvm.render8(agnes.agnes_get_screen_buffer(ag), WIDTH * HEIGHT, &palette);
             checkKeys();
         }
     }
@@ -0,0 +1,57 @@
+#ifndef UVM32_CRYPTO_H
+#define UVM32_CRYPTO_H
+// Wrappers for the RISC-V scalar crypto instructions
+// Build with MARCH=rv32im_zkn_zksh, the host must be built with -DUVM32_EXT_ZK
+
+#include "target-stdint.h"
+
+// AES, bs selects which byte of rs2 is used and must be a constant 0-3
+#define aes32esi(rs1, rs2, bs)  ({ uint32_t _rd; asm("aes32esi %0, %1, %2, %3" : "=r"(_rd) : "r"(rs1), "r"(rs2), "i"(bs)); _rd; })
+#define aes32esmi(rs1, rs2, bs) ({ uint32_t _rd; asm("aes32esmi %0, %1, %2, %3" : "=r"(_rd) : "r"(rs1), "r"(rs2), "i"(bs)); _rd; })
+#define aes32dsi(rs1, rs2, bs)  ({ uint32_t _rd; asm("aes32dsi %0, %1, %2, %3" : "=r"(_rd) : "r"(rs1), "r"(rs2), "i"(bs)); _rd; })
+#define aes32dsmi(rs1, rs2, bs) ({ uint32_t _rd; asm("aes32dsmi %0, %1, %2, %3" : "=r"(_rd) : "r"(rs1), "r"(rs2), "i"(bs)); _rd; })
+
+#define _UVM32_CRYPTO_UNARY(op) \
+static inline uint32_t op(uint32_t rs1) { \
+    uint32_t rd; \
+    asm(#op " %0, %1" : "=r"(rd) : "r"(rs1)); \
+    return rd; \
+}
+
+#define _UVM32_CRYPTO_BINARY(op) \
+static inline uint32_t op(uint32_t rs1, uint32_t rs2) { \
+    uint32_t rd; \
+    asm(#op " %0, %1, %2" : "=r"(rd) : "r"(rs1), "r"(rs2)); \
+    return rd; \
+}
+
+// SHA-256
+_UVM32_CRYPTO_UNARY(sha256sig0)
+_UVM32_CRYPTO_UNARY(sha256sig1)
+_UVM32_CRYPTO_UNARY(sha256sum0)
+_UVM32_CRYPTO_UNARY(sha256sum1)
+
+// SHA-512, operating on the halves of 64 bit values
+_UVM32_CRYPTO_BINARY(sha512sig0h)
+_UVM32_CRYPTO_BINARY(sha512sig0l)
+_UVM32_CRYPTO_BINARY(sha512sig1h)
+_UVM32_CRYPTO_BINARY(sha512sig1l)
+_UVM32_CRYPTO_BINARY(sha512sum0r)
+_UVM32_CRYPTO_BINARY(sha512sum1r)
+
+// SM3
+_UVM32_CRYPTO_UNARY(sm3p0)
+_UVM32_CRYPTO_UNARY(sm3p1)
+
+// Bit manipulation for cryptography
+_UVM32_CRYPTO_UNARY(brev8)
+_UVM32_CRYPTO_UNARY(zip)
+_UVM32_CRYPTO_UNARY(unzip)
+_UVM32_CRYPTO_BINARY(pack)
+_UVM32_CRYPTO_BINARY(packh)
+_UVM32_CRYPTO_BINARY(clmul)
+_UVM32_CRYPTO_BINARY(clmulh)
+_UVM32_CRYPTO_BINARY(xperm4)
+_UVM32_CRYPTO_BINARY(xperm8)
+
+#endif
@@ -26,18 +26,44 @@ static uint32_t syscall(uint32_t id, uint32_t param1, uint32_t param2) {
     register uint32_t a0 asm("a0") = (uint32_t)(param1);
     register uint32_t a1 asm("a1") = (uint32_t)(param2);
     register uint32_t a2 asm("a2");
-    register uint32_t a7 asm("a7") = (uint32_t)(id);
+#ifdef __riscv_32e
+    register uint32_t nr asm("t0") = (uint32_t)(id);    // RV32E has no a7, host must be built with -DUVM32_RV32E
+#else
+    register uint32_t nr asm("a7") = (uint32_t)(id);
+#endif
 
     asm volatile (
         "ecall"
         : "=r"(a2) // output
-        : "r"(a7), "r"(a0), "r"(a1) // input
+        : "r"(nr), "r"(a0), "r"(a1) // input
+        : "memory"
+    );
+    return a2;
+}
+
+// As syscall(), with a third parameter in a3, read by the host as ARG2
+static uint32_t syscall3(uint32_t id, uint32_t param1, uint32_t param2, uint32_t param3) {
+    register uint32_t a0 asm("a0") = (uint32_t)(param1);
+    register uint32_t a1 asm("a1") = (uint32_t)(param2);
+    register uint32_t a3 asm("a3") = (uint32_t)(param3);
+    register uint32_t a2 asm("a2");
+#ifdef __riscv_32e
+    register uint32_t nr asm("t0") = (uint32_t)(id);
+#else
+    register uint32_t nr asm("a7") = (uint32_t)(id);
+#endif
+
+    asm volatile (
+        "ecall"
+        : "=r"(a2) // output
+        : "r"(nr), "r"(a0), "r"(a1), "r"(a3) // input
         : "memory"
     );
     return a2;
 }
 
 #define syscall_cast(id, p1, p2) syscall((uint32_t)id, (uint32_t)p1, (uint32_t)p2)
+#define syscall3_cast(id, p1, p2, p3) syscall3((uint32_t)id, (uint32_t)p1, (uint32_t)p2, (uint32_t)p3)
 
 #define println(x)      syscall_cast(UVM32_SYSCALL_PRINTLN, x, 0)
 #define print(x)        syscall_cast(UVM32_SYSCALL_PRINT, x, 0)
@@ -49,16 +75,130 @@ static uint32_t syscall(uint32_t id, uint32_t param1, uint32_t param2) {
 #define yield(x)        syscall_cast(UVM32_SYSCALL_YIELD, x, 0)
 #define printbuf(x, y)  syscall_cast(UVM32_SYSCALL_PRINTBUF, x, y)
 #define render(x, y)    syscall_cast(UVM32_SYSCALL_RENDER, x, y)
+#define render8(x, y, pal)  syscall3_cast(UVM32_SYSCALL_RENDER8, x, y, pal)
 #define getkey()        syscall_cast(UVM32_SYSCALL_GETKEY, 0, 0)
 #define rand()          syscall_cast(UVM32_SYSCALL_RAND, 0, 0)
 
+// Read-only asset mapped by the host with uvm32_mapAsset(), asset_len() is 0 when there is none
+#define asset()         ((const uint8_t *)UVM32_ASSET_BASE)
+#define asset_len()     syscall_cast(UVM32_SYSCALL_ASSETLEN, 0, 0)
+
+// Read only files, from directories the host allows, all return 0xFFFFFFFF on failure
+#define file_open(path)             syscall_cast(UVM32_SYSCALL_FOPEN, path, 0)
+#define file_read(h, buf, len)      syscall3_cast(UVM32_SYSCALL_FREAD, h, buf, len)
+#define file_seek(h, off, whence)   syscall3_cast(UVM32_SYSCALL_FSEEK, h, off, whence)
+#define file_size(h)                syscall_cast(UVM32_SYSCALL_FSTAT, h, 0)
+#define file_close(h)               syscall_cast(UVM32_SYSCALL_FCLOSE, h, 0)
+
+// Write back file backed extram, when offered by host
+#define extram_sync()       syscall_cast(UVM32_SYSCALL_SYNC, 0, 0)
+#define extram_checkpoint() syscall_cast(UVM32_SYSCALL_CHECKPOINT, 0, 0)
+
+// Framebuffer mapped by host, write pixels then present() to show only what changed
+#define fb_map(w, h)        ((uint32_t *)syscall_cast(UVM32_SYSCALL_FBMAP, w, h))
+#define present()           syscall_cast(UVM32_SYSCALL_PRESENT, 0, 0)
+
+// 2D blitter, b points to a uvm32_blit_t, returns 0 or 0xFFFFFFFF on failure
+#define blit(b)             syscall_cast(UVM32_SYSCALL_BLIT, b, 0)
+
+// Host interrupts. handler(irqs) is called at a syscall boundary with the mask of interrupts taken,
+// and returns normally, resuming the interrupted code. Registers are saved by the host
+#define irq_handler(h)      syscall_cast(UVM32_SYSCALL_IRQHANDLER, h, 0)
+#define irq_enable(mask)    syscall_cast(UVM32_SYSCALL_IRQENABLE, mask, 0)    // returns previous mask
+
+// Sleep until an interrupt in mask is raised or timeout passes, in host clock units (microseconds in the
+// included hosts), or UVM32_WAIT_FOREVER. Returns the mask of interrupts which ended the wait, 0 on timeout
+#define wait_event(timeout, mask)   syscall_cast(UVM32_SYSCALL_WAIT, timeout, mask)
+
 extern char _estack;
 
 static void stackprotect(void) {
     syscall_cast(UVM32_SYSCALL_STACKPROTECT, &_estack, 0);
 }
 
+// Custom instructions, executed inline by a host handler registered with uvm32_setCustomOp()
+// n selects custom-0..3, funct3 (0-7) and funct7 (0-127) are passed to the handler, all must be constants
+#define _UVM32_CUSTOM_OPCODE(n) ((n) == 0 ? 0x0b : (n) == 1 ? 0x2b : (n) == 2 ? 0x5b : 0x7b)
+#define custom(n, funct3, funct7, rs1, rs2) ({ \
+    uint32_t _rd; \
+    asm volatile (".insn r %1, %2, %3, %0, %4, %5" \
+        : "=r"(_rd) \
+        : "i"(_UVM32_CUSTOM_OPCODE(n)), "i"(funct3), "i"(funct7), "r"((uint32_t)(rs1)), "r"((uint32_t)(rs2)) \
+        : "memory"); \
+    _rd; })
+
+// Counter CSRs, read without a syscall. cycle and instret count instructions retired, time is the host clock
+// Encoded with .insn, as rv32im toolchains may not accept csrr without zicsr
+#define _UVM32_CSR_READ(csr) ({ uint32_t _rd; asm volatile (".insn i 0x73, 2, %0, x0, %1" : "=r"(_rd) : "i"((csr) - 0x1000)); _rd; })
+#define _UVM32_CSR_READ64(csr) ({ \
+    uint32_t _hi, _lo; \
+    do { \
+        _hi = _UVM32_CSR_READ((csr) + 0x80); \
+        _lo = _UVM32_CSR_READ(csr); \
+    } while (_hi != _UVM32_CSR_READ((csr) + 0x80)); \
+    ((uint64_t)_hi << 32) | _lo; })
+
+#define rdcycle()       _UVM32_CSR_READ(0xc00)
+#define rdtime()        _UVM32_CSR_READ(0xc01)
+#define rdinstret()     _UVM32_CSR_READ(0xc02)
+#define rdcycle64()     _UVM32_CSR_READ64(0xc00)
+#define rdtime64()      _UVM32_CSR_READ64(0xc01)
+#define rdinstret64()   _UVM32_CSR_READ64(0xc02)
+
 #include "uvm32_common_custom.h"
 
+// Audio ring mapped by host, 0xFFFFFFFF if it has none. Queue samples with audio_write(), no syscall needed
+#define audio_map()         ((volatile uvm32_audioring_t *)syscall_cast(UVM32_SYSCALL_AUDIOMAP, 0, 0))
+#define audio_level(r)      ((r)->wr - (r)->rd)
+
+// Queue up to n samples, returns the number queued
+static inline uint32_t audio_write(volatile uvm32_audioring_t *r, const int16_t *samples, uint32_t n) {
+    volatile int16_t *ring = (volatile int16_t *)(r + 1);
+    const uint32_t len = r->len;
+    uint32_t wr = r->wr;
+    uint32_t space = len - (wr - r->rd);
+
+    if (n > space) {
+        n = space;
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        ring[wr++ & (len - 1)] = samples[i];
+    }
+    // samples must land before the host sees the new wr
+    asm volatile ("fence rw, w" ::: "memory");
+    r->wr = wr;
+    return n;
+}
+
+// Info page mapped by host, 0xFFFFFFFF if it has none. Key events then arrive here rather than from getkey()
+#define info_map()                  ((const volatile uvm32_info_t *)syscall_cast(UVM32_SYSCALL_INFOMAP, 0, 0))
+#define info_keydown(i, scancode)   (((i)->keys[(scancode) >> 5] >> ((scancode) & 31)) & 1)
+
+// Next key event, as getkey(). *rd is the caller's count of events read, starting at 0
+static inline uint32_t info_getkey(const volatile uvm32_info_t *i, uint32_t *rd) {
+    const uint32_t wr = i->key_wr;
+
+    if (wr - *rd > UVM32_INFO_EVENTS) {
+        // fell behind, skip to the oldest event still held
+        *rd = wr - UVM32_INFO_EVENTS;
+    }
+    if (*rd == wr) {
+        return 0xFFFFFFFF;
+    }
+    return i->key_events[(*rd)++ & (UVM32_INFO_EVENTS - 1)];
+}
+
+// Random word from the info page, *n is the caller's count of words taken, *runs the run they were taken in
+static inline uint32_t info_rand(const volatile uvm32_info_t *i, uint32_t *n, uint32_t *runs) {
+    if (*runs != i->runs) {
+        *runs = i->runs;
+        *n = 0;
+    }
+    if (*n < UVM32_INFO_RAND) {
+        return i->rand[(*n)++];
+    }
+    return rand();
+}
+
 #endif
 
@@ -0,0 +1,199 @@
+#include "uvm32_target.h"
+#include "uvm32_crypto.h"
+
+// SHA-256 and AES-128 using the scalar crypto instructions, checked against
+// the examples from FIPS 180-2 and FIPS 197
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static const uint32_t sha256_init[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+static void sha256_block(uint32_t h[8], const uint8_t *p) {
+    uint32_t w[64];
+    uint32_t s[8];
+
+    for (int i=0;i<16;i++) {
+        w[i] = ((uint32_t)p[i*4] << 24) | ((uint32_t)p[i*4+1] << 16) | ((uint32_t)p[i*4+2] << 8) | p[i*4+3];
+    }
+    for (int i=16;i<64;i++) {
+        w[i] = sha256sig1(w[i-2]) + w[i-7] + sha256sig0(w[i-15]) + w[i-16];
+    }
+    for (int i=0;i<8;i++) {
+        s[i] = h[i];
+    }
+    for (int i=0;i<64;i++) {
+        uint32_t t1 = s[7] + sha256sum1(s[4]) + ((s[4] & s[5]) ^ (~s[4] & s[6])) + sha256_k[i] + w[i];
+        uint32_t t2 = sha256sum0(s[0]) + ((s[0] & s[1]) ^ (s[0] & s[2]) ^ (s[1] & s[2]));
+        for (int j=7;j>0;j--) {
+            s[j] = s[j-1];
+        }
+        s[4] += t1;
+        s[0] = t1 + t2;
+    }
+    for (int i=0;i<8;i++) {
+        h[i] += s[i];
+    }
+}
+
+static void sha256(const uint8_t *msg, uint32_t len, uint32_t h[8]) {
+    uint8_t block[64];
+    uint32_t n = 0;
+
+    for (int i=0;i<8;i++) {
+        h[i] = sha256_init[i];
+    }
+    for (; len - n >= 64; n += 64) {
+        sha256_block(h, msg + n);
+    }
+
+    // pad the remainder with 0x80, zeros, then the length in bits
+    uint32_t rem = len - n;
+    for (uint32_t i=0;i<64;i++) {
+        block[i] = i < rem ? msg[n + i] : (i == rem ? 0x80 : 0);
+    }
+    if (rem >= 56) {
+        sha256_block(h, block);
+        for (int i=0;i<64;i++) {
+            block[i] = 0;
+        }
+    }
+    for (int i=0;i<4;i++) {
+        block[63 - i] = (len << 3) >> (i * 8);
+    }
+    block[59] = len >> 29;
+    sha256_block(h, block);
+}
+
+// AES-128 key schedule, rk holds 11 round keys of 4 words
+static void aes128_key(uint32_t rk[44], const uint32_t key[4]) {
+    static const uint8_t rcon[10] = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36 };
+
+    for (int i=0;i<4;i++) {
+        rk[i] = key[i];
+    }
+    for (int i=4;i<44;i+=4) {
+        // SubWord(RotWord(w))
+        uint32_t w = (rk[i-1] >> 8) | (rk[i-1] << 24);
+        uint32_t t = rcon[i/4 - 1];
+        t = aes32esi(t, w, 0);
+        t = aes32esi(t, w, 1);
+        t = aes32esi(t, w, 2);
+        t = aes32esi(t, w, 3);
+        rk[i] = rk[i-4] ^ t;
+        rk[i+1] = rk[i-3] ^ rk[i];
+        rk[i+2] = rk[i-2] ^ rk[i+1];
+        rk[i+3] = rk[i-1] ^ rk[i+2];
+    }
+}
+
+// Round keys for the equivalent inverse cipher, InvMixColumns applied to the middle rounds
+static void aes128_deckey(uint32_t dk[44], const uint32_t rk[44]) {
+    for (int i=0;i<44;i++) {
+        uint32_t w = rk[i];
+        if (i >= 4 && i < 40) {
+            // SubBytes, then InvSubBytes+InvMixColumns, leaves just InvMixColumns
+            uint32_t t = 0;
+            t = aes32esi(t, w, 0);
+            t = aes32esi(t, w, 1);
+            t = aes32esi(t, w, 2);
+            t = aes32esi(t, w, 3);
+            w = 0;
+            w = aes32dsmi(w, t, 0);
+            w = aes32dsmi(w, t, 1);
+            w = aes32dsmi(w, t, 2);
+            w = aes32dsmi(w, t, 3);
+        }
+        dk[i] = w;
+    }
+}
+
+static void aes128_encrypt(uint32_t out[4], const uint32_t in[4], const uint32_t rk[44]) {
+    uint32_t t0 = in[0] ^ rk[0];
+    uint32_t t1 = in[1] ^ rk[1];
+    uint32_t t2 = in[2] ^ rk[2];
+    uint32_t t3 = in[3] ^ rk[3];
+
+    for (int r=1;r<10;r++) {
+        const uint32_t *k = rk + r * 4;
+        uint32_t u0 = k[0], u1 = k[1], u2 = k[2], u3 = k[3];
+        u0 = aes32esmi(u0, t0, 0); u0 = aes32esmi(u0, t1, 1); u0 = aes32esmi(u0, t2, 2); u0 = aes32esmi(u0, t3, 3);
+        u1 = aes32esmi(u1, t1, 0); u1 = aes32esmi(u1, t2, 1); u1 = aes32esmi(u1, t3, 2); u1 = aes32esmi(u1, t0, 3);
+        u2 = aes32esmi(u2, t2, 0); u2 = aes32esmi(u2, t3, 1); u2 = aes32esmi(u2, t0, 2); u2 = aes32esmi(u2, t1, 3);
+        u3 = aes32esmi(u3, t3, 0); u3 = aes32esmi(u3, t0, 1); u3 = aes32esmi(u3, t1, 2); u3 = aes32esmi(u3, t2, 3);
+        t0 = u0; t1 = u1; t2 = u2; t3 = u3;
+    }
+
+    // final round has no MixColumns
+    const uint32_t *k = rk + 40;
+    out[0] = aes32esi(aes32esi(aes32esi(aes32esi(k[0], t0, 0), t1, 1), t2, 2), t3, 3);
+    out[1] = aes32esi(aes32esi(aes32esi(aes32esi(k[1], t1, 0), t2, 1), t3, 2), t0, 3);
+    out[2] = aes32esi(aes32esi(aes32esi(aes32esi(k[2], t2, 0), t3, 1), t0, 2), t1, 3);
+    out[3] = aes32esi(aes32esi(aes32esi(aes32esi(k[3], t3, 0), t0, 1), t1, 2), t2, 3);
+}
+
+static void aes128_decrypt(uint32_t out[4], const uint32_t in[4], const uint32_t dk[44]) {
+    uint32_t t0 = in[0] ^ dk[40];
+    uint32_t t1 = in[1] ^ dk[41];
+    uint32_t t2 = in[2] ^ dk[42];
+    uint32_t t3 = in[3] ^ dk[43];
+
+    for (int r=9;r>0;r--) {
+        const uint32_t *k = dk + r * 4;
+        uint32_t u0 = k[0], u1 = k[1], u2 = k[2], u3 = k[3];
+        u0 = aes32dsmi(u0, t0, 0); u0 = aes32dsmi(u0, t3, 1); u0 = aes32dsmi(u0, t2, 2); u0 = aes32dsmi(u0, t1, 3);
+        u1 = aes32dsmi(u1, t1, 0); u1 = aes32dsmi(u1, t0, 1); u1 = aes32dsmi(u1, t3, 2); u1 = aes32dsmi(u1, t2, 3);
+        u2 = aes32dsmi(u2, t2, 0); u2 = aes32dsmi(u2, t1, 1); u2 = aes32dsmi(u2, t0, 2); u2 = aes32dsmi(u2, t3, 3);
+        u3 = aes32dsmi(u3, t3, 0); u3 = aes32dsmi(u3, t2, 1); u3 = aes32dsmi(u3, t1, 2); u3 = aes32dsmi(u3, t0, 3);
+        t0 = u0; t1 = u1; t2 = u2; t3 = u3;
+    }
+
+    out[0] = aes32dsi(aes32dsi(aes32dsi(aes32dsi(dk[0], t0, 0), t3, 1), t2, 2), t1, 3);
+    out[1] = aes32dsi(aes32dsi(aes32dsi(aes32dsi(dk[1], t1, 0), t0, 1), t3, 2), t2, 3);
+    out[2] = aes32dsi(aes32dsi(aes32dsi(aes32dsi(dk[2], t2, 0), t1, 1), t0, 2), t3, 3);
+    out[3] = aes32dsi(aes32dsi(aes32dsi(aes32dsi(dk[3], t3, 0), t2, 1), t1, 2), t0, 3);
+}
+
+static void printwords(const uint32_t *w, int n) {
+    for (int i=0;i<n;i++) {
+        printhex(w[i]);
+        print(" ");
+    }
+    println("");
+}
+
+// FIPS 197 appendix C.1, as little endian words
+static const uint32_t aes_key[4] = { 0x03020100, 0x07060504, 0x0b0a0908, 0x0f0e0d0c };
+static const uint32_t aes_plain[4] = { 0x33221100, 0x77665544, 0xbbaa9988, 0xffeeddcc };
+
+void main(void) {
+    uint32_t h[8];
+    uint32_t rk[44];
+    uint32_t dk[44];
+    uint32_t ct[4];
+    uint32_t pt[4];
+
+    println("sha256(\"abc\"), expect ba7816bf 8f01cfea 414140de 5dae2223 b00361a3 96177a9c b410ff61 f20015ad");
+    sha256((const uint8_t *)"abc", 3, h);
+    printwords(h, 8);
+
+    println("aes128 encrypt, expect d8e0c469 30047b6a 80b7cdd8 5ac5b470");
+    aes128_key(rk, aes_key);
+    aes128_encrypt(ct, aes_plain, rk);
+    printwords(ct, 4);
+
+    println("aes128 decrypt, expect 33221100 77665544 bbaa9988 ffeeddcc");
+    aes128_deckey(dk, rk);
+    aes128_decrypt(pt, ct, dk);
+    printwords(pt, 4);
+}
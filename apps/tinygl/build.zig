@@ -7,6 +7,7 @@ pub fn build(b: *std.Build) void {
     var options = b.addOptions();
     const heapsize = b.option(u32, "heapsize", "heap size in bytes") orelse 0; // -Dheapsize=u32
     options.addOption(u32, "heapsize", heapsize);
+    const hardfloat = b.option(bool, "hardfloat", "use the F extension instead of soft float") orelse false; // -Dhardfloat=true
 
     const features = Target.riscv.Feature;
     var disabled_features = Feature.Set.empty;
@@ -20,6 +21,11 @@ pub fn build(b: *std.Build) void {
     disabled_features.addFeature(@intFromEnum(features.f));
     // except multiply
     enabled_features.addFeature(@intFromEnum(features.m));
+    // and optionally single precision float, which selects the ilp32f abi
+    if (hardfloat) {
+        disabled_features.removeFeature(@intFromEnum(features.f));
+        enabled_features.addFeature(@intFromEnum(features.f));
+    }
 
     const target = b.resolveTargetQuery(.{ .cpu_arch = Target.Cpu.Arch.riscv32, .os_tag = Target.Os.Tag.freestanding, .abi = Target.Abi.none, .cpu_model = .{ .explicit = &std.Target.riscv.cpu.generic_rv32 }, .cpu_features_sub = disabled_features, .cpu_features_add = enabled_features });
 
@@ -325,6 +325,9 @@ fn submain() !void {
     // init zepto with a memory allocator and console writer
     zeptolibc.init(uvm.allocator(), consoleWriteFn);
 
+    // poll keys from the host's info page when offered, rather than a syscall each time
+    _ = uvm.mapInfo();
+
     const zb: *tgl.ZBuffer = tgl.ZB_open(WIDTH, HEIGHT, tgl.ZB_MODE_RGBA, 0, 0, 0, &gfxFramebuffer);
     tgl.glInit(zb);
 
@@ -28,6 +28,28 @@ pub inline fn render(fb: [*]const u8, len:u32) void {
     _ = syscall(uvm32.UVM32_SYSCALL_RENDER, @intFromPtr(fb), len);
 }
 
+// Framebuffer mapped by the host, null if it has none of this size
+// Only rows written since the last present() are copied to the screen
+pub fn framebuffer(width: u32, height: u32) ?[]u32 {
+    const addr = syscall(uvm32.UVM32_SYSCALL_FBMAP, width, height);
+    if (addr == 0xFFFFFFFF) {
+        return null;
+    }
+    const base: [*]u32 = @ptrFromInt(addr);
+    return base[0 .. width * height];
+}
+
+pub inline fn present() void {
+    _ = syscall(uvm32.UVM32_SYSCALL_PRESENT, 0, 0);
+}
+
+pub const Blit = uvm32.uvm32_blit_t;
+
+// Run a 2D blitter operation on the host, false if it was invalid
+pub inline fn blit(b: *const Blit) bool {
+    return syscall(uvm32.UVM32_SYSCALL_BLIT, @intFromPtr(b), 0) == 0;
+}
+
 pub inline fn getc() ?u8 {
     const key = syscall(uvm32.UVM32_SYSCALL_GETC, 0, 0);
     if (key == 0xFFFFFFFF) {
@@ -37,8 +59,36 @@ pub inline fn getc() ?u8 {
     }
 }
 
+pub const Info = uvm32.uvm32_info_t;
+
+// Info page mapped by the host. Once mapInfo() finds it, getkey() and millis() read it rather than making a syscall
+var info: ?*const volatile Info = null;
+var info_key_rd: u32 = 0;
+
+pub fn mapInfo() bool {
+    const addr = syscall(uvm32.UVM32_SYSCALL_INFOMAP, 0, 0);
+    if (addr != 0xFFFFFFFF) {
+        info = @ptrFromInt(addr);
+    }
+    return info != null;
+}
+
+fn infoKey(i: *const volatile Info) u32 {
+    const wr = i.key_wr;
+    if (wr -% info_key_rd > uvm32.UVM32_INFO_EVENTS) {
+        // fell behind, skip to the oldest event still held
+        info_key_rd = wr -% uvm32.UVM32_INFO_EVENTS;
+    }
+    if (info_key_rd == wr) {
+        return 0xFFFFFFFF;
+    }
+    const k = i.key_events[info_key_rd & (uvm32.UVM32_INFO_EVENTS - 1)];
+    info_key_rd +%= 1;
+    return k;
+}
+
 pub inline fn getkey(code: *u16, pressed:*bool) bool {
-    const k = syscall(uvm32.UVM32_SYSCALL_GETKEY, 0, 0);
+    const k = if (info) |i| infoKey(i) else syscall(uvm32.UVM32_SYSCALL_GETKEY, 0, 0);
     if (k == 0xFFFFFFFF) {
         return false;
     } else {
@@ -49,6 +99,9 @@ pub inline fn getkey(code: *u16, pressed:*bool) bool {
 }
 
 pub inline fn millis() u32 {
+    if (info) |i| {
+        return i.millis;
+    }
     return syscall(uvm32.UVM32_SYSCALL_MILLIS, 0, 0);
 }
 
@@ -10,11 +10,16 @@ const sdlkeys = @cImport({
     @cInclude("SDL_scancode.h");
 });
 
-const wad_data = @embedFile("doom1.wad");
+// WAD is mapped read-only by the host (host-sdl -a doom1.wad), rather than embedded in the ROM
+var wad_data: []const u8 = &.{};
 
 const WIDTH = 320;
 const HEIGHT = 200;
 
+// RGB palette set by doom, converted for the host each frame
+extern var screen_palette: [256 * 3]u8;
+var palette: [256]u32 = undefined;
+
 const WAD_FILE_HANDLE: *c_int = @ptrFromInt(0x00000008); // some unique value we give when wad file opened
 var wad_stream_offset: usize = 0;
 
@@ -35,9 +40,9 @@ export fn doom_exit_impl(code: c_int) void {
 }
 
 export fn doom_gettime_impl(sec: *c_int, usec: *c_int) callconv(.c) void {
-    const now = uvm.millis();
-    sec.* = @intCast(now / 1000);
-    usec.* = @intCast(@mod(now * 1000, 1000000));
+    const now = uvm.micros();
+    sec.* = @intCast(now / 1000000);
+    usec.* = @intCast(now % 1000000);
 }
 
 export fn doom_open_impl(filename: [*:0]const u8, mode: [*]const u8) callconv(.c) ?*c_int {
@@ -45,6 +50,11 @@ export fn doom_open_impl(filename: [*:0]const u8, mode: [*]const u8) callconv(.c
     _ = console.print("doom_open_impl {s}\n", .{std.mem.span(filename)}) catch 0;
     _ = console.flush() catch 0;
     if (std.mem.eql(u8, std.mem.span(filename), "/doom1.wad")) {
+        wad_data = uvm.asset();
+        if (wad_data.len == 0) {
+            return null;
+        }
+        wad_stream_offset = 0;
         return WAD_FILE_HANDLE;
     }
     return null;
@@ -193,18 +203,34 @@ fn submain() !void {
     // init zepto with a memory allocator and console writer
     zeptolibc.init(uvm.allocator(), consoleWriteFn);
 
+    // poll keys from the host's info page when offered, rather than a syscall each time
+    _ = uvm.mapInfo();
+
     pd.doom_set_resolution(WIDTH, HEIGHT);
     pd.pd_init();
 
+    // queue audio straight into host memory when offered, rather than a syscall per buffer
+    const audio = uvm.audioRing();
+
     while(true) {
         pd.doom_update();
-        if (uvm.canRenderAudio()) {
+        if (audio) |ring| {
+            // keep about one buffer queued ahead of the host
+            if (uvm.audioLevel(ring) < 1024) {
+                const doomSndBuf: [*]i16 = pd.doom_get_sound_buffer();
+                _ = uvm.audioWrite(ring, doomSndBuf[0..1024]);
+            }
+        } else if (uvm.canRenderAudio()) {
             const doomSndBuf: [*]i16 = pd.doom_get_sound_buffer();
             uvm.renderAudio(doomSndBuf, 2048);
         }
 
-        const fb: [*]const u8 = pd.doom_get_framebuffer(4);
-        uvm.render(fb, WIDTH * HEIGHT * 4);
+        // send 8bpp indices and let the host expand them, rather than expanding in the VM
+        const fb: [*]const u8 = pd.doom_get_framebuffer(1);
+        for (&palette, 0..) |*p, i| {
+            p.* = @as(u32, 0xFF) << 24 | @as(u32, screen_palette[i * 3 + 2]) << 16 | @as(u32, screen_palette[i * 3 + 1]) << 8 | @as(u32, screen_palette[i * 3]);
+        }
+        uvm.render8(fb, WIDTH * HEIGHT, &palette);
 
         var pressed:bool = undefined;
         var scancode:u16 = undefined;
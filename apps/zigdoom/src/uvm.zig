@@ -24,6 +24,22 @@ pub inline fn syscall(id: u32, param1: u32, param2: u32) u32 {
     return val;
 }
 
+pub inline fn syscall3(id: u32, param1: u32, param2: u32, param3: u32) u32 {
+    var val: u32 = undefined;
+    asm volatile ("ecall"
+        : [val] "={a2}" (val),
+        : [param1] "{a0}" (param1), [param2] "{a1}" (param2), [param3] "{a3}" (param3),
+          [id] "{a7}" (id),
+        : .{ .memory = true });
+    return val;
+}
+
+// Read-only asset mapped by the host, empty when there is none
+pub fn asset() []const u8 {
+    const base: [*]const u8 = @ptrFromInt(uvm32.UVM32_ASSET_BASE);
+    return base[0..syscall(uvm32.UVM32_SYSCALL_ASSETLEN, 0, 0)];
+}
+
 pub inline fn canRenderAudio() bool {
     return syscall(uvm32.UVM32_SYSCALL_CANRENDERAUDIO, 0, 0) != 0;
 }
@@ -32,10 +48,69 @@ pub inline fn renderAudio(audbuf: [*]const i16, len:u32) void {
     _ = syscall(uvm32.UVM32_SYSCALL_RENDERAUDIO, @intFromPtr(audbuf), len);
 }
 
+pub const AudioRing = uvm32.uvm32_audioring_t;
+
+// Audio ring mapped by the host, null if it has none. Samples are queued without a syscall
+pub fn audioRing() ?*volatile AudioRing {
+    const addr = syscall(uvm32.UVM32_SYSCALL_AUDIOMAP, 0, 0);
+    if (addr == 0xFFFFFFFF) {
+        return null;
+    }
+    return @ptrFromInt(addr);
+}
+
+// Samples queued but not yet played
+pub inline fn audioLevel(ring: *volatile AudioRing) u32 {
+    return ring.wr -% ring.rd;
+}
+
+// Queue as many samples as fit, returns the number queued
+pub fn audioWrite(ring: *volatile AudioRing, samples: []const i16) u32 {
+    const buf: [*]volatile i16 = @ptrFromInt(@intFromPtr(ring) + @sizeOf(AudioRing));
+    const len = ring.len;
+    var wr = ring.wr;
+    const n: u32 = @min(samples.len, len -% (wr -% ring.rd));
+    for (samples[0..n]) |s| {
+        buf[wr & (len - 1)] = s;
+        wr +%= 1;
+    }
+    // samples must land before the host sees the new wr
+    asm volatile ("fence rw, w" ::: .{ .memory = true });
+    ring.wr = wr;
+    return n;
+}
+
 pub inline fn render(fb: [*]const u8, len:u32) void {
     _ = syscall(uvm32.UVM32_SYSCALL_RENDER, @intFromPtr(fb), len);
 }
 
+// 8bpp pixels, each expanded by the host to a colour from palette
+pub inline fn render8(fb: [*]const u8, len:u32, palette: *const [256]u32) void {
+    _ = syscall3(uvm32.UVM32_SYSCALL_RENDER8, @intFromPtr(fb), len, @intFromPtr(palette));
+}
+
+// Framebuffer mapped by the host, null if it has none of this size
+// Only rows written since the last present() are copied to the screen
+pub fn framebuffer(width: u32, height: u32) ?[]u32 {
+    const addr = syscall(uvm32.UVM32_SYSCALL_FBMAP, width, height);
+    if (addr == 0xFFFFFFFF) {
+        return null;
+    }
+    const base: [*]u32 = @ptrFromInt(addr);
+    return base[0 .. width * height];
+}
+
+pub inline fn present() void {
+    _ = syscall(uvm32.UVM32_SYSCALL_PRESENT, 0, 0);
+}
+
+pub const Blit = uvm32.uvm32_blit_t;
+
+// Run a 2D blitter operation on the host, false if it was invalid
+pub inline fn blit(b: *const Blit) bool {
+    return syscall(uvm32.UVM32_SYSCALL_BLIT, @intFromPtr(b), 0) == 0;
+}
+
 pub inline fn getc() ?u8 {
     const key = syscall(uvm32.UVM32_SYSCALL_GETC, 0, 0);
     if (key == 0xFFFFFFFF) {
@@ -45,8 +120,36 @@ pub inline fn getc() ?u8 {
     }
 }
 
+pub const Info = uvm32.uvm32_info_t;
+
+// Info page mapped by the host. Once mapInfo() finds it, getkey() and millis() read it rather than making a syscall
+var info: ?*const volatile Info = null;
+var info_key_rd: u32 = 0;
+
+pub fn mapInfo() bool {
+    const addr = syscall(uvm32.UVM32_SYSCALL_INFOMAP, 0, 0);
+    if (addr != 0xFFFFFFFF) {
+        info = @ptrFromInt(addr);
+    }
+    return info != null;
+}
+
+fn infoKey(i: *const volatile Info) u32 {
+    const wr = i.key_wr;
+    if (wr -% info_key_rd > uvm32.UVM32_INFO_EVENTS) {
+        // fell behind, skip to the oldest event still held
+        info_key_rd = wr -% uvm32.UVM32_INFO_EVENTS;
+    }
+    if (info_key_rd == wr) {
+        return 0xFFFFFFFF;
+    }
+    const k = i.key_events[info_key_rd & (uvm32.UVM32_INFO_EVENTS - 1)];
+    info_key_rd +%= 1;
+    return k;
+}
+
 pub inline fn getkey(code: *u16, pressed:*bool) bool {
-    const k = syscall(uvm32.UVM32_SYSCALL_GETKEY, 0, 0);
+    const k = if (info) |i| infoKey(i) else syscall(uvm32.UVM32_SYSCALL_GETKEY, 0, 0);
     if (k == 0xFFFFFFFF) {
         return false;
     } else {
@@ -57,9 +160,30 @@ pub inline fn getkey(code: *u16, pressed:*bool) bool {
 }
 
 pub inline fn millis() u32 {
+    if (info) |i| {
+        return i.millis;
+    }
     return syscall(uvm32.UVM32_SYSCALL_MILLIS, 0, 0);
 }
 
+// Read a counter CSR without a syscall, encoded with .insn as csrr needs zicsr
+inline fn csrRead(comptime csr: u32) u32 {
+    return asm volatile (std.fmt.comptimePrint(".insn i 0x73, 2, %[ret], x0, {d}", .{@as(i32, csr) - 0x1000})
+        : [ret] "=r" (-> u32),
+    );
+}
+
+// Host clock in microseconds, from the time CSR
+pub inline fn micros() u64 {
+    while (true) {
+        const hi = csrRead(0xc81);
+        const lo = csrRead(0xc01);
+        if (hi == csrRead(0xc81)) {
+            return (@as(u64, hi) << 32) | lo;
+        }
+    }
+}
+
 // dupeZ would be better, but want to avoid using an allocator
 // this is of course, unsafe...
 var termination_buf:[512]u8 = undefined;
@@ -1,6 +1,9 @@
 // Syscall definitions needed by both host and target for sample apps
 // These are not required when building a custom host target code with uvm32
 
+#ifndef UVM32_COMMON_CUSTOM_H
+#define UVM32_COMMON_CUSTOM_H 1
+
 // syscalls for exposed host functions, start at 0
 #define UVM32_SYSCALL_PUTC        0x00000000
 #define UVM32_SYSCALL_GETC        0x00000001
@@ -16,4 +19,106 @@
 #define UVM32_SYSCALL_CANRENDERAUDIO 0x0000000B
 #define UVM32_SYSCALL_RAND        0x0000000C
 
+// Read only file access, see hosts/common/uvm32_files.h
+#define UVM32_SYSCALL_FOPEN       0x0000000D    // ARG0 path, RET handle
+#define UVM32_SYSCALL_FREAD       0x0000000E    // ARG0 handle, ARG1 buf, ARG2 len, RET bytes read
+#define UVM32_SYSCALL_FSEEK       0x0000000F    // ARG0 handle, ARG1 offset, ARG2 whence, RET new position
+#define UVM32_SYSCALL_FCLOSE      0x00000010    // ARG0 handle
+#define UVM32_SYSCALL_FSTAT       0x00000011    // ARG0 handle, RET file length
+// all return 0xFFFFFFFF on failure
+
+// Persistent extram, see hosts/common/uvm32_persist.h
+#define UVM32_SYSCALL_SYNC        0x00000012    // start writing back changes, RET 0
+#define UVM32_SYSCALL_CHECKPOINT  0x00000013    // RET 0 once changes are on disk
+
+// Framebuffer in extram, only changed rows are copied to the screen
+#define UVM32_SYSCALL_FBMAP       0x00000014    // ARG0 width, ARG1 height, RET address of width*height 32bit pixels, 0xFFFFFFFF on failure
+#define UVM32_SYSCALL_PRESENT     0x00000015    // show changes made to framebuffer
+
+// ARG0 8bpp pixels, ARG1 len, ARG2 palette of 256 32bit colours, expanded to the screen by the host
+#define UVM32_SYSCALL_RENDER8     0x00000016
+
+// 2D blitter, see hosts/common/uvm32_blit.h
+#define UVM32_SYSCALL_BLIT        0x00000017    // ARG0 uvm32_blit_t, RET 0, 0xFFFFFFFF on failure
+
+// Audio ring in VM memory, samples are queued without a syscall
+#define UVM32_SYSCALL_AUDIOMAP    0x00000018    // RET address of uvm32_audioring_t, 0xFFFFFFFF on failure
+
+// Read only page of host state, read without a syscall
+#define UVM32_SYSCALL_INFOMAP     0x00000019    // RET address of uvm32_info_t, 0xFFFFFFFF on failure
+
+// Single producer, single consumer ring of 16 bit audio samples, shared by VM code and host.
+// wr and rd count samples and wrap at 2^32, wr - rd is the fill level. VM code stores samples
+// at (wr & (len - 1)) onwards, then a fence, then the new wr. The host only advances rd
+typedef struct {
+    uint32_t wr;            // samples written, only written by VM code
+    uint32_t rd;            // samples played, only written by host
+    uint32_t len;           // ring length in samples, a power of 2
+    uint32_t reserved;
+    // followed by len int16_t samples
+} uvm32_audioring_t;
+
+// uvm32_info_t sizes
+#define UVM32_INFO_EVENTS   32      // key event ring length, a power of 2
+#define UVM32_INFO_KEYS     512     // scancodes covered by the keys bitmap
+#define UVM32_INFO_RAND     16      // random words per run
+
+// Host state, rewritten by the host each time before VM code resumes. Values only
+// move on across a syscall, so VM code must not spin waiting for one to change
+typedef struct {
+    uint32_t micros;        // host monotonic clock in microseconds
+    uint32_t micros_hi;
+    uint32_t millis;        // as UVM32_SYSCALL_MILLIS
+    uint32_t runs;          // times VM code has been resumed
+    uint32_t frames;        // frames shown by host
+    uint32_t key_wr;        // key events written, event n is at key_events[n & (UVM32_INFO_EVENTS - 1)]
+    uint32_t key_events[UVM32_INFO_EVENTS];     // as UVM32_SYSCALL_GETKEY, scancode | 0x80000000 if pressed
+    uint32_t keys[UVM32_INFO_KEYS / 32];        // bitmap of scancodes held down
+    uint32_t rand[UVM32_INFO_RAND];             // fresh random words every run
+} uvm32_info_t;
+
+// Interrupts raised by host-sdl, see uvm32_interrupt()
+#define UVM32_IRQ_KEY       0   // key events are waiting
+#define UVM32_IRQ_FRAME     1   // a frame has been shown
+
+// whence for UVM32_SYSCALL_FSEEK
+#define UVM32_SEEK_SET 0
+#define UVM32_SEEK_CUR 1
+#define UVM32_SEEK_END 2
+
+// uvm32_blit_t op
+#define UVM32_BLIT_FILL     0   // fill dst rect with colour
+#define UVM32_BLIT_COPY     1   // copy sw x sh src rect to dx,dy, clipped to both surfaces
+#define UVM32_BLIT_SCALE    2   // stretch src rect to dst rect
+
+// uvm32_blit_t flags, for UVM32_BLIT_COPY and UVM32_BLIT_SCALE
+#define UVM32_BLIT_COLORKEY 1   // skip src pixels equal to colour
+#define UVM32_BLIT_ALPHA    2   // blend src over dst by src alpha
+#define UVM32_BLIT_BILINEAR 4   // filter when scaling, rather than nearest
+
+// uvm32_surface_t format, pixels are converted when formats differ
+#define UVM32_BLIT_RGBA8888 0   // 4 bytes, R G B A, as UVM32_SYSCALL_RENDER
+#define UVM32_BLIT_RGB565   1   // 2 bytes, R in the top 5 bits
+#define UVM32_BLIT_L8       2   // 1 byte, grey
+
+// An image in VM memory
+typedef struct {
+    uint32_t pixels;        // address of top left pixel
+    uint32_t width;
+    uint32_t height;
+    uint32_t pitch;         // bytes from one row to the next
+    uint32_t format;        // UVM32_BLIT_RGBA8888 etc.
+} uvm32_surface_t;
+
+// A blitter operation, colour is in dst format for UVM32_BLIT_FILL, src format for UVM32_BLIT_COLORKEY
+typedef struct {
+    uint32_t op;
+    uint32_t flags;
+    uint32_t colour;
+    uvm32_surface_t dst;
+    int32_t dx, dy, dw, dh;     // dw and dh unused by UVM32_BLIT_COPY
+    uvm32_surface_t src;        // unused by UVM32_BLIT_FILL
+    int32_t sx, sy, sw, sh;
+} uvm32_blit_t;
 
+#endif
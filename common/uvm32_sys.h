@@ -7,9 +7,23 @@
 #define UVM32_SYSCALL_HALT          0x1000000
 #define UVM32_SYSCALL_YIELD         0x1000001
 #define UVM32_SYSCALL_STACKPROTECT  0x1000002
+#define UVM32_SYSCALL_ASSETLEN      0x1000003
+#define UVM32_SYSCALL_IRQHANDLER    0x1000004   // a0 address of handler(irqs), or 0 for none
+#define UVM32_SYSCALL_IRQENABLE     0x1000005   // a0 mask of interrupts to take, returns previous mask
+#define UVM32_SYSCALL_WAIT          0x1000006   // a0 timeout in host clock units, a1 mask of interrupts to wake on, returns mask which woke it, 0 on timeout
+
+// UVM32_SYSCALL_WAIT timeout to wait only for interrupts
+#define UVM32_WAIT_FOREVER 0xFFFFFFFF
+
+// Return address given to an interrupt handler, returning to it resumes the interrupted code
+#define UVM32_IRQ_RETURN  0xFFFFFFFC
 
 // Address of External RAM, when offered by host
 #define UVM32_EXTRAM_BASE 0x10000000
+// External RAM regions may be mapped anywhere from UVM32_EXTRAM_BASE up to UVM32_MMIO_END
+#define UVM32_MMIO_END    0x80000000
+// Address of the read-only shared asset, when offered by host
+#define UVM32_ASSET_BASE  0x40000000
 
 #endif
 
@@ -0,0 +1,321 @@
+#include <string.h>
+#include "uvm32_blit.h"
+
+#define ERR_RET 0xFFFFFFFF
+
+// A surface checked to lie in VM memory
+typedef struct {
+    uint8_t *ptr;
+    uint32_t addr;          // VM address of ptr, to mark writes dirty
+    int64_t width;
+    int64_t height;
+    uint32_t pitch;
+    uint32_t format;
+    uint32_t bpp;
+} surface_t;
+
+static uint32_t format_bpp(uint32_t format) {
+    switch(format) {
+        case UVM32_BLIT_RGBA8888:
+            return 4;
+        case UVM32_BLIT_RGB565:
+            return 2;
+        case UVM32_BLIT_L8:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static bool get_surface(uvm32_state_t *vmst, const uvm32_surface_t *s, bool write, surface_t *out) {
+    const uint32_t bpp = format_bpp(s->format);
+
+    if (bpp == 0 || s->width == 0 || s->height == 0 || s->width > UVM32_BLIT_MAX_DIM || s->height > UVM32_BLIT_MAX_DIM || s->pitch < s->width * bpp) {
+        return false;
+    }
+    const uint64_t len = (uint64_t)s->pitch * (s->height - 1) + s->width * bpp;
+    if (len > UINT32_MAX) {
+        return false;
+    }
+    // the whole surface, from first pixel to last, must be valid VM memory, and writable to draw on
+    uvm32_slice_t buf = write ? uvm32_getslice_w(vmst, s->pixels, (uint32_t)len) : uvm32_getslice(vmst, s->pixels, (uint32_t)len);
+    if (buf.len != len) {
+        return false;
+    }
+    out->ptr = buf.ptr;
+    out->addr = s->pixels;
+    out->width = s->width;
+    out->height = s->height;
+    out->pitch = s->pitch;
+    out->format = s->format;
+    out->bpp = bpp;
+    return true;
+}
+
+// Pixels are stored little endian, as the VM sees them
+static uint32_t read_raw(const uint8_t *p, uint32_t bpp) {
+    uint32_t v = 0;
+    for (uint32_t i=0;i<bpp;i++) {
+        v |= (uint32_t)p[i] << (i * 8);
+    }
+    return v;
+}
+
+static void write_raw(uint8_t *p, uint32_t bpp, uint32_t v) {
+    for (uint32_t i=0;i<bpp;i++) {
+        p[i] = v >> (i * 8);
+    }
+}
+
+// Read a pixel as RGBA8888, with R in the low byte
+static uint32_t read_rgba(const uint8_t *p, uint32_t format) {
+    switch(format) {
+        case UVM32_BLIT_RGB565: {
+            const uint32_t v = read_raw(p, 2);
+            const uint32_t r = (v >> 11) & 0x1f;
+            const uint32_t g = (v >> 5) & 0x3f;
+            const uint32_t b = v & 0x1f;
+            return ((r << 3) | (r >> 2)) | ((g << 2) | (g >> 4)) << 8 | ((b << 3) | (b >> 2)) << 16 | 0xFF000000;
+        }
+        case UVM32_BLIT_L8:
+            return p[0] * 0x010101u | 0xFF000000;
+        default:
+            return read_raw(p, 4);
+    }
+}
+
+static void write_rgba(uint8_t *p, uint32_t format, uint32_t c) {
+    const uint32_t r = c & 0xff;
+    const uint32_t g = (c >> 8) & 0xff;
+    const uint32_t b = (c >> 16) & 0xff;
+
+    switch(format) {
+        case UVM32_BLIT_RGB565:
+            write_raw(p, 2, (r >> 3) << 11 | (g >> 2) << 5 | (b >> 3));
+        break;
+        case UVM32_BLIT_L8:
+            p[0] = (r * 77 + g * 150 + b * 29) >> 8;
+        break;
+        default:
+            write_raw(p, 4, c);
+        break;
+    }
+}
+
+// src over dst, by src alpha
+static uint32_t blend(uint32_t s, uint32_t d) {
+    const uint32_t a = s >> 24;
+    uint32_t out = 0;
+
+    for (uint32_t shift=0;shift<24;shift+=8) {
+        const uint32_t sc = (s >> shift) & 0xff;
+        const uint32_t dc = (d >> shift) & 0xff;
+        out |= ((sc * a + dc * (255 - a) + 127) / 255) << shift;
+    }
+    return out | (a + ((d >> 24) * (255 - a) + 127) / 255) << 24;
+}
+
+static void put_rgba(const surface_t *dst, uint8_t *dp, uint32_t c, uint32_t flags) {
+    if (flags & UVM32_BLIT_ALPHA) {
+        c = blend(c, read_rgba(dp, dst->format));
+    }
+    write_rgba(dp, dst->format, c);
+}
+
+static uint32_t lerp(uint32_t a, uint32_t b, uint32_t w) {
+    uint32_t out = 0;
+    for (uint32_t shift=0;shift<32;shift+=8) {
+        const uint32_t ac = (a >> shift) & 0xff;
+        const uint32_t bc = (b >> shift) & 0xff;
+        out |= ((ac * (256 - w) + bc * w) >> 8) << shift;
+    }
+    return out;
+}
+
+// Clip rect to 0,0,width,height, returns false if nothing is left
+static bool clip(int64_t *x, int64_t *y, int64_t *w, int64_t *h, int64_t width, int64_t height) {
+    if (*x < 0) {
+        *w += *x;
+        *x = 0;
+    }
+    if (*y < 0) {
+        *h += *y;
+        *y = 0;
+    }
+    if (*x + *w > width) {
+        *w = width - *x;
+    }
+    if (*y + *h > height) {
+        *h = height - *y;
+    }
+    return *w > 0 && *h > 0;
+}
+
+static uint8_t *pixel(const surface_t *s, int64_t x, int64_t y) {
+    return &s->ptr[y * s->pitch + x * s->bpp];
+}
+
+static void mark_rows(uvm32_state_t *vmst, const surface_t *s, int64_t x, int64_t y, int64_t w, int64_t h) {
+    for (int64_t r=y;r<y+h;r++) {
+        uvm32_markDirty(vmst, s->addr + (uint32_t)(r * s->pitch + x * s->bpp), (uint32_t)(w * s->bpp));
+    }
+}
+
+static void fill(uvm32_state_t *vmst, const surface_t *dst, const uvm32_blit_t *b) {
+    int64_t x = b->dx, y = b->dy, w = b->dw, h = b->dh;
+
+    if (!clip(&x, &y, &w, &h, dst->width, dst->height)) {
+        return;
+    }
+    // build the first row, then copy it down
+    uint8_t *row = pixel(dst, x, y);
+    for (int64_t i=0;i<w;i++) {
+        write_raw(&row[i * dst->bpp], dst->bpp, b->colour);
+    }
+    for (int64_t r=1;r<h;r++) {
+        memcpy(&row[r * dst->pitch], row, w * dst->bpp);
+    }
+    mark_rows(vmst, dst, x, y, w, h);
+}
+
+static void copy(uvm32_state_t *vmst, const surface_t *dst, const surface_t *src, const uvm32_blit_t *b) {
+    int64_t sx = b->sx, sy = b->sy, dx = b->dx, dy = b->dy, w = b->sw, h = b->sh;
+
+    // clip to src, moving dst by the same amount, then to dst, moving src
+    int64_t x = sx, y = sy;
+    if (!clip(&sx, &sy, &w, &h, src->width, src->height)) {
+        return;
+    }
+    dx += sx - x;
+    dy += sy - y;
+    x = dx;
+    y = dy;
+    if (!clip(&dx, &dy, &w, &h, dst->width, dst->height)) {
+        return;
+    }
+    sx += dx - x;
+    sy += dy - y;
+
+    if (src->format == dst->format && (b->flags & (UVM32_BLIT_COLORKEY | UVM32_BLIT_ALPHA)) == 0) {
+        // straight copy, rows may overlap when src and dst share memory
+        const bool upwards = pixel(dst, dx, dy) > pixel(src, sx, sy);
+        for (int64_t i=0;i<h;i++) {
+            const int64_t r = upwards ? h - 1 - i : i;
+            memmove(pixel(dst, dx, dy + r), pixel(src, sx, sy + r), w * dst->bpp);
+        }
+    } else {
+        for (int64_t r=0;r<h;r++) {
+            const uint8_t *sp = pixel(src, sx, sy + r);
+            uint8_t *dp = pixel(dst, dx, dy + r);
+            for (int64_t i=0;i<w;i++, sp += src->bpp, dp += dst->bpp) {
+                if ((b->flags & UVM32_BLIT_COLORKEY) && read_raw(sp, src->bpp) == b->colour) {
+                    continue;
+                }
+                put_rgba(dst, dp, read_rgba(sp, src->format), b->flags);
+            }
+        }
+    }
+    mark_rows(vmst, dst, dx, dy, w, h);
+}
+
+// Position of dst pixel i of n in a src span of len, in 16.16 fixed point, sampling at pixel centres
+static int64_t sample_pos(int64_t i, int64_t n, int64_t len) {
+    int64_t pos = (((2 * i + 1) * len) << 16) / (2 * n) - 0x8000;
+    if (pos < 0) {
+        pos = 0;
+    }
+    if (pos > (len - 1) << 16) {
+        pos = (len - 1) << 16;
+    }
+    return pos;
+}
+
+static bool scale(uvm32_state_t *vmst, const surface_t *dst, const surface_t *src, const uvm32_blit_t *b) {
+    int64_t x = b->dx, y = b->dy, w = b->dw, h = b->dh;
+
+    // the whole src rect must be inside src, dst is clipped
+    if (b->sw <= 0 || b->sh <= 0 || b->sx < 0 || b->sy < 0 || b->sx + (int64_t)b->sw > src->width || b->sy + (int64_t)b->sh > src->height) {
+        return false;
+    }
+    if (w <= 0 || h <= 0 || !clip(&x, &y, &w, &h, dst->width, dst->height)) {
+        return true;
+    }
+    for (int64_t r=y;r<y+h;r++) {
+        uint8_t *dp = pixel(dst, x, r);
+        const int64_t fy = sample_pos(r - b->dy, b->dh, b->sh);
+        const int64_t y0 = b->sy + (fy >> 16);
+        const int64_t y1 = (fy >> 16) + 1 < b->sh ? y0 + 1 : y0;
+        const int64_t ny = b->sy + ((r - b->dy) * b->sh) / b->dh;
+
+        for (int64_t c=x;c<x+w;c++, dp += dst->bpp) {
+            uint32_t colour;
+            if (b->flags & UVM32_BLIT_BILINEAR) {
+                const int64_t fx = sample_pos(c - b->dx, b->dw, b->sw);
+                const int64_t x0 = b->sx + (fx >> 16);
+                const int64_t x1 = (fx >> 16) + 1 < b->sw ? x0 + 1 : x0;
+                if ((b->flags & UVM32_BLIT_COLORKEY) && read_raw(pixel(src, x0, y0), src->bpp) == b->colour) {
+                    continue;
+                }
+                const uint32_t wx = (fx >> 8) & 0xff;
+                const uint32_t wy = (fy >> 8) & 0xff;
+                const uint32_t top = lerp(read_rgba(pixel(src, x0, y0), src->format), read_rgba(pixel(src, x1, y0), src->format), wx);
+                const uint32_t bottom = lerp(read_rgba(pixel(src, x0, y1), src->format), read_rgba(pixel(src, x1, y1), src->format), wx);
+                colour = lerp(top, bottom, wy);
+            } else {
+                const uint8_t *sp = pixel(src, b->sx + ((c - b->dx) * b->sw) / b->dw, ny);
+                if ((b->flags & UVM32_BLIT_COLORKEY) && read_raw(sp, src->bpp) == b->colour) {
+                    continue;
+                }
+                colour = read_rgba(sp, src->format);
+            }
+            put_rgba(dst, dp, colour, b->flags);
+        }
+    }
+    mark_rows(vmst, dst, x, y, w, h);
+    return true;
+}
+
+bool uvm32_blit(uvm32_state_t *vmst, const uvm32_blit_t *b) {
+    surface_t dst, src;
+
+    if (!get_surface(vmst, &b->dst, true, &dst)) {
+        return false;
+    }
+    switch(b->op) {
+        case UVM32_BLIT_FILL:
+            fill(vmst, &dst, b);
+            return true;
+        case UVM32_BLIT_COPY:
+            if (!get_surface(vmst, &b->src, false, &src)) {
+                return false;
+            }
+            copy(vmst, &dst, &src, b);
+            return true;
+        case UVM32_BLIT_SCALE:
+            if (!get_surface(vmst, &b->src, false, &src)) {
+                return false;
+            }
+            return scale(vmst, &dst, &src, b);
+        default:
+            return false;
+    }
+}
+
+bool uvm32_blit_syscall(uvm32_state_t *vmst, uvm32_evt_t *evt) {
+    switch(evt->data.syscall.code) {
+        case UVM32_SYSCALL_BLIT: {
+            uvm32_slice_t cmd = uvm32_arg_getslice_fixed(vmst, evt, ARG0, sizeof(uvm32_blit_t));
+            uvm32_blit_t b;
+            if (cmd.len != sizeof(b)) {
+                uvm32_arg_setval(vmst, evt, RET, ERR_RET);
+                break;
+            }
+            // VM memory may not be aligned for the host
+            memcpy(&b, cmd.ptr, sizeof(b));
+            uvm32_arg_setval(vmst, evt, RET, uvm32_blit(vmst, &b) ? 0 : ERR_RET);
+        } break;
+        default:
+            return false;
+    }
+    return true;
+}
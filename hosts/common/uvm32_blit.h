@@ -0,0 +1,28 @@
+#ifndef UVM32_BLIT_H
+#define UVM32_BLIT_H 1
+
+// Reference host implementation of the UVM32_SYSCALL_BLIT 2D blitter
+//
+// VM code describes an operation with a uvm32_blit_t: fill a rectangle, copy
+// one (with colour key or alpha blend) or stretch one (nearest or bilinear)
+// between surfaces in VM memory, converting between pixel formats as needed.
+// Every surface is bounds checked against VM memory before it is touched and
+// rectangles are clipped, so a single syscall replaces a per-pixel loop of
+// interpreted code. Writes to mapped regions are marked dirty.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "uvm32.h"
+#include "uvm32_common_custom.h"
+
+#ifndef UVM32_BLIT_MAX_DIM
+#define UVM32_BLIT_MAX_DIM 16384    /*! Largest surface width or height accepted */
+#endif
+
+/*! Run a blitter operation on VM memory. Returns false if the operation or its surfaces are invalid */
+bool uvm32_blit(uvm32_state_t *vmst, const uvm32_blit_t *b);
+
+/*! Handle UVM32_SYSCALL_BLIT. Returns false if the syscall is not a blit, so the host should handle it */
+bool uvm32_blit_syscall(uvm32_state_t *vmst, uvm32_evt_t *evt);
+
+#endif
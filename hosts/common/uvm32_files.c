@@ -0,0 +1,339 @@
+// for openat() and pread()
+#define _XOPEN_SOURCE 700
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "uvm32_files.h"
+#include "uvm32_common_custom.h"
+
+#define CACHE_WAYS 4
+#define CACHE_SETS (UVM32_FILES_CACHE_PAGES / CACHE_WAYS)
+#define ERR_RET 0xFFFFFFFF
+
+// A page of file data, pages are looked up in a 4 way set associative cache
+typedef struct {
+    uint64_t dev;
+    uint64_t ino;
+    uint32_t page;
+    uint32_t len;           // valid bytes, less than a page only at end of file
+    uint32_t lastUsed;      // for LRU replacement, 0 when empty
+    uint8_t data[UVM32_FILES_PAGE_SIZE];
+} cache_page_t;
+
+// Shared by all VMs in this process
+static cache_page_t cache[CACHE_SETS][CACHE_WAYS];
+static uint32_t cache_clock = 0;
+static uvm32_files_stats_t stats;
+static uint8_t readahead_buf[UVM32_FILES_READAHEAD_MAX * UVM32_FILES_PAGE_SIZE];
+
+// consecutive pages of a file land in consecutive sets
+static cache_page_t *cache_set(const uvm32_file_t *f, uint32_t page) {
+    uint32_t h = (uint32_t)((f->dev ^ (f->ino * 2654435761u)) + page);
+    return cache[h % CACHE_SETS];
+}
+
+static cache_page_t *cache_lookup(const uvm32_file_t *f, uint32_t page) {
+    cache_page_t *set = cache_set(f, page);
+    for (int i=0;i<CACHE_WAYS;i++) {
+        cache_page_t *p = &set[i];
+        if (p->lastUsed != 0 && p->page == page && p->ino == f->ino && p->dev == f->dev) {
+            p->lastUsed = ++cache_clock;
+            return p;
+        }
+    }
+    return (cache_page_t *)NULL;
+}
+
+static void cache_insert(const uvm32_file_t *f, uint32_t page, const uint8_t *data, uint32_t len) {
+    cache_page_t *set = cache_set(f, page);
+    cache_page_t *victim = &set[0];
+
+    for (int i=0;i<CACHE_WAYS;i++) {
+        cache_page_t *p = &set[i];
+        if (p->lastUsed != 0 && p->page == page && p->ino == f->ino && p->dev == f->dev) {
+            // already cached, refresh it rather than add a duplicate
+            victim = p;
+            break;
+        }
+        if (p->lastUsed < victim->lastUsed) {
+            victim = p;
+        }
+    }
+    victim->dev = f->dev;
+    victim->ino = f->ino;
+    victim->page = page;
+    victim->len = len;
+    victim->lastUsed = ++cache_clock;
+    memcpy(victim->data, data, len);
+}
+
+// Read count pages starting at page into the cache, with a single read
+static bool cache_fill(const uvm32_file_t *f, uint32_t page, uint32_t count) {
+    uint64_t offset = (uint64_t)page * UVM32_FILES_PAGE_SIZE;
+    uint32_t len = count * UVM32_FILES_PAGE_SIZE;
+
+    if (f->size - offset < len) {
+        len = f->size - offset;
+    }
+    stats.reads++;
+    if (pread(f->fd, readahead_buf, len, offset) != (ssize_t)len) {
+        return false;
+    }
+    for (uint32_t i=0;i*UVM32_FILES_PAGE_SIZE < len;i++) {
+        uint32_t plen = len - i*UVM32_FILES_PAGE_SIZE;
+        if (plen > UVM32_FILES_PAGE_SIZE) {
+            plen = UVM32_FILES_PAGE_SIZE;
+        }
+        cache_insert(f, page + i, &readahead_buf[i*UVM32_FILES_PAGE_SIZE], plen);
+    }
+    return true;
+}
+
+// Find page in the cache, reading it on a miss. A miss while reading sequentially
+// doubles the readahead window, a miss elsewhere resets it
+static const cache_page_t *get_page(uvm32_file_t *f, uint32_t page) {
+    const cache_page_t *p = cache_lookup(f, page);
+
+    if (p != NULL) {
+        stats.hits++;
+    } else {
+        stats.misses++;
+        if (page == f->nextPage) {
+            f->readahead *= 2;
+            if (f->readahead > UVM32_FILES_READAHEAD_MAX) {
+                f->readahead = UVM32_FILES_READAHEAD_MAX;
+            }
+        } else {
+            f->readahead = 1;
+        }
+        if (!cache_fill(f, page, f->readahead)) {
+            return (cache_page_t *)NULL;
+        }
+        p = cache_lookup(f, page);
+    }
+    f->nextPage = page + 1;
+    return p;
+}
+
+// Open path below the directory open as dirfd, one component at a time. Symlinks
+// and ".." are refused, so nothing swapped in while opening can lead outside it
+static int open_below(int dirfd, const char *path) {
+    char name[PATH_MAX];
+    int fd = dirfd;
+
+    while (1) {
+        const char *end = strchr(path, '/');
+        size_t len = end != NULL ? (size_t)(end - path) : strlen(path);
+
+        if (len == 0 && end != NULL) {
+            path = end + 1;
+            continue;
+        }
+        if (len == 0 || len >= sizeof(name)) {
+            break;
+        }
+        memcpy(name, path, len);
+        name[len] = '\0';
+        if (strcmp(name, "..") == 0) {
+            break;
+        }
+        int next = openat(fd, name, O_RDONLY | O_NOFOLLOW | (end != NULL ? O_DIRECTORY : 0));
+        if (fd != dirfd) {
+            close(fd);
+        }
+        if (next < 0) {
+            return -1;
+        }
+        fd = next;
+        if (end == NULL) {
+            return fd;
+        }
+        path = end + 1;
+    }
+    if (fd != dirfd) {
+        close(fd);
+    }
+    return -1;
+}
+
+// Open path relative to one of the allowed directories, refusing anything which leads outside them
+static int open_allowed(const uvm32_files_t *fs, const char *path) {
+    if (path[0] == '\0' || path[0] == '/') {
+        return -1;
+    }
+    for (uint32_t i=0;i<fs->numDirs;i++) {
+        int fd = open_below(fs->dirs[i], path);
+        if (fd >= 0) {
+            return fd;
+        }
+    }
+    return -1;
+}
+
+static uvm32_file_t *get_file(uvm32_files_t *fs, uint32_t handle) {
+    if (handle < UVM32_FILES_MAX_OPEN && fs->files[handle].fd >= 0) {
+        return &fs->files[handle];
+    }
+    return (uvm32_file_t *)NULL;
+}
+
+static uint32_t file_open(uvm32_files_t *fs, const char *path) {
+    struct stat st;
+    uint32_t handle;
+    int fd;
+
+    for (handle=0;handle<UVM32_FILES_MAX_OPEN;handle++) {
+        if (fs->files[handle].fd < 0) {
+            break;
+        }
+    }
+    if (handle == UVM32_FILES_MAX_OPEN) {
+        return ERR_RET;
+    }
+    if ((fd = open_allowed(fs, path)) < 0) {
+        return ERR_RET;
+    }
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size > UINT32_MAX - 1) {
+        close(fd);
+        return ERR_RET;
+    }
+    fs->files[handle].fd = fd;
+    fs->files[handle].dev = st.st_dev;
+    fs->files[handle].ino = st.st_ino;
+    fs->files[handle].size = st.st_size;
+    fs->files[handle].pos = 0;
+    fs->files[handle].nextPage = 0;
+    fs->files[handle].readahead = 1;
+    return handle;
+}
+
+static uint32_t file_read(uvm32_file_t *f, uvm32_slice_t buf) {
+    uint32_t n = 0;
+
+    while (n < buf.len && f->pos < f->size) {
+        const cache_page_t *p = get_page(f, f->pos / UVM32_FILES_PAGE_SIZE);
+        if (p == NULL) {
+            return n > 0 ? n : ERR_RET;
+        }
+        uint32_t offset = f->pos % UVM32_FILES_PAGE_SIZE;
+        uint32_t chunk = p->len - offset;
+        if (chunk > buf.len - n) {
+            chunk = buf.len - n;
+        }
+        memcpy(&buf.ptr[n], &p->data[offset], chunk);
+        n += chunk;
+        f->pos += chunk;
+    }
+    return n;
+}
+
+static uint32_t file_seek(uvm32_file_t *f, int32_t offset, uint32_t whence) {
+    int64_t pos;
+
+    switch(whence) {
+        case UVM32_SEEK_SET:
+            pos = offset;
+        break;
+        case UVM32_SEEK_CUR:
+            pos = (int64_t)f->pos + offset;
+        break;
+        case UVM32_SEEK_END:
+            pos = (int64_t)f->size + offset;
+        break;
+        default:
+            return ERR_RET;
+    }
+    if (pos < 0 || pos > f->size) {
+        return ERR_RET;
+    }
+    f->pos = (uint32_t)pos;
+    return f->pos;
+}
+
+void uvm32_files_init(uvm32_files_t *fs) {
+    fs->numDirs = 0;
+    for (int i=0;i<UVM32_FILES_MAX_OPEN;i++) {
+        fs->files[i].fd = -1;
+    }
+}
+
+bool uvm32_files_allow(uvm32_files_t *fs, const char *dir) {
+    int fd;
+
+    if (fs->numDirs >= UVM32_FILES_MAX_DIRS) {
+        return false;
+    }
+    // held open, files are opened relative to it
+    if ((fd = open(dir, O_RDONLY | O_DIRECTORY)) < 0) {
+        return false;
+    }
+    fs->dirs[fs->numDirs++] = fd;
+    return true;
+}
+
+void uvm32_files_free(uvm32_files_t *fs) {
+    for (int i=0;i<UVM32_FILES_MAX_OPEN;i++) {
+        if (fs->files[i].fd >= 0) {
+            close(fs->files[i].fd);
+            fs->files[i].fd = -1;
+        }
+    }
+    for (uint32_t i=0;i<fs->numDirs;i++) {
+        close(fs->dirs[i]);
+    }
+    fs->numDirs = 0;
+}
+
+bool uvm32_files_syscall(uvm32_files_t *fs, uvm32_state_t *vmst, uvm32_evt_t *evt) {
+    switch(evt->data.syscall.code) {
+        case UVM32_SYSCALL_FOPEN:
+            uvm32_arg_setval(vmst, evt, RET, file_open(fs, uvm32_arg_getcstr(vmst, evt, ARG0)));
+        break;
+        case UVM32_SYSCALL_FREAD: {
+            uvm32_file_t *f = get_file(fs, uvm32_arg_getval(vmst, evt, ARG0));
+            uint32_t addr = uvm32_arg_getval(vmst, evt, ARG1);
+            uint32_t len = uvm32_arg_getval(vmst, evt, ARG2);
+            // buffer is checked to be valid, writable VM memory, data is read straight into it
+            uvm32_slice_t buf = uvm32_arg_getslice_w(vmst, evt, ARG1, ARG2);
+            uint32_t n = ERR_RET;
+            if (f != NULL && buf.len == len) {
+                n = file_read(f, buf);
+            }
+            if (n != ERR_RET && n > 0) {
+                // written by the host, so persist and framebuffer regions see it
+                uvm32_markDirty(vmst, addr, n);
+            }
+            uvm32_arg_setval(vmst, evt, RET, n);
+        } break;
+        case UVM32_SYSCALL_FSEEK: {
+            uvm32_file_t *f = get_file(fs, uvm32_arg_getval(vmst, evt, ARG0));
+            uint32_t offset = uvm32_arg_getval(vmst, evt, ARG1);
+            uint32_t whence = uvm32_arg_getval(vmst, evt, ARG2);
+            uvm32_arg_setval(vmst, evt, RET, f != NULL ? file_seek(f, (int32_t)offset, whence) : ERR_RET);
+        } break;
+        case UVM32_SYSCALL_FSTAT: {
+            uvm32_file_t *f = get_file(fs, uvm32_arg_getval(vmst, evt, ARG0));
+            uvm32_arg_setval(vmst, evt, RET, f != NULL ? f->size : ERR_RET);
+        } break;
+        case UVM32_SYSCALL_FCLOSE: {
+            uvm32_file_t *f = get_file(fs, uvm32_arg_getval(vmst, evt, ARG0));
+            if (f != NULL) {
+                close(f->fd);
+                f->fd = -1;
+            }
+            uvm32_arg_setval(vmst, evt, RET, f != NULL ? 0 : ERR_RET);
+        } break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+uvm32_files_stats_t uvm32_files_getStats(void) {
+    return stats;
+}
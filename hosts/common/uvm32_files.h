@@ -0,0 +1,72 @@
+#ifndef UVM32_FILES_H
+#define UVM32_FILES_H 1
+
+// Reference host implementation of the UVM32_SYSCALL_F* file syscalls
+//
+// Gives VM code read only access to regular files below a per-VM list of
+// allowed directories. File data is served from a page cache shared by every
+// VM in the host process, so many VMs reading the same assets only read them
+// from disk once. Files are assumed not to change while they are cached.
+// The cache is not thread safe, call from a single thread.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "uvm32.h"
+
+#ifndef UVM32_FILES_MAX_DIRS
+#define UVM32_FILES_MAX_DIRS 4          /*! Allowed directories per VM */
+#endif
+#ifndef UVM32_FILES_MAX_OPEN
+#define UVM32_FILES_MAX_OPEN 8          /*! Open files per VM */
+#endif
+#ifndef UVM32_FILES_PAGE_SIZE
+#define UVM32_FILES_PAGE_SIZE 4096      /*! Size of a page in the shared cache */
+#endif
+#ifndef UVM32_FILES_CACHE_PAGES
+#define UVM32_FILES_CACHE_PAGES 256     /*! Pages in the shared cache, must be a multiple of 4 */
+#endif
+#ifndef UVM32_FILES_READAHEAD_MAX
+#define UVM32_FILES_READAHEAD_MAX 16    /*! Largest readahead window in pages */
+#endif
+
+/*! An open file, private */
+typedef struct {
+    int fd;                 /*! Host file descriptor, -1 when not open */
+    uint64_t dev;           /*! Device and inode, identify the file in the shared cache */
+    uint64_t ino;
+    uint32_t size;          /*! Length of file */
+    uint32_t pos;           /*! Current read position */
+    uint32_t nextPage;      /*! Page expected next if reading sequentially */
+    uint32_t readahead;     /*! Current readahead window in pages */
+} uvm32_file_t;
+
+/*! File syscall state for one VM */
+typedef struct {
+    int dirs[UVM32_FILES_MAX_DIRS];     /*! Allowed directories, held open, private */
+    uint32_t numDirs;
+    uvm32_file_t files[UVM32_FILES_MAX_OPEN];
+} uvm32_files_t;
+
+/*! Shared page cache counters */
+typedef struct {
+    uint32_t hits;          /*! Page found in cache */
+    uint32_t misses;        /*! Page had to be read */
+    uint32_t reads;         /*! Reads made from host files, a readahead is a single read */
+} uvm32_files_stats_t;
+
+/*! Setup file syscall state for a VM, with no allowed directories */
+void uvm32_files_init(uvm32_files_t *fs);
+
+/*! Allow VM code to open files in `dir` and below. Returns false if `dir` does not exist or too many directories are allowed */
+bool uvm32_files_allow(uvm32_files_t *fs, const char *dir);
+
+/*! Close all files and release the allowed directories, call when the VM is ended */
+void uvm32_files_free(uvm32_files_t *fs);
+
+/*! Handle a UVM32_SYSCALL_F* syscall. Returns false if the syscall is not a file syscall, so the host should handle it */
+bool uvm32_files_syscall(uvm32_files_t *fs, uvm32_state_t *vmst, uvm32_evt_t *evt);
+
+/*! Read the shared page cache counters */
+uvm32_files_stats_t uvm32_files_getStats(void);
+
+#endif
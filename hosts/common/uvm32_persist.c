@@ -0,0 +1,130 @@
+// for ftruncate() and msync()
+#define _XOPEN_SOURCE 700
+
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "uvm32_persist.h"
+#include "uvm32_common_custom.h"
+
+bool uvm32_persist_open(uvm32_persist_t *p, uvm32_state_t *vmst, const char *filename, uint32_t len) {
+    struct stat st;
+    void *ptr;
+    int fd = open(filename, O_RDWR | O_CREAT, 0644);
+
+    p->ptr = (uint8_t *)NULL;
+    if (fd < 0) {
+        return false;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size > UINT32_MAX) {
+        close(fd);
+        return false;
+    }
+    if (len == 0) {
+        len = st.st_size;
+    }
+    // extend file, new space is sparse so costs nothing until written
+    if (len == 0 || (st.st_size < len && ftruncate(fd, len) != 0)) {
+        close(fd);
+        return false;
+    }
+    ptr = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) {
+        return false;
+    }
+    p->region = uvm32_mapRegion(vmst, UVM32_EXTRAM_BASE, (uint8_t *)ptr, len, UVM32_REGION_RWX);
+    if (p->region < 0) {
+        munmap(ptr, len);
+        return false;
+    }
+    // track writes page by page
+    uint32_t pageshift = 0;
+    while ((1u << pageshift) < (uint32_t)sysconf(_SC_PAGESIZE)) {
+        pageshift++;
+    }
+    const uint32_t words = (((len - 1) >> pageshift) >> 5) + 1;
+    p->bitmap = (uint32_t *)malloc(words * sizeof(uint32_t));
+    if (p->bitmap == NULL || !uvm32_regionTrackDirty(vmst, p->region, p->bitmap, words, pageshift)) {
+        free(p->bitmap);
+        uvm32_unmapRegion(vmst, p->region);
+        munmap(ptr, len);
+        return false;
+    }
+    p->ptr = (uint8_t *)ptr;
+    p->len = len;
+    p->pendingStart = 0;
+    p->pendingEnd = 0;
+    return true;
+}
+
+// msync() needs a page aligned address
+static bool sync_range(uvm32_persist_t *p, uint32_t offset, uint32_t len, int flags) {
+    const uint32_t pagesize = sysconf(_SC_PAGESIZE);
+    uint32_t start = offset & ~(pagesize - 1);
+    return msync(&p->ptr[start], offset + len - start, flags) == 0;
+}
+
+bool uvm32_persist_sync(uvm32_persist_t *p, uvm32_state_t *vmst, bool wait) {
+    uint32_t offset, len;
+
+    if (p->ptr == NULL) {
+        return false;
+    }
+    // visit each run of pages written since the last sync
+    while (uvm32_regionNextDirty(vmst, p->region, &offset, &len)) {
+        if (!sync_range(p, offset, len, wait ? MS_SYNC : MS_ASYNC)) {
+            // still not written back, keep it for the next sync
+            uvm32_markDirty(vmst, UVM32_EXTRAM_BASE + offset, len);
+            return false;
+        }
+        if (!wait) {
+            // remember, so a later checkpoint waits for it
+            if (p->pendingStart == p->pendingEnd) {
+                p->pendingStart = offset;
+                p->pendingEnd = offset + len;
+            } else {
+                if (offset < p->pendingStart) {
+                    p->pendingStart = offset;
+                }
+                if (offset + len > p->pendingEnd) {
+                    p->pendingEnd = offset + len;
+                }
+            }
+        }
+    }
+    if (wait && p->pendingStart != p->pendingEnd) {
+        if (!sync_range(p, p->pendingStart, p->pendingEnd - p->pendingStart, MS_SYNC)) {
+            return false;
+        }
+        p->pendingStart = 0;
+        p->pendingEnd = 0;
+    }
+    return true;
+}
+
+bool uvm32_persist_syscall(uvm32_persist_t *p, uvm32_state_t *vmst, uvm32_evt_t *evt) {
+    switch(evt->data.syscall.code) {
+        case UVM32_SYSCALL_SYNC:
+            uvm32_arg_setval(vmst, evt, RET, uvm32_persist_sync(p, vmst, false) ? 0 : 0xFFFFFFFF);
+        break;
+        case UVM32_SYSCALL_CHECKPOINT:
+            uvm32_arg_setval(vmst, evt, RET, uvm32_persist_sync(p, vmst, true) ? 0 : 0xFFFFFFFF);
+        break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+void uvm32_persist_close(uvm32_persist_t *p, uvm32_state_t *vmst) {
+    if (p->ptr != NULL) {
+        uvm32_persist_sync(p, vmst, true);
+        uvm32_unmapRegion(vmst, p->region);
+        munmap(p->ptr, p->len);
+        free(p->bitmap);
+        p->ptr = (uint8_t *)NULL;
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef UVM32_PERSIST_H
+#define UVM32_PERSIST_H 1
+
+// Reference host implementation of file backed, persistent extram
+//
+// A file is mapped shared at UVM32_EXTRAM_BASE, so VM writes go straight to
+// the host page cache and survive restarts with no copying. Pages are only
+// read from disk as VM code touches them. The UVM32_SYSCALL_SYNC and
+// UVM32_SYSCALL_CHECKPOINT syscalls write back just the pages VM code has
+// changed, found with uvm32_regionNextDirty().
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "uvm32.h"
+
+/*! A persistent extram mapping, private */
+typedef struct {
+    uint8_t *ptr;           /*! Mapped file, or NULL */
+    uint32_t len;           /*! Length of mapping */
+    int region;             /*! Region number in VM */
+    uint32_t *bitmap;       /*! Pages written by VM code */
+    uint32_t pendingStart;  /*! Range passed to a sync, but not yet known to be written */
+    uint32_t pendingEnd;
+} uvm32_persist_t;
+
+/*! Map `len` bytes of `filename` into `vmst` as extram, readable, writable and executable. The file is created or extended to `len` as needed. If `len` is 0, the length of the existing file is used. Returns false on failure */
+bool uvm32_persist_open(uvm32_persist_t *p, uvm32_state_t *vmst, const char *filename, uint32_t len);
+
+/*! Write back the parts of the file changed by VM code. If `wait` is true, do not return until the data is on disk. Returns false on failure */
+bool uvm32_persist_sync(uvm32_persist_t *p, uvm32_state_t *vmst, bool wait);
+
+/*! Handle UVM32_SYSCALL_SYNC and UVM32_SYSCALL_CHECKPOINT. Returns false if the syscall is neither, so the host should handle it */
+bool uvm32_persist_syscall(uvm32_persist_t *p, uvm32_state_t *vmst, uvm32_evt_t *evt);
+
+/*! Write back any changes and unmap the file from `vmst` */
+void uvm32_persist_close(uvm32_persist_t *p, uvm32_state_t *vmst);
+
+#endif
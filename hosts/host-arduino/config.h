@@ -1,2 +1,10 @@
 // Arduino cannot do -DUVM32_MEMORY_SIZE, so set this explicitly
 #define UVM32_MEMORY_SIZE 512
+// Uncomment to halve the register file, mandel.bin must then be rebuilt with MARCH=rv32em
+//#define UVM32_RV32E
+// Only one extram region is needed, keep the region table small
+#define UVM32_MAX_REGIONS 1
+// No watches are used, leave out the table and the check on every extram store
+#define UVM32_MAX_WATCHES 0
+// Interrupts are not used, leave out the handler state and saved registers
+//#define UVM32_INTERRUPTS
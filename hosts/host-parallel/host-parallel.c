@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <time.h>
 #include "uvm32.h"
 #include "../common/uvm32_common_custom.h"
 
@@ -14,8 +15,38 @@
 
 #include "fib.h"
 
+// clock for the time CSR and UVM32_SYSCALL_WAIT
+static uint64_t micros(void *userdata) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Called when the scheduled vm is waiting. Sleep until the first vm is due, if none are yet.
+// Returns false if every vm still running waits forever
+static bool sleep_until_due(uvm32_state_t *vmst, const uint64_t *wakeAt) {
+    uint64_t first = UVM32_DEADLINE_NONE;
+    uint64_t now;
+
+    for (int i=0;i<NUM_VM;i++) {
+        if (!uvm32_hasEnded(&vmst[i]) && wakeAt[i] < first) {
+            first = wakeAt[i];
+        }
+    }
+    if (first == UVM32_DEADLINE_NONE) {
+        return false;
+    }
+    now = micros(NULL);
+    if (first > now) {
+        struct timespec ts = { (first - now) / 1000000, ((first - now) % 1000000) * 1000 };
+        nanosleep(&ts, NULL);
+    }
+    return true;
+}
+
 int main(int argc, char *argv[]) {
     uvm32_state_t vmst[NUM_VM];
+    uint64_t wakeAt[NUM_VM];    // clock time a waiting vm is due, 0 when runnable
     uvm32_evt_t evt;
     int numVmRunning = NUM_VM;
     int scheduler_index = 0;
@@ -23,6 +54,8 @@ int main(int argc, char *argv[]) {
     for (int i=0;i<NUM_VM;i++) {
         uvm32_init(&vmst[i]);
         uvm32_load(&vmst[i], fib, fib_len);
+        uvm32_setClock(&vmst[i], micros, NULL);
+        wakeAt[i] = 0;
     }
 
     while(numVmRunning > 0) {
@@ -31,7 +64,17 @@ int main(int argc, char *argv[]) {
             SCHEDULE();
             continue;
         }
+        if (wakeAt[scheduler_index] > micros(NULL)) {
+            // parked in UVM32_SYSCALL_WAIT, costs nothing until due
+            if (!sleep_until_due(vmst, wakeAt)) {
+                printf("[all VMs waiting forever]\n");
+                break;
+            }
+            SCHEDULE();
+            continue;
+        }
         uvm32_run(&vmst[scheduler_index], &evt, 100);   // num instructions before vm considered hung
+        wakeAt[scheduler_index] = 0;
 
         switch(evt.typ) {
             case UVM32_EVT_END:
@@ -56,6 +99,10 @@ int main(int argc, char *argv[]) {
                     break;
                 }
             break;
+            case UVM32_EVT_WAITING:
+                // nothing here raises interrupts, so only the deadline can end the wait
+                wakeAt[scheduler_index] = evt.data.wait.deadline;
+            break;
             case UVM32_EVT_ERR:
                 printf("UVM32_EVT_ERR '%s' (%d)\n", evt.data.err.errstr, (int)evt.data.err.errcode);
             break;
@@ -7,7 +7,12 @@
 #include <termios.h>
 #include <signal.h>
 #include <getopt.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "uvm32.h"
+#include "uvm32_files.h"
+#include "uvm32_blit.h"
 
 #include <SDL3/SDL.h>
 #define SDL_MAIN_HANDLED
@@ -35,11 +40,80 @@ static keyevent_t keyBuffer[KEYBUFFER_LEN];
 static int keyBufferWr = 0;
 static int keyBufferRd = 0;
 
-// circular buffer of audio samples, so vm code can read them as it's ready
-#define AUDIOBUFFER_LEN (2048*10)
-static int16_t audioBuffer[AUDIOBUFFER_LEN];
-static int audioBufferWr = 0;
-static int audioBufferRd = 0;
+// Ring of audio samples, written by VM code on the VM thread and drained by
+// audiocb() on SDL's audio thread. The ring itself sits in VM memory once
+// mapped by UVM32_SYSCALL_AUDIOMAP, but audiocb() only trusts audioWr, which
+// the VM thread publishes between runs. Each side only advances its own index
+#define AUDIO_BASE 0x30000000
+#define AUDIO_LEN 16384     // samples, power of 2
+static uvm32_audioring_t *audioRing = NULL;
+static int16_t *audioSamples = NULL;
+static int audioRegion = -1;
+static SDL_AtomicU32 audioWr;   // samples audiocb() may play, set by VM thread
+static SDL_AtomicU32 audioRd;   // samples played, set by audiocb()
+
+// Info page mapped by UVM32_SYSCALL_INFOMAP, read-only to VM code and
+// rewritten by the VM thread before each run. Once mapped, key events go
+// to the page rather than to UVM32_SYSCALL_GETKEY
+#define INFO_BASE 0x31000000
+static uvm32_info_t *info = NULL;
+static int infoRegion = -1;
+static uint32_t infoRandState;
+static SDL_AtomicU32 framesShown;   // set by main thread
+
+// guards key buffer, which is written by the main thread and read by the VM thread
+static SDL_Mutex *keyLock = NULL;
+
+// rows first to last-1 of a frame, empty when first == last
+typedef struct {
+    uint32_t first;
+    uint32_t last;
+} rows_t;
+
+// Frames passed from the VM thread to the main thread for display. Triple
+// buffered, so the VM never waits for the display and the display always has
+// the newest complete frame
+static struct {
+    uint32_t *buf[3];
+    int writing;        // being filled by VM thread
+    int ready;          // newest complete frame
+    int showing;        // being uploaded by main thread
+    bool fresh;         // ready has not been taken by main thread
+    rows_t changed;     // rows of ready which differ from the frame last taken
+    rows_t stale[3];    // rows of each buffer older than the newest frame, VM thread only
+    SDL_Mutex *lock;
+} frames;
+
+// cleared to stop both threads
+static SDL_AtomicInt running;
+
+// signalled by the main thread when a VM waiting in UVM32_SYSCALL_WAIT, or idle, may have something to wake for
+static SDL_Semaphore *wakeSem = NULL;
+
+// syscalls repeated by an idle loop before the VM thread sleeps, see UVM32_IDLE_DETECT
+#define IDLE_SLEEP_AFTER 4
+
+// syscalls which only poll for input or read the time, so are safe to delay when idle.
+// Anything else may have side effects the VM is waiting on, so is answered straight away
+static bool idle_poll(uint32_t code) {
+    switch(code) {
+        case UVM32_SYSCALL_MILLIS:
+        case UVM32_SYSCALL_GETKEY:
+        case UVM32_SYSCALL_GETC:
+        case UVM32_SYSCALL_CANRENDERAUDIO:
+        case UVM32_SYSCALL_YIELD:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// framebuffer mapped into the VM by UVM32_SYSCALL_FBMAP
+#define FB_BASE 0x20000000
+#define FB_BLOCK_SHIFT 8    // track writes in 256 byte blocks
+static uint32_t *fb = NULL;
+static uint32_t *fb_bitmap = NULL;
+static int fb_region = -1;
 
 void profiling_init(uvm32_state_t *vmst) {
     profiling_data = malloc(sizeof(uint32_t) * UVM32_MEMORY_SIZE);
@@ -65,35 +139,91 @@ void profiling_dump(void) {
 }
 
 void key_enq(uint16_t scancode, bool down) {
+    SDL_LockMutex(keyLock);
     keyBuffer[keyBufferWr].scancode = scancode;
     keyBuffer[keyBufferWr].down = down;
 
     keyBufferWr = (keyBufferWr + 1) % KEYBUFFER_LEN;
+    SDL_UnlockMutex(keyLock);
+    SDL_SignalSemaphore(wakeSem);
+}
+
+bool key_pending(void) {
+    bool pending;
+
+    SDL_LockMutex(keyLock);
+    pending = keyBufferWr != keyBufferRd;
+    SDL_UnlockMutex(keyLock);
+    return pending;
 }
 
 bool key_deq(keyevent_t *ke) {
-   if (keyBufferWr != keyBufferRd) {
+    bool ok = false;
+
+    SDL_LockMutex(keyLock);
+    if (keyBufferWr != keyBufferRd) {
         *ke = keyBuffer[keyBufferRd];
         keyBufferRd = (keyBufferRd + 1) % KEYBUFFER_LEN;
-        return true;
-    } else {
+        ok = true;
+    }
+    SDL_UnlockMutex(keyLock);
+    return ok;
+}
+
+static bool audio_init(void) {
+    audioRing = (uvm32_audioring_t *)calloc(1, sizeof(uvm32_audioring_t) + AUDIO_LEN * sizeof(int16_t));
+    if (audioRing == NULL) {
         return false;
     }
+    audioRing->len = AUDIO_LEN;
+    audioSamples = (int16_t *)(audioRing + 1);
+    SDL_SetAtomicU32(&audioWr, 0);
+    SDL_SetAtomicU32(&audioRd, 0);
+    return true;
 }
 
-void audio_enq(int16_t sample) {
-    audioBuffer[audioBufferWr] = sample;
-    audioBufferWr = (audioBufferWr + 1) % AUDIOBUFFER_LEN;
+// VM thread, between runs. Pass samples written by VM code to audiocb() and tell VM code what has been played
+static void audio_publish(void) {
+    const uint32_t rd = SDL_GetAtomicU32(&audioRd);
+    const uint32_t wr = audioRing->wr;
+
+    // ignore a write index which would overrun samples not yet played
+    if (wr - rd <= AUDIO_LEN) {
+        SDL_SetAtomicU32(&audioWr, wr);
+    }
+    audioRing->rd = rd;
+    audioRing->len = AUDIO_LEN;
 }
 
-bool audio_deq(int16_t *sample) {
-   if (audioBufferWr != audioBufferRd) {
-        *sample = audioBuffer[audioBufferRd];
-        audioBufferRd = (audioBufferRd + 1) % AUDIOBUFFER_LEN;
-        return true;
-    } else {
-        return false;
+// VM thread, for UVM32_SYSCALL_RENDERAUDIO. Queue as many samples as there is space for
+static void audio_enq(const uint8_t *samples, uint32_t n) {
+    const uint32_t rd = SDL_GetAtomicU32(&audioRd);
+    uint32_t wr = audioRing->wr;
+    uint32_t space = (wr - rd <= AUDIO_LEN) ? AUDIO_LEN - (wr - rd) : 0;
+
+    if (n > space) {
+        n = space;
+    }
+    while (n > 0) {
+        const uint32_t start = wr & (AUDIO_LEN - 1);
+        const uint32_t chunk = (n < AUDIO_LEN - start) ? n : AUDIO_LEN - start;
+        memcpy(&audioSamples[start], samples, chunk * sizeof(int16_t));
+        samples += chunk * sizeof(int16_t);
+        wr += chunk;
+        n -= chunk;
     }
+    audioRing->wr = wr;
+    audio_publish();
+}
+
+static uint32_t audio_map(uvm32_state_t *vmst) {
+    if (audioRegion < 0) {
+        audioRegion = uvm32_mapRegion(vmst, AUDIO_BASE, (uint8_t *)audioRing, sizeof(uvm32_audioring_t) + AUDIO_LEN * sizeof(int16_t), UVM32_REGION_R | UVM32_REGION_W);
+        if (audioRegion < 0) {
+            return 0xFFFFFFFF;
+        }
+    }
+    return AUDIO_BASE;
 }
 
 
@@ -145,50 +275,470 @@ bool memdump(const char *filename, const uint8_t *buf, int len) {
     return true;
 }
 
+// Map a file read-only, pages are shared with the page cache rather than copied
+static const uint8_t *map_file(const char *filename, uint32_t *len) {
+    struct stat st;
+    void *p;
+    int fd = open(filename, O_RDONLY);
+
+    if (fd < 0) {
+        fprintf(stderr, "error: can't open file '%s'.\n", filename);
+        return NULL;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size == 0 || st.st_size > UINT32_MAX) {
+        fprintf(stderr, "error: bad file size '%s'\n", filename);
+        close(fd);
+        return NULL;
+    }
+    p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        fprintf(stderr, "error: can't map file '%s'\n", filename);
+        return NULL;
+    }
+    *len = st.st_size;
+    return (const uint8_t *)p;
+}
+
+// clock for the time CSR
+uint64_t micros(void *userdata) {
+    return SDL_GetTicksNS() / 1000;
+}
+
+static uint32_t fb_map(uvm32_state_t *vmst, uint32_t w, uint32_t h) {
+    const uint32_t len = WIDTH * HEIGHT * 4;
+    const uint32_t words = (((len - 1) >> FB_BLOCK_SHIFT) >> 5) + 1;
+
+    if (w != (uint32_t)WIDTH || h != (uint32_t)HEIGHT) {
+        return 0xFFFFFFFF;
+    }
+    if (fb_region >= 0) {
+        // already mapped
+        return FB_BASE;
+    }
+    fb = (uint32_t *)calloc(len, 1);
+    fb_bitmap = (uint32_t *)calloc(words, sizeof(uint32_t));
+    if (fb == NULL || fb_bitmap == NULL) {
+        return 0xFFFFFFFF;
+    }
+    fb_region = uvm32_mapRegion(vmst, FB_BASE, (uint8_t *)fb, len, UVM32_REGION_R | UVM32_REGION_W);
+    if (fb_region < 0) {
+        return 0xFFFFFFFF;
+    }
+    uvm32_regionTrackDirty(vmst, fb_region, fb_bitmap, words, FB_BLOCK_SHIFT);
+    return FB_BASE;
+}
+
+// VM thread, before each run
+static void info_update(const uvm32_state_t *vmst) {
+    const uint64_t us = uvm32_getClock(vmst);
+    keyevent_t ke;
+
+    info->micros = (uint32_t)us;
+    info->micros_hi = (uint32_t)(us >> 32);
+    info->millis = (uint32_t)(us / 1000);
+    info->runs++;
+    info->frames = SDL_GetAtomicU32(&framesShown);
+    while (key_deq(&ke)) {
+        info->key_events[info->key_wr & (UVM32_INFO_EVENTS - 1)] = (ke.down ? 0x80000000 : 0) | ke.scancode;
+        info->key_wr++;
+        if (ke.scancode < UVM32_INFO_KEYS) {
+            if (ke.down) {
+                info->keys[ke.scancode >> 5] |= 1u << (ke.scancode & 31);
+            } else {
+                info->keys[ke.scancode >> 5] &= ~(1u << (ke.scancode & 31));
+            }
+        }
+    }
+    // xorshift32, cheap enough to refill every run
+    for (int i=0;i<UVM32_INFO_RAND;i++) {
+        infoRandState ^= infoRandState << 13;
+        infoRandState ^= infoRandState >> 17;
+        infoRandState ^= infoRandState << 5;
+        info->rand[i] = infoRandState;
+    }
+}
+
+static uint32_t info_map(uvm32_state_t *vmst) {
+    if (infoRegion >= 0) {
+        // already mapped
+        return INFO_BASE;
+    }
+    info = (uvm32_info_t *)calloc(1, sizeof(uvm32_info_t));
+    if (info == NULL) {
+        return 0xFFFFFFFF;
+    }
+    infoRegion = uvm32_mapRegion(vmst, INFO_BASE, (uint8_t *)info, sizeof(uvm32_info_t), UVM32_REGION_R);
+    if (infoRegion < 0) {
+        return 0xFFFFFFFF;
+    }
+    infoRandState = (uint32_t)rand() | 1;   // never 0
+    info_update(vmst);
+    return INFO_BASE;
+}
+
+// Expand a row of 8bpp pixels through the palette, unrolled so the lookups can overlap
+static void expand_row(uint32_t *dst, const uint8_t *src, const uint32_t *palette, int n) {
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        dst[i + 0] = palette[src[i + 0]];
+        dst[i + 1] = palette[src[i + 1]];
+        dst[i + 2] = palette[src[i + 2]];
+        dst[i + 3] = palette[src[i + 3]];
+    }
+    for (; i < n; i++) {
+        dst[i] = palette[src[i]];
+    }
+}
+
+static void rows_add(rows_t *r, uint32_t first, uint32_t last) {
+    if (first >= last) {
+        return;
+    }
+    if (r->first == r->last) {
+        r->first = first;
+        r->last = last;
+    } else {
+        if (first < r->first) {
+            r->first = first;
+        }
+        if (last > r->last) {
+            r->last = last;
+        }
+    }
+}
+
+static bool frames_init(void) {
+    for (int i=0;i<3;i++) {
+        frames.buf[i] = (uint32_t *)calloc(WIDTH * HEIGHT, sizeof(uint32_t));
+        if (frames.buf[i] == NULL) {
+            return false;
+        }
+    }
+    frames.writing = 0;
+    frames.ready = 1;
+    frames.showing = 2;
+    frames.lock = SDL_CreateMutex();
+    return frames.lock != NULL;
+}
+
+// VM thread, pass on a frame where only rows [first, last) differ from the last one.
+// pixels is a whole frame, 8bpp if palette is set, otherwise 32bpp
+static void frames_publish(const uint8_t *pixels, const uint32_t *palette, uint32_t first, uint32_t last) {
+    const int w = frames.writing;
+
+    // the buffer being written may be a few frames old, so bring all its out of date rows up to date
+    for (int i=0;i<3;i++) {
+        rows_add(&frames.stale[i], first, last);
+    }
+    for (uint32_t y = frames.stale[w].first; y < frames.stale[w].last; y++) {
+        if (palette != NULL) {
+            expand_row(&frames.buf[w][y * WIDTH], &pixels[y * WIDTH], palette, WIDTH);
+        } else {
+            memcpy(&frames.buf[w][y * WIDTH], &pixels[y * WIDTH * 4], WIDTH * 4);
+        }
+    }
+    frames.stale[w].first = frames.stale[w].last = 0;
+
+    // swap with the ready frame, replacing it if the main thread has not taken it yet
+    SDL_LockMutex(frames.lock);
+    frames.writing = frames.ready;
+    frames.ready = w;
+    rows_add(&frames.changed, first, last);
+    frames.fresh = true;
+    SDL_UnlockMutex(frames.lock);
+}
+
+// Main thread, get the newest frame and the rows which changed since the last one taken, or NULL if none
+static const uint32_t *frames_take(rows_t *rows) {
+    const uint32_t *frame = NULL;
+
+    SDL_LockMutex(frames.lock);
+    if (frames.fresh) {
+        const int s = frames.showing;
+        frames.showing = frames.ready;
+        frames.ready = s;
+        frames.fresh = false;
+        *rows = frames.changed;
+        frames.changed.first = frames.changed.last = 0;
+        frame = frames.buf[frames.showing];
+    }
+    SDL_UnlockMutex(frames.lock);
+    return frame;
+}
+
+// Pass on only the framebuffer rows written since the last present
+static void fb_present(uvm32_state_t *vmst) {
+    const uint32_t pitch = WIDTH * 4;
+    uint32_t offset, len;
+    rows_t rows = {0, 0};
+
+    if (fb_region < 0) {
+        return;
+    }
+    while (uvm32_regionNextDirty(vmst, fb_region, &offset, &len)) {
+        rows_add(&rows, offset / pitch, (offset + len - 1) / pitch + 1);
+    }
+    if (rows.first != rows.last) {
+        frames_publish((const uint8_t *)fb, NULL, rows.first, rows.last);
+    }
+}
+
+// stretch texture to window
+static void show_texture(SDL_Renderer *renderer, SDL_Texture *tex) {
+    SDL_FRect src_rect = {0, 0, WIDTH, HEIGHT };
+    SDL_FRect dst_rect = {0, 0, WINDOW_WIDTH, WINDOW_HEIGHT};
+    SDL_RenderTexture(renderer, tex, &src_rect, &dst_rect);
+    SDL_RenderPresent(renderer);
+}
+
 void usage(const char *name) {
     printf("%s [options] filename.bin\n", name);
     printf("Options:\n");
     printf("  -h                            show help\n");
     printf("  -i <num instructions>         max instrs before requiring a syscall\n");
     printf("  -e <extram size>              numbers of bytes for extram\n");
+    printf("  -a <asset file>               map file read-only at UVM32_ASSET_BASE\n");
+    printf("  -d <dir>                      allow file syscalls to read from dir, may be repeated\n");
+    printf("  -v <instrs per second>        virtual clock, time advances with instructions run\n");
     printf("  -p                            enable profiling\n");
     exit(1);
 }
 
+// SDL audio thread. Samples up to audioWr were written before it was set, so can be copied out in bulk
 void audiocb(void *userdata, SDL_AudioStream *stream, int additional_amount, int total_amount) {
-    if (audioBufferWr == audioBufferRd) { // empty
+    const uint32_t rd = SDL_GetAtomicU32(&audioRd);
+    const uint32_t wr = SDL_GetAtomicU32(&audioWr);
+    uint32_t n = wr - rd;
+
+    if (additional_amount <= 0 || n == 0) {
         return;
     }
-    
-    while(additional_amount > 0) {
-        int16_t sample[2];
+    // always whole stereo pairs
+    if (n > (uint32_t)(additional_amount + 3) / 4 * 2) {
+        n = (uint32_t)(additional_amount + 3) / 4 * 2;
+    }
+    n &= ~1u;
+
+    const uint32_t start = rd & (AUDIO_LEN - 1);
+    const uint32_t first = (n < AUDIO_LEN - start) ? n : AUDIO_LEN - start;
+    if (!SDL_PutAudioStreamData(stream, &audioSamples[start], first * sizeof(int16_t)) ||
+        (n > first && !SDL_PutAudioStreamData(stream, &audioSamples[0], (n - first) * sizeof(int16_t)))) {
+        printf("audio write failed\r\n");
+    }
+    // hand the space back to the VM thread
+    SDL_SetAtomicU32(&audioRd, rd + n);
+}
+
+
+// VM state, owned by the VM thread once started
+typedef struct {
+    uvm32_state_t *vmst;
+    uvm32_files_t *files;
+    uint32_t max_instrs_per_run;
+    uint32_t *extram_buf;
+    uint32_t extram_len;
+    bool use_profiling;
+    bool virtual_clock;         // time comes from instructions run, so is never slept for
+    uint32_t total_instrs;
+    uint32_t num_syscalls;
+    uint32_t frames_seen;       // framesShown when UVM32_IRQ_FRAME was last raised
+} vm_thread_t;
+
+// Run the VM until it ends or the window is closed
+static int vm_thread(void *data) {
+    vm_thread_t *vm = (vm_thread_t *)data;
+    uvm32_state_t *vmst = vm->vmst;
+    uvm32_evt_t evt;
+
+    while (SDL_GetAtomicInt(&running)) {
+        if (vm->use_profiling) {
+            profiling_update(vmst);
+        }
+
+        // VM code only takes the interrupts it has enabled, others stay pending
+        if (key_pending()) {
+            uvm32_interrupt(vmst, UVM32_IRQ_KEY);
+        }
+        const uint32_t shown = SDL_GetAtomicU32(&framesShown);
+        if (shown != vm->frames_seen) {
+            vm->frames_seen = shown;
+            uvm32_interrupt(vmst, UVM32_IRQ_FRAME);
+        }
+        if (infoRegion >= 0) {
+            info_update(vmst);
+        }
+
+        vm->total_instrs += uvm32_run(vmst, &evt, vm->max_instrs_per_run);   // num instructions before vm considered hung
+        vm->num_syscalls++;
+        if (audioRegion >= 0) {
+            audio_publish();
+        }
 
-        // always expect audio in pairs
-        if (audio_deq(&sample[0])) {
-            if (audio_deq(&sample[1])) {
-                if (!SDL_PutAudioStreamData(stream, sample, 4)) {
-                    printf("audio write failed\r\n");
+        switch(evt.typ) {
+            case UVM32_EVT_END:
+                printf("UVM32_EVT_END\n");
+                SDL_SetAtomicInt(&running, 0);
+            break;
+            case UVM32_EVT_WAITING: {
+                // sleep, using no CPU, until the deadline or until the main thread has input or a new frame
+                int32_t ms = -1;
+                if (evt.data.wait.deadline != UVM32_DEADLINE_NONE) {
+                    if (vm->virtual_clock) {
+                        // the next run skips the clock to the deadline
+                        break;
+                    }
+                    const uint64_t now = uvm32_getClock(vmst);
+                    const uint64_t us = evt.data.wait.deadline > now ? evt.data.wait.deadline - now : 0;
+                    ms = us / 1000 >= INT32_MAX ? INT32_MAX : (int32_t)((us + 999) / 1000);
                 }
-            }
-        } else {
-            return;
+                SDL_WaitSemaphoreTimeout(wakeSem, ms);
+            } break;
+            case UVM32_EVT_ERR:
+                printf("UVM32_EVT_ERR '%s' (%d)\n", evt.data.err.errstr, (int)evt.data.err.errcode);
+                if (evt.data.err.errcode == UVM32_ERR_HUNG) {
+                    printf("VM may have hung, increase max_instrs_per_run\n");
+                    uvm32_clearError(vmst);    // allow to continue
+                } else {
+                    SDL_SetAtomicInt(&running, 0);
+                    memdump("host-ram.dump", uvm32_getMemory(vmst), UVM32_MEMORY_SIZE);
+                    printf("memory dumped to host-ram.dump, pc=0x%08x\n", uvm32_getProgramCounter(vmst));
+                    if (vm->extram_buf != NULL) {
+                        memdump("host-extram.dump", (uint8_t *)vm->extram_buf, vm->extram_len);
+                        printf("extram dumped to host-extram.dump\n");
+                    }
+                }
+            break;
+            case UVM32_EVT_SYSCALL:
+                if (evt.data.syscall.idle >= IDLE_SLEEP_AFTER && idle_poll(evt.data.syscall.code)) {
+                    // polling and getting the same answer, let time pass rather than spin
+                    if (vm->virtual_clock) {
+                        uvm32_skipClock(vmst, 1000);
+                    } else {
+                        // until input, a new frame or 1ms
+                        SDL_WaitSemaphoreTimeout(wakeSem, 1);
+                    }
+                }
+                switch(evt.data.syscall.code) {
+                    case UVM32_SYSCALL_PRINTBUF: {
+                        uvm32_slice_t buf = uvm32_arg_getslice(vmst, &evt, ARG0, ARG1);
+                        while(buf.len--) {
+                            printf("%02x", *buf.ptr++);
+                        }
+                    } break;
+                    case UVM32_SYSCALL_YIELD: {
+                        // uint32_t yield_typ = uvm32_arg_getval(vmst, &evt, ARG0);
+                        // printf("YIELD type=%d\n", yield_typ);
+                        // uvm32_arg_setval(vmst, &evt, RET, 123);
+                    } break;
+                    case UVM32_SYSCALL_PRINT: {
+                        const char *str = uvm32_arg_getcstr(vmst, &evt, ARG0);
+                        printf("%s", str);
+                    } break;
+                    case UVM32_SYSCALL_PRINTLN: {
+                        const char *str = uvm32_arg_getcstr(vmst, &evt, ARG0);
+                        printf("%s\n", str);
+                    } break;
+                    case UVM32_SYSCALL_PRINTDEC:
+                        printf("%d", uvm32_arg_getval(vmst, &evt, ARG0));
+                    break;
+                    case UVM32_SYSCALL_PUTC:
+                        printf("%c", uvm32_arg_getval(vmst, &evt, ARG0));
+                    break;
+                    case UVM32_SYSCALL_PRINTHEX:
+                        printf("%08x", uvm32_arg_getval(vmst, &evt, ARG0));
+                    break;
+                    case UVM32_SYSCALL_MILLIS:
+                        uvm32_arg_setval(vmst, &evt, RET, uvm32_getClock(vmst) / 1000);
+                    break;
+                    case UVM32_SYSCALL_RAND:
+                        uvm32_arg_setval(vmst, &evt, RET, rand());
+                    break;
+                    case UVM32_SYSCALL_GETC: {
+                        uvm32_arg_setval(vmst, &evt, RET, 0xFFFFFFFF);
+                    } break;
+                    case UVM32_SYSCALL_CANRENDERAUDIO:
+                        uvm32_arg_setval(vmst, &evt, RET, SDL_GetAtomicU32(&audioWr) == SDL_GetAtomicU32(&audioRd));  // queue is empty
+                    break;
+                    case UVM32_SYSCALL_RENDERAUDIO: {
+                        uvm32_slice_t buf = uvm32_arg_getslice(vmst, &evt, ARG0, ARG1);
+                        audio_enq(buf.ptr, buf.len / 2);
+                    } break;
+                    case UVM32_SYSCALL_AUDIOMAP:
+                        uvm32_arg_setval(vmst, &evt, RET, audio_map(vmst));
+                    break;
+                    case UVM32_SYSCALL_INFOMAP:
+                        uvm32_arg_setval(vmst, &evt, RET, info_map(vmst));
+                    break;
+                    case UVM32_SYSCALL_RENDER: {
+                        uvm32_slice_t buf = uvm32_arg_getslice(vmst, &evt, ARG0, ARG1);
+                        if (buf.len >= (uint32_t)(WIDTH * HEIGHT * 4)) {
+                            frames_publish(buf.ptr, NULL, 0, HEIGHT);
+                        }
+                    } break;
+                    case UVM32_SYSCALL_RENDER8: {
+                        uvm32_slice_t buf = uvm32_arg_getslice(vmst, &evt, ARG0, ARG1);
+                        uvm32_slice_t pal = uvm32_arg_getslice_fixed(vmst, &evt, ARG2, 256 * 4);
+                        uint32_t palette[256];
+
+                        if (buf.len < (uint32_t)(WIDTH * HEIGHT) || pal.len != sizeof(palette)) {
+                            break;
+                        }
+                        // VM memory may not be aligned for the host
+                        memcpy(palette, pal.ptr, sizeof(palette));
+                        frames_publish(buf.ptr, palette, 0, HEIGHT);
+                    } break;
+                    case UVM32_SYSCALL_FBMAP:
+                        uvm32_arg_setval(vmst, &evt, RET, fb_map(vmst, uvm32_arg_getval(vmst, &evt, ARG0), uvm32_arg_getval(vmst, &evt, ARG1)));
+                    break;
+                    case UVM32_SYSCALL_PRESENT:
+                        fb_present(vmst);
+                    break;
+                    case UVM32_SYSCALL_GETKEY: {
+                        keyevent_t ke;
+                        if (key_deq(&ke)) {
+                            uint32_t code = (ke.down ? 0x80000000 : 0) | ke.scancode;
+                            uvm32_arg_setval(vmst, &evt, RET, code);
+                        } else {
+                            uvm32_arg_setval(vmst, &evt, RET, 0xFFFFFFFF);
+                        }
+                    } break;
+                    default:
+                        if (uvm32_files_syscall(vm->files, vmst, &evt)) {
+                            break;
+                        }
+                        if (uvm32_blit_syscall(vmst, &evt)) {
+                            break;
+                        }
+                        printf("Unhandled syscall 0x%08x\n", evt.data.syscall.code);
+                    break;
+                }
+            break;
+            default:
+                printf("Bad evt %d\n", evt.typ);
+                SDL_SetAtomicInt(&running, 0);
+                return 1;
+            break;
         }
-        additional_amount -= 4;
+        fflush(stdout);
     }
-}
 
+    return 0;
+}
 
 int main(int argc, char *argv[]) {
     uvm32_state_t *vmst = NULL;
     uint32_t max_instrs_per_run = 500000;
+    uint32_t virtual_rate = 0;
     char c;
     const char *rom_filename = NULL;
     uint32_t extram_len = 0;
     uint32_t *extram_buf = NULL;
-    uvm32_evt_t evt;
-    bool isrunning = true;
-    uint32_t total_instrs = 0;
-    uint32_t num_syscalls = 0;
+    const char *asset_filename = NULL;
+    uvm32_files_t files;
+    vm_thread_t vm;
+    int status = 0;
+    uint32_t shown = 0;
     int romlen = 0;
     SDL_Renderer *renderer = NULL;
     SDL_Window *screen = NULL;
@@ -203,8 +753,10 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
+    uvm32_files_init(&files);
+
     // parse commandline args
-    while ((c = getopt(argc, argv, "hi:e:W:H:p")) != -1) {
+    while ((c = getopt(argc, argv, "hi:e:a:d:W:H:pv:")) != -1) {
         switch(c) {
             case 'h':
                 usage(argv[0]);
@@ -218,6 +770,21 @@ int main(int argc, char *argv[]) {
             case 'e':
                 extram_len = strtoll(optarg, NULL, 10);
             break;
+            case 'a':
+                asset_filename = optarg;
+            break;
+            case 'd':
+                if (!uvm32_files_allow(&files, optarg)) {
+                    printf("Can't allow directory '%s'\n", optarg);
+                    return 1;
+                }
+            break;
+            case 'v':
+                virtual_rate = strtoll(optarg, NULL, 10);
+                if (virtual_rate < 1) {
+                    usage(argv[0]);
+                }
+            break;
             case 'W':
                 WIDTH = strtoll(optarg, NULL, 10);
             break;
@@ -241,9 +808,12 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
-    srand(clock());
+    // fixed seed with a virtual clock, so runs repeat
+    srand(virtual_rate > 0 ? 1 : clock());
 
     uvm32_init(vmst);
+    uvm32_setClock(vmst, micros, NULL);
+    uvm32_setVirtualClock(vmst, virtual_rate);
 
     if (!uvm32_load(vmst, rom, romlen)) {
         printf("load failed!\n");
@@ -260,6 +830,15 @@ int main(int argc, char *argv[]) {
         uvm32_extram(vmst, (uint8_t *)extram_buf, extram_len);
     }
 
+    if (asset_filename != NULL) {
+        uint32_t asset_len = 0;
+        const uint8_t *asset = map_file(asset_filename, &asset_len);
+        if (NULL == asset || uvm32_mapAsset(vmst, asset, asset_len) < 0) {
+            printf("Failed to map asset!\n");
+            return 1;
+        }
+    }
+
     SDL_SetMainReady();
     if (!SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO)) {
         printf("SDL init failed\n");
@@ -280,6 +859,15 @@ int main(int argc, char *argv[]) {
     render_target = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ABGR8888, SDL_TEXTUREACCESS_STREAMING, WIDTH, HEIGHT);
     SDL_SetTextureScaleMode(render_target, SDL_SCALEMODE_NEAREST);
 
+    keyLock = SDL_CreateMutex();
+    wakeSem = SDL_CreateSemaphore(0);
+    if (NULL == keyLock || NULL == wakeSem || !frames_init() || !audio_init()) {
+        printf("Could not setup frames\n");
+        return 1;
+    }
+    // frames only carry changed rows, so start the texture from the same blank frame
+    SDL_UpdateTexture(render_target, NULL, frames.buf[0], WIDTH * 4);
+
     SDL_AudioSpec srcspec = {
         .format = SDL_AUDIO_S16,
         .channels = 2,
@@ -297,157 +885,88 @@ int main(int argc, char *argv[]) {
         profiling_init(vmst);
     }
 
-    while (isrunning) {
-        SDL_PollEvent(&event);
-
-        switch(event.type) {
-            case SDL_EVENT_QUIT:
-                isrunning = false;
-            break;
-            case SDL_EVENT_KEY_DOWN:
-                if (!event.key.repeat) {
-                    key_enq(event.key.scancode, true);
-                }
-            break;
-            case SDL_EVENT_KEY_UP:
-                if (!event.key.repeat) {
-                    key_enq(event.key.scancode, false);
-                }
-            break;
-        }
-
-        if (use_profiling) {
-            profiling_update(vmst);
-        }
-
-        total_instrs += uvm32_run(vmst, &evt, max_instrs_per_run);   // num instructions before vm considered hung
-        num_syscalls++;
+    vm.vmst = vmst;
+    vm.files = &files;
+    vm.max_instrs_per_run = max_instrs_per_run;
+    vm.extram_buf = extram_buf;
+    vm.extram_len = extram_len;
+    vm.use_profiling = use_profiling;
+    vm.virtual_clock = virtual_rate > 0;
+    vm.total_instrs = 0;
+    vm.num_syscalls = 0;
+    vm.frames_seen = 0;
+
+    SDL_SetAtomicInt(&running, 1);
+    SDL_Thread *thread = SDL_CreateThread(vm_thread, "vm", &vm);
+    if (NULL == thread) {
+        printf("Could not start VM thread\n");
+        return 1;
+    }
 
-        switch(evt.typ) {
-            case UVM32_EVT_END:
-                printf("UVM32_EVT_END\n");
-                isrunning = false;
-            break;
-            case UVM32_EVT_ERR:
-                printf("UVM32_EVT_ERR '%s' (%d)\n", evt.data.err.errstr, (int)evt.data.err.errcode);
-                if (evt.data.err.errcode == UVM32_ERR_HUNG) {
-                    printf("VM may have hung, increase max_instrs_per_run\n");
-                    uvm32_clearError(vmst);    // allow to continue
-                } else {
-                    isrunning = false;
-                    memdump("host-ram.dump", uvm32_getMemory(vmst), UVM32_MEMORY_SIZE);
-                    printf("memory dumped to host-ram.dump, pc=0x%08x\n", uvm32_getProgramCounter(vmst));
-                    if (extram_buf != NULL) {
-                        memdump("host-extram.dump", (uint8_t *)extram_buf, extram_len);
-                        printf("extram dumped to host-extram.dump\n");
+    // The VM runs on its own thread, so it never waits for the display.
+    // This thread handles input and shows the newest frame
+    while (SDL_GetAtomicInt(&running)) {
+        rows_t rows;
+        const uint32_t *frame;
+
+        // drain every pending event, so input is not held up behind frames
+        while (SDL_PollEvent(&event)) {
+            switch(event.type) {
+                case SDL_EVENT_QUIT:
+                    SDL_SetAtomicInt(&running, 0);
+                    SDL_SignalSemaphore(wakeSem);
+                break;
+                case SDL_EVENT_KEY_DOWN:
+                    if (!event.key.repeat) {
+                        key_enq(event.key.scancode, true);
                     }
-                }
-            break;
-            case UVM32_EVT_SYSCALL:
-                switch(evt.data.syscall.code) {
-                    case UVM32_SYSCALL_PRINTBUF: {
-                        uvm32_slice_t buf = uvm32_arg_getslice(vmst, &evt, ARG0, ARG1);
-                        while(buf.len--) {
-                            printf("%02x", *buf.ptr++);
-                        }
-                    } break;
-                    case UVM32_SYSCALL_YIELD: {
-                        // uint32_t yield_typ = uvm32_arg_getval(vmst, &evt, ARG0);
-                        // printf("YIELD type=%d\n", yield_typ);
-                        // uvm32_arg_setval(vmst, &evt, RET, 123);
-                    } break;
-                    case UVM32_SYSCALL_PRINT: {
-                        const char *str = uvm32_arg_getcstr(vmst, &evt, ARG0);
-                        printf("%s", str);
-                    } break;
-                    case UVM32_SYSCALL_PRINTLN: {
-                        const char *str = uvm32_arg_getcstr(vmst, &evt, ARG0);
-                        printf("%s\n", str);
-                    } break;
-                    case UVM32_SYSCALL_PRINTDEC:
-                        printf("%d", uvm32_arg_getval(vmst, &evt, ARG0));
-                    break;
-                    case UVM32_SYSCALL_PUTC:
-                        printf("%c", uvm32_arg_getval(vmst, &evt, ARG0));
-                    break;
-                    case UVM32_SYSCALL_PRINTHEX:
-                        printf("%08x", uvm32_arg_getval(vmst, &evt, ARG0));
-                    break;
-                    case UVM32_SYSCALL_MILLIS: {
-                        uvm32_arg_setval(vmst, &evt, RET, SDL_GetTicks());
-                    } break;
-                    case UVM32_SYSCALL_RAND:
-                        uvm32_arg_setval(vmst, &evt, RET, rand());
-                    break;
-                    case UVM32_SYSCALL_GETC: {
-                        uvm32_arg_setval(vmst, &evt, RET, 0xFFFFFFFF);
-                    } break;
-                    case UVM32_SYSCALL_CANRENDERAUDIO:
-                        uvm32_arg_setval(vmst, &evt, RET, audioBufferWr == audioBufferRd);  // queue is empty
-                    break;
-                    case UVM32_SYSCALL_RENDERAUDIO: {
-                        uvm32_slice_t buf = uvm32_arg_getslice(vmst, &evt, ARG0, ARG1);
-                        int16_t *samples = (int16_t *)buf.ptr;
-                        for (int i=0;i<buf.len/2;i++) {
-                            audio_enq(samples[i]);
-                        }
-                    } break;
-                    case UVM32_SYSCALL_RENDER: {
-                        uvm32_slice_t buf = uvm32_arg_getslice(vmst, &evt, ARG0, ARG1);
-
-                        // copy into texture
-                        void* dst;
-                        const uint8_t* src = buf.ptr;
-                        int src_pitch = WIDTH * 4;
-                        int dst_pitch;
-                        if (SDL_LockTexture(render_target, NULL, &dst, &dst_pitch)) {
-                            for (int y = 0; y < HEIGHT; y++) {
-                                memcpy(dst, src, src_pitch);
-                                dst = (uint8_t*)dst + dst_pitch;
-                                src += src_pitch;
-                            }
-                            SDL_UnlockTexture(render_target);
-                        }
+                break;
+                case SDL_EVENT_KEY_UP:
+                    if (!event.key.repeat) {
+                        key_enq(event.key.scancode, false);
+                    }
+                break;
+            }
+        }
 
-                        // stretch to window
-                        SDL_FRect src_rect = {0, 0, WIDTH, HEIGHT };
-                        SDL_FRect dst_rect = {0, 0, WINDOW_WIDTH, WINDOW_HEIGHT};
-                        SDL_RenderTexture(renderer, render_target, &src_rect, &dst_rect);
-                        SDL_RenderPresent(renderer);
-                    } break;
-                    case UVM32_SYSCALL_GETKEY: {
-                        keyevent_t ke;
-                        if (key_deq(&ke)) {
-                            uint32_t code = (ke.down ? 0x80000000 : 0) | ke.scancode;
-                            uvm32_arg_setval(vmst, &evt, RET, code);
-                        } else {
-                            uvm32_arg_setval(vmst, &evt, RET, 0xFFFFFFFF);
-                        }
-                    } break;
-                    default:
-                        printf("Unhandled syscall 0x%08x\n", evt.data.syscall.code);
-                    break;
-                }
-            break;
-            default:
-                printf("Bad evt %d\n", evt.typ);
-                return 1;
-            break;
+        frame = frames_take(&rows);
+        if (frame != NULL) {
+            if (rows.first != rows.last) {
+                SDL_Rect rect = {0, (int)rows.first, WIDTH, (int)(rows.last - rows.first)};
+                SDL_UpdateTexture(render_target, &rect, &frame[rows.first * WIDTH], WIDTH * 4);
+            }
+            show_texture(renderer, render_target);
+            SDL_SetAtomicU32(&framesShown, ++shown);
+            SDL_SignalSemaphore(wakeSem);
+        } else {
+            SDL_Delay(1);
         }
-        fflush(stdout);
     }
+    SDL_WaitThread(thread, &status);
 
-    printf("Executed total of %lu instructions and %lu syscalls\n", (unsigned long)total_instrs, (unsigned long)num_syscalls);
+    printf("Executed total of %lu instructions and %lu syscalls\n", (unsigned long)vm.total_instrs, (unsigned long)vm.num_syscalls);
 
     if (use_profiling) {
         profiling_dump();
     }
 
     free(rom);
+    uvm32_files_free(&files);
     if (extram_buf != NULL) {
         free(extram_buf);
     }
+    free(fb);
+    free(fb_bitmap);
+    for (int i=0;i<3;i++) {
+        free(frames.buf[i]);
+    }
+    SDL_DestroyAudioStream(stream);
+    free(audioRing);
+    free(info);
+    SDL_DestroyMutex(frames.lock);
+    SDL_DestroyMutex(keyLock);
+    SDL_DestroySemaphore(wakeSem);
 
     // put terminal back to how it was
-    return 0;
+    return status;
 }
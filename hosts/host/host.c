@@ -1,3 +1,6 @@
+// for clock_gettime() and nanosleep()
+#define _XOPEN_SOURCE 700
+
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -7,10 +10,33 @@
 #include <termios.h>
 #include <signal.h>
 #include <getopt.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "uvm32.h"
+#include "uvm32_files.h"
+#include "uvm32_persist.h"
 
 #include "../common/uvm32_common_custom.h"
 
+// syscalls repeated by an idle loop before the host sleeps, see UVM32_IDLE_DETECT
+#define IDLE_SLEEP_AFTER 4
+
+// syscalls which only poll for input or read the time, so are safe to delay when idle.
+// Anything else may have side effects the VM is waiting on, so is answered straight away
+static bool idle_poll(uint32_t code) {
+    switch(code) {
+        case UVM32_SYSCALL_MILLIS:
+        case UVM32_SYSCALL_GETKEY:
+        case UVM32_SYSCALL_GETC:
+        case UVM32_SYSCALL_CANRENDERAUDIO:
+        case UVM32_SYSCALL_YIELD:
+            return true;
+        default:
+            return false;
+    }
+}
+
 // stash terminal settings on startup
 static struct termios orig_termios;
 
@@ -138,31 +164,74 @@ bool memdump(const char *filename, const uint8_t *buf, int len) {
     return true;
 }
 
+// Map a file read-only, pages are shared with the page cache rather than copied
+static const uint8_t *map_file(const char *filename, uint32_t *len) {
+    struct stat st;
+    void *p;
+    int fd = open(filename, O_RDONLY);
+
+    if (fd < 0) {
+        fprintf(stderr, "error: can't open file '%s'.\n", filename);
+        return NULL;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size == 0 || st.st_size > UINT32_MAX) {
+        fprintf(stderr, "error: bad file size '%s'\n", filename);
+        close(fd);
+        return NULL;
+    }
+    p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        fprintf(stderr, "error: can't map file '%s'\n", filename);
+        return NULL;
+    }
+    *len = st.st_size;
+    return (const uint8_t *)p;
+}
+
+// clock for the time CSR, wall time so it keeps counting while idle
+uint64_t micros(void *userdata) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
 void usage(const char *name) {
     printf("%s [options] filename.bin\n", name);
     printf("Options:\n");
     printf("  -h                            show help\n");
     printf("  -i <num instructions>         max instrs before requiring a syscall\n");
     printf("  -e <extram size>              numbers of bytes for extram\n");
+    printf("  -f <extram file>              back extram with file, changes are kept\n");
+    printf("  -a <asset file>               map file read-only at UVM32_ASSET_BASE\n");
+    printf("  -d <dir>                      allow file syscalls to read from dir, may be repeated\n");
+    printf("  -v <instrs per second>        virtual clock, time advances with instructions run\n");
     exit(1);
 }
 
 int main(int argc, char *argv[]) {
     uvm32_state_t vmst;
     uint32_t max_instrs_per_run = 500000;
-    clock_t start_time = clock() / (CLOCKS_PER_SEC / 1000);
+    uint32_t virtual_rate = 0;
+    uint64_t start_time;
     char c;
     const char *rom_filename = NULL;
     uint32_t extram_len = 0;
     uint32_t *extram_buf = NULL;
+    const char *asset_filename = NULL;
+    uvm32_files_t files;
+    const char *persist_filename = NULL;
+    uvm32_persist_t persist = { 0 };
     uvm32_evt_t evt;
     bool isrunning = true;
     uint32_t total_instrs = 0;
     uint32_t num_syscalls = 0;
     int romlen = 0;
 
+    uvm32_files_init(&files);
+
     // parse commandline args
-    while ((c = getopt(argc, argv, "hi:e:")) != -1) {
+    while ((c = getopt(argc, argv, "hi:e:f:a:d:v:")) != -1) {
         switch(c) {
             case 'h':
                 usage(argv[0]);
@@ -176,6 +245,24 @@ int main(int argc, char *argv[]) {
             case 'e':
                 extram_len = strtoll(optarg, NULL, 10);
             break;
+            case 'f':
+                persist_filename = optarg;
+            break;
+            case 'a':
+                asset_filename = optarg;
+            break;
+            case 'd':
+                if (!uvm32_files_allow(&files, optarg)) {
+                    printf("Can't allow directory '%s'\n", optarg);
+                    return 1;
+                }
+            break;
+            case 'v':
+                virtual_rate = strtoll(optarg, NULL, 10);
+                if (virtual_rate < 1) {
+                    usage(argv[0]);
+                }
+            break;
         }
     }
     if (optind < argc) {
@@ -190,16 +277,25 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
-    srand(clock());
+    // fixed seed with a virtual clock, so runs repeat
+    srand(virtual_rate > 0 ? 1 : clock());
 
     uvm32_init(&vmst);
+    uvm32_setClock(&vmst, micros, NULL);
+    uvm32_setVirtualClock(&vmst, virtual_rate);
+    start_time = uvm32_getClock(&vmst) / 1000;
 
     if (!uvm32_load(&vmst, rom, romlen)) {
         printf("load failed!\n");
         return 1;
     }
 
-    if (extram_len > 0) {
+    if (persist_filename != NULL) {
+        if (!uvm32_persist_open(&persist, &vmst, persist_filename, extram_len)) {
+            printf("Failed to map extram file!\n");
+            return 1;
+        }
+    } else if (extram_len > 0) {
         extram_buf = (uint32_t *)malloc(extram_len);
         if (NULL == extram_buf) {
             printf("Failed to allocate extram!\n");
@@ -209,6 +305,15 @@ int main(int argc, char *argv[]) {
         uvm32_extram(&vmst, (uint8_t *)extram_buf, extram_len);
     }
 
+    if (asset_filename != NULL) {
+        uint32_t asset_len = 0;
+        const uint8_t *asset = map_file(asset_filename, &asset_len);
+        if (NULL == asset || uvm32_mapAsset(&vmst, asset, asset_len) < 0) {
+            printf("Failed to map asset!\n");
+            return 1;
+        }
+    }
+
     // setup terminal for getch()
     enableRawMode();
 
@@ -237,6 +342,15 @@ int main(int argc, char *argv[]) {
                 }
             break;
             case UVM32_EVT_SYSCALL:
+                if (evt.data.syscall.idle >= IDLE_SLEEP_AFTER && idle_poll(evt.data.syscall.code)) {
+                    // polling and getting the same answer, let time pass rather than spin
+                    if (virtual_rate > 0) {
+                        uvm32_skipClock(&vmst, 1000);
+                    } else {
+                        struct timespec ts = { 0, 1000000 };
+                        nanosleep(&ts, NULL);
+                    }
+                }
                 switch(evt.data.syscall.code) {
                     case UVM32_SYSCALL_PRINTBUF: {
                         uvm32_slice_t buf = uvm32_arg_getslice(&vmst, &evt, ARG0, ARG1);
@@ -269,10 +383,9 @@ int main(int argc, char *argv[]) {
                     case UVM32_SYSCALL_RAND:
                         uvm32_arg_setval(&vmst, &evt, RET, rand());
                     break;
-                    case UVM32_SYSCALL_MILLIS: {
-                        clock_t now = clock() / (CLOCKS_PER_SEC / 1000);
-                        uvm32_arg_setval(&vmst, &evt, RET, now - start_time);
-                    } break;
+                    case UVM32_SYSCALL_MILLIS:
+                        uvm32_arg_setval(&vmst, &evt, RET, uvm32_getClock(&vmst) / 1000 - start_time);
+                    break;
                     case UVM32_SYSCALL_GETC: {
                         uint8_t c;
                         if (poll_getch(&c)) {
@@ -282,10 +395,28 @@ int main(int argc, char *argv[]) {
                         }
                     } break;
                     default:
+                        if (uvm32_files_syscall(&files, &vmst, &evt) || uvm32_persist_syscall(&persist, &vmst, &evt)) {
+                            break;
+                        }
                         printf("Unhandled syscall 0x%08x\n", evt.data.syscall.code);
                     break;
                 }
             break;
+            case UVM32_EVT_WAITING:
+                // nothing here raises interrupts, so only the deadline can end the wait
+                if (evt.data.wait.deadline == UVM32_DEADLINE_NONE) {
+                    printf("UVM32_EVT_WAITING forever, nothing can wake it\n");
+                    isrunning = false;
+                } else if (virtual_rate == 0) {
+                    // with a virtual clock the next run skips to the deadline instead
+                    const uint64_t now = uvm32_getClock(&vmst);
+                    if (evt.data.wait.deadline > now) {
+                        const uint64_t us = evt.data.wait.deadline - now;
+                        struct timespec ts = { (time_t)(us / 1000000), (long)(us % 1000000) * 1000 };
+                        nanosleep(&ts, NULL);
+                    }
+                }
+            break;
             default:
                 printf("Bad evt %d\n", evt.typ);
                 return 1;
@@ -297,6 +428,8 @@ int main(int argc, char *argv[]) {
     printf("Executed total of %d instructions and %d syscalls\n", (int)total_instrs, (int)num_syscalls);
 
     free(rom);
+    uvm32_files_free(&files);
+    uvm32_persist_close(&persist, &vmst);
     if (extram_buf != NULL) {
         free(extram_buf);
     }
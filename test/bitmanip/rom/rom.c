@@ -0,0 +1,27 @@
+#include "uvm32_target.h"
+#include "../shared.h"
+
+static uint32_t bits(uint32_t x) {
+    // cpop, clz, ctz
+    return __builtin_popcount(x) + __builtin_clz(x) * 100 + __builtin_ctz(x) * 10000;
+}
+
+void main(void) {
+    switch(syscall(SYSCALL_PICKTEST, 0, 0)) {
+        case TEST1:
+            printdec(bits(0x00f0f000));
+        break;
+        case TEST2: {
+            // min, max, sh2add for the indexing, rev8
+            volatile int32_t vals[] = { 5, -3, 12, 7 };
+            int32_t lo = vals[0];
+            int32_t hi = vals[0];
+            for (int i=1;i<4;i++) {
+                lo = vals[i] < lo ? vals[i] : lo;
+                hi = vals[i] > hi ? vals[i] : hi;
+            }
+            printdec(hi - lo);
+            printhex(__builtin_bswap32((uint32_t)hi * 0x11223344));
+        } break;
+    }
+}
@@ -0,0 +1,238 @@
+#include <string.h>
+#include "unity.h"
+#include "uvm32.h"
+#include "../common/uvm32_common_custom.h"
+
+#include "rom-header.h"
+#include "../shared.h"
+
+static uvm32_state_t vmst;
+static uvm32_evt_t evt;
+
+void setUp(void) {
+    uvm32_init(&vmst);
+    uvm32_load(&vmst, rom_bin, rom_bin_len);
+}
+
+void tearDown(void) {
+}
+
+static void run_code(const uint8_t *code, int len) {
+    uvm32_init(&vmst);
+    uvm32_load(&vmst, code, len);
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+}
+
+void test_rom_counts(void) {
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, SYSCALL_PICKTEST);
+    uvm32_arg_setval(&vmst, &evt, RET, TEST1);
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, UVM32_SYSCALL_PRINTDEC);
+    TEST_ASSERT_EQUAL(8 + 8 * 100 + 12 * 10000, uvm32_arg_getval(&vmst, &evt, ARG0));
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+}
+
+void test_rom_minmax(void) {
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, SYSCALL_PICKTEST);
+    uvm32_arg_setval(&vmst, &evt, RET, TEST2);
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, UVM32_SYSCALL_PRINTDEC);
+    TEST_ASSERT_EQUAL(12 - -3, uvm32_arg_getval(&vmst, &evt, ARG0));
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, UVM32_SYSCALL_PRINTHEX);
+    TEST_ASSERT_EQUAL_HEX32(0x30679acd, uvm32_arg_getval(&vmst, &evt, ARG0));
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+}
+
+void test_zba(void) {
+    uint8_t code[] = {
+        0x13, 0x05, 0x30, 0x00,  // li a0, 3
+        0x93, 0x05, 0x40, 0x06,  // li a1, 100
+        0x33, 0x26, 0xb5, 0x20,  // sh1add a2, a0, a1
+        0xb3, 0x46, 0xb5, 0x20,  // sh2add a3, a0, a1
+        0x33, 0x67, 0xb5, 0x20,  // sh3add a4, a0, a1
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    run_code(code, sizeof(code));
+    TEST_ASSERT_EQUAL(106, (int32_t)vmst._core.regs[12]); // a2
+    TEST_ASSERT_EQUAL(112, (int32_t)vmst._core.regs[13]); // a3
+    TEST_ASSERT_EQUAL(124, (int32_t)vmst._core.regs[14]); // a4
+}
+
+void test_count(void) {
+    uint8_t code[] = {
+        0x37, 0xf5, 0xf0, 0x00,  // lui a0, 0xf0f
+        0x13, 0x05, 0x05, 0x7f,  // addi a0, a0, 0x7f0
+        0x93, 0x15, 0x05, 0x60,  // clz a1, a0
+        0x13, 0x16, 0x15, 0x60,  // ctz a2, a0
+        0x93, 0x16, 0x25, 0x60,  // cpop a3, a0
+        0x13, 0x17, 0x00, 0x60,  // clz a4, zero
+        0x93, 0x17, 0x10, 0x60,  // ctz a5, zero
+        0x13, 0x18, 0x20, 0x60,  // cpop a6, zero
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    run_code(code, sizeof(code));
+    TEST_ASSERT_EQUAL(8, (int32_t)vmst._core.regs[11]); // a1
+    TEST_ASSERT_EQUAL(4, (int32_t)vmst._core.regs[12]); // a2
+    TEST_ASSERT_EQUAL(15, (int32_t)vmst._core.regs[13]); // a3
+    TEST_ASSERT_EQUAL(32, (int32_t)vmst._core.regs[14]); // a4
+    TEST_ASSERT_EQUAL(32, (int32_t)vmst._core.regs[15]); // a5
+    TEST_ASSERT_EQUAL(0, (int32_t)vmst._core.regs[16]); // a6
+}
+
+void test_logic(void) {
+    uint8_t code[] = {
+        0x13, 0x05, 0x80, 0xff,  // li a0, -8
+        0x93, 0x05, 0x50, 0x00,  // li a1, 5
+        0x33, 0x76, 0xb5, 0x40,  // andn a2, a0, a1
+        0xb3, 0xe6, 0xa5, 0x40,  // orn a3, a1, a0
+        0x33, 0x47, 0xb5, 0x40,  // xnor a4, a0, a1
+        0xb3, 0x47, 0xb5, 0x0a,  // min a5, a0, a1
+        0x33, 0x68, 0xb5, 0x0a,  // max a6, a0, a1
+        0xb3, 0x52, 0xb5, 0x0a,  // minu t0, a0, a1
+        0x33, 0x73, 0xb5, 0x0a,  // maxu t1, a0, a1
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    run_code(code, sizeof(code));
+    TEST_ASSERT_EQUAL_HEX32(0xfffffff8, vmst._core.regs[12]); // a2
+    TEST_ASSERT_EQUAL(7, (int32_t)vmst._core.regs[13]); // a3
+    TEST_ASSERT_EQUAL(2, (int32_t)vmst._core.regs[14]); // a4
+    TEST_ASSERT_EQUAL_HEX32(0xfffffff8, vmst._core.regs[15]); // a5
+    TEST_ASSERT_EQUAL(5, (int32_t)vmst._core.regs[16]); // a6
+    TEST_ASSERT_EQUAL(5, (int32_t)vmst._core.regs[5]); // t0
+    TEST_ASSERT_EQUAL_HEX32(0xfffffff8, vmst._core.regs[6]); // t1
+}
+
+void test_extend_and_bytes(void) {
+    uint8_t code[] = {
+        0x37, 0x85, 0x34, 0x12,  // lui a0, 0x12348
+        0x13, 0x05, 0x95, 0xf8,  // addi a0, a0, -0x77
+        0x93, 0x15, 0x45, 0x60,  // sext.b a1, a0
+        0x13, 0x16, 0x55, 0x60,  // sext.h a2, a0
+        0xb3, 0x46, 0x05, 0x08,  // zext.h a3, a0
+        0x13, 0x57, 0x85, 0x69,  // rev8 a4, a0
+        0xb7, 0x02, 0x10, 0x00,  // lui t0, 0x100
+        0x93, 0xd7, 0x72, 0x28,  // orc.b a5, t0
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    run_code(code, sizeof(code));
+    TEST_ASSERT_EQUAL_HEX32(0xffffff89, vmst._core.regs[11]); // a1
+    TEST_ASSERT_EQUAL_HEX32(0x00007f89, vmst._core.regs[12]); // a2
+    TEST_ASSERT_EQUAL_HEX32(0x00007f89, vmst._core.regs[13]); // a3
+    TEST_ASSERT_EQUAL_HEX32(0x897f3412, vmst._core.regs[14]); // a4
+    TEST_ASSERT_EQUAL_HEX32(0x00ff0000, vmst._core.regs[15]); // a5
+}
+
+void test_rotate(void) {
+    uint8_t code[] = {
+        0x37, 0x85, 0x34, 0x12,  // lui a0, 0x12348
+        0x13, 0x05, 0x95, 0xf8,  // addi a0, a0, -0x77
+        0x93, 0x05, 0x80, 0x00,  // li a1, 8
+        0x33, 0x16, 0xb5, 0x60,  // rol a2, a0, a1
+        0xb3, 0x56, 0xb5, 0x60,  // ror a3, a0, a1
+        0x13, 0x57, 0x45, 0x60,  // rori a4, a0, 4
+        0xb3, 0x17, 0x05, 0x60,  // rol a5, a0, zero
+        0x93, 0x02, 0x80, 0x02,  // li t0, 40
+        0x33, 0x53, 0x55, 0x60,  // ror t1, a0, t0
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    run_code(code, sizeof(code));
+    TEST_ASSERT_EQUAL_HEX32(0x347f8912, vmst._core.regs[12]); // a2
+    TEST_ASSERT_EQUAL_HEX32(0x8912347f, vmst._core.regs[13]); // a3
+    TEST_ASSERT_EQUAL_HEX32(0x912347f8, vmst._core.regs[14]); // a4
+    TEST_ASSERT_EQUAL_HEX32(0x12347f89, vmst._core.regs[15]); // a5
+    TEST_ASSERT_EQUAL_HEX32(0x8912347f, vmst._core.regs[6]); // t1
+}
+
+void test_single_bit(void) {
+    uint8_t code[] = {
+        0x13, 0x05, 0x00, 0x00,  // li a0, 0
+        0x93, 0x02, 0x30, 0x00,  // li t0, 3
+        0x93, 0x15, 0xf5, 0x29,  // bseti a1, a0, 31
+        0x33, 0x16, 0x55, 0x28,  // bset a2, a0, t0
+        0x13, 0xd3, 0xf5, 0x49,  // bexti t1, a1, 31
+        0xb3, 0x53, 0x56, 0x48,  // bext t2, a2, t0
+        0x93, 0x17, 0x36, 0x68,  // binvi a5, a2, 3
+        0x33, 0x18, 0x56, 0x68,  // binv a6, a2, t0
+        0x13, 0x05, 0xf0, 0xff,  // li a0, -1
+        0x93, 0x16, 0x05, 0x48,  // bclri a3, a0, 0
+        0x33, 0x17, 0x55, 0x48,  // bclr a4, a0, t0
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    run_code(code, sizeof(code));
+    TEST_ASSERT_EQUAL_HEX32(0x80000000, vmst._core.regs[11]); // a1
+    TEST_ASSERT_EQUAL(8, (int32_t)vmst._core.regs[12]); // a2
+    TEST_ASSERT_EQUAL(1, (int32_t)vmst._core.regs[6]); // t1
+    TEST_ASSERT_EQUAL(1, (int32_t)vmst._core.regs[7]); // t2
+    TEST_ASSERT_EQUAL(0, (int32_t)vmst._core.regs[15]); // a5
+    TEST_ASSERT_EQUAL(0, (int32_t)vmst._core.regs[16]); // a6
+    TEST_ASSERT_EQUAL_HEX32(0xfffffffe, vmst._core.regs[13]); // a3
+    TEST_ASSERT_EQUAL_HEX32(0xfffffff7, vmst._core.regs[14]); // a4
+}
+
+void test_base_ops_unchanged(void) {
+    uint8_t code[] = {
+        0x13, 0x05, 0x00, 0xff,  // li a0, -16
+        0x93, 0x02, 0x20, 0x00,  // li t0, 2
+        0x93, 0x55, 0x25, 0x40,  // srai a1, a0, 2
+        0x33, 0x56, 0x55, 0x40,  // sra a2, a0, t0
+        0xb3, 0x06, 0x55, 0x40,  // sub a3, a0, t0
+        0x33, 0x07, 0x55, 0x02,  // mul a4, a0, t0
+        0x93, 0x97, 0x42, 0x00,  // slli a5, t0, 4
+        0x13, 0x58, 0xc5, 0x01,  // srli a6, a0, 28
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    run_code(code, sizeof(code));
+    TEST_ASSERT_EQUAL(-4, (int32_t)vmst._core.regs[11]); // a1
+    TEST_ASSERT_EQUAL(-4, (int32_t)vmst._core.regs[12]); // a2
+    TEST_ASSERT_EQUAL(-18, (int32_t)vmst._core.regs[13]); // a3
+    TEST_ASSERT_EQUAL(-32, (int32_t)vmst._core.regs[14]); // a4
+    TEST_ASSERT_EQUAL(32, (int32_t)vmst._core.regs[15]); // a5
+    TEST_ASSERT_EQUAL(15, (int32_t)vmst._core.regs[16]); // a6
+}
+
+void test_unsupported_encoding(void) {
+    // clmul is Zbc, which is not implemented
+    uint8_t code[] = {
+        0x13, 0x05, 0x30, 0x00,  // li a0, 3
+        0x93, 0x05, 0x50, 0x00,  // li a1, 5
+        0x33, 0x15, 0xb5, 0x0a,  // clmul a0, a0, a1
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    uvm32_init(&vmst);
+    uvm32_load(&vmst, code, sizeof(code));
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_ERR);
+    TEST_ASSERT_EQUAL(evt.data.err.errcode, UVM32_ERR_INTERNAL_CORE);
+}
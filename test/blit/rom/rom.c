@@ -0,0 +1,23 @@
+#include "uvm32_target.h"
+#include "../shared.h"
+
+void main(void) {
+    switch(syscall(SYSCALL_PICKTEST, 0, 0)) {
+        case TEST1: {
+            // fill a row of pixels in RAM
+            static uint32_t pixels[4];
+            uvm32_blit_t b = { 0 };
+            b.op = UVM32_BLIT_FILL;
+            b.colour = 0xFF0000FF;
+            b.dst.pixels = (uint32_t)pixels;
+            b.dst.width = 4;
+            b.dst.height = 1;
+            b.dst.pitch = sizeof(pixels);
+            b.dst.format = UVM32_BLIT_RGBA8888;
+            b.dw = 4;
+            b.dh = 1;
+            printhex(blit(&b));
+            printhex(pixels[3]);
+        } break;
+    }
+}
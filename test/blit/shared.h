@@ -0,0 +1,6 @@
+#define SYSCALL_BASE 0x200
+#define SYSCALL_PICKTEST SYSCALL_BASE+0
+
+enum {
+    TEST1,
+};
@@ -0,0 +1,192 @@
+#include <string.h>
+#include "unity.h"
+#include "uvm32.h"
+#include "uvm32_blit.h"
+#include "../common/uvm32_common_custom.h"
+
+#include "rom-header.h"
+#include "../shared.h"
+
+static uvm32_state_t vmst;
+static uvm32_evt_t evt;
+
+static uint8_t extram[4096];
+
+// makes a syscall each time it is run, registers are set by the test
+static const uint8_t syscall_loop[] = {
+    0x73, 0x00, 0x00, 0x00,  // ecall
+    0x6f, 0xf0, 0xdf, 0xff,  // j -4
+};
+
+void setUp(void) {
+    // runs before each test
+    uvm32_init(&vmst);
+    uvm32_load(&vmst, rom_bin, rom_bin_len);
+    memset(extram, 0x00, sizeof(extram));
+    uvm32_extram(&vmst, extram, sizeof(extram));
+}
+
+void tearDown(void) {
+}
+
+void test_rom_blit_fill(void) {
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, SYSCALL_PICKTEST);
+    uvm32_arg_setval(&vmst, &evt, RET, TEST1);
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(true, uvm32_blit_syscall(&vmst, &evt));
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, UVM32_SYSCALL_PRINTHEX);
+    TEST_ASSERT_EQUAL_HEX32(0, uvm32_arg_getval(&vmst, &evt, ARG0));
+
+    // last pixel of the row, in VM RAM
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, UVM32_SYSCALL_PRINTHEX);
+    TEST_ASSERT_EQUAL_HEX32(0xFF0000FF, uvm32_arg_getval(&vmst, &evt, ARG0));
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+}
+
+static uint32_t pixel_at(uint32_t offset) {
+    uint32_t v;
+    memcpy(&v, &extram[offset], sizeof(v));
+    return v;
+}
+
+static void set_pixel(uint32_t offset, uint32_t v) {
+    memcpy(&extram[offset], &v, sizeof(v));
+}
+
+// 8x4 RGBA surface at start of extram
+static const uvm32_surface_t blit_dst = { UVM32_EXTRAM_BASE, 8, 4, 32, UVM32_BLIT_RGBA8888 };
+
+void test_blit_fill_clip(void) {
+    uvm32_blit_t b = { .op = UVM32_BLIT_FILL, .colour = 0x11223344, .dst = blit_dst, .dx = -2, .dy = 1, .dw = 4, .dh = 10 };
+
+    TEST_ASSERT_EQUAL(true, uvm32_blit(&vmst, &b));
+    // clipped to columns 0-1, rows 1-3
+    TEST_ASSERT_EQUAL_HEX32(0, pixel_at(0));
+    TEST_ASSERT_EQUAL_HEX32(0x11223344, pixel_at(32));
+    TEST_ASSERT_EQUAL_HEX32(0x11223344, pixel_at(32 + 4));
+    TEST_ASSERT_EQUAL_HEX32(0, pixel_at(32 + 8));
+    TEST_ASSERT_EQUAL_HEX32(0x11223344, pixel_at(96 + 4));
+
+    // wholly outside does nothing
+    b.dx = 8;
+    b.colour = 0;
+    TEST_ASSERT_EQUAL(true, uvm32_blit(&vmst, &b));
+    TEST_ASSERT_EQUAL_HEX32(0x11223344, pixel_at(32));
+}
+
+void test_blit_copy_colorkey_convert(void) {
+    const uint8_t grey[] = { 0, 100, 0, 200 };
+    memcpy(&extram[256], grey, sizeof(grey));
+    uvm32_blit_t b = { .op = UVM32_BLIT_COPY, .flags = UVM32_BLIT_COLORKEY, .colour = 0, .dst = blit_dst, .dx = 5, .dy = 2,
+        .src = { UVM32_EXTRAM_BASE + 256, 4, 1, 4, UVM32_BLIT_L8 }, .sx = 0, .sy = 0, .sw = 4, .sh = 1 };
+
+    set_pixel(64 + 20, 0x12345678);
+    TEST_ASSERT_EQUAL(true, uvm32_blit(&vmst, &b));
+    // key colour skipped, grey expanded, clipped at column 8
+    TEST_ASSERT_EQUAL_HEX32(0x12345678, pixel_at(64 + 20));
+    TEST_ASSERT_EQUAL_HEX32(0xFF646464, pixel_at(64 + 24));
+    TEST_ASSERT_EQUAL_HEX32(0, pixel_at(64 + 28));
+    TEST_ASSERT_EQUAL_HEX32(0, pixel_at(96));
+}
+
+void test_blit_alpha(void) {
+    set_pixel(0, 0xFF000000);
+    set_pixel(512, 0x800000FF);
+    uvm32_blit_t b = { .op = UVM32_BLIT_COPY, .flags = UVM32_BLIT_ALPHA, .dst = blit_dst,
+        .src = { UVM32_EXTRAM_BASE + 512, 1, 1, 4, UVM32_BLIT_RGBA8888 }, .sw = 1, .sh = 1 };
+
+    TEST_ASSERT_EQUAL(true, uvm32_blit(&vmst, &b));
+    TEST_ASSERT_EQUAL_HEX32(0xFF000080, pixel_at(0));
+}
+
+void test_blit_scale(void) {
+    set_pixel(512, 0xFF000000);
+    set_pixel(516, 0xFF0000FF);
+    uvm32_blit_t b = { .op = UVM32_BLIT_SCALE, .dst = blit_dst, .dw = 4, .dh = 1,
+        .src = { UVM32_EXTRAM_BASE + 512, 2, 1, 8, UVM32_BLIT_RGBA8888 }, .sw = 2, .sh = 1 };
+
+    TEST_ASSERT_EQUAL(true, uvm32_blit(&vmst, &b));
+    TEST_ASSERT_EQUAL_HEX32(0xFF000000, pixel_at(4));
+    TEST_ASSERT_EQUAL_HEX32(0xFF0000FF, pixel_at(8));
+
+    b.flags = UVM32_BLIT_BILINEAR;
+    TEST_ASSERT_EQUAL(true, uvm32_blit(&vmst, &b));
+    TEST_ASSERT_EQUAL_HEX32(0xFF000000, pixel_at(0));
+    TEST_ASSERT_EQUAL_HEX32(0xFF00003F, pixel_at(4));
+    TEST_ASSERT_EQUAL_HEX32(0xFF0000FF, pixel_at(12));
+
+    // src rect must be inside src
+    b.sw = 3;
+    TEST_ASSERT_EQUAL(false, uvm32_blit(&vmst, &b));
+}
+
+// make a blit syscall from syscall_loop with the command at the end of extram
+static uint32_t blit_syscall(const uvm32_blit_t *b) {
+    const uint32_t offset = sizeof(extram) - sizeof(*b);
+    memcpy(&extram[offset], b, sizeof(*b));
+    vmst._core.regs[17] = UVM32_SYSCALL_BLIT;
+    vmst._core.regs[10] = UVM32_EXTRAM_BASE + offset;
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(UVM32_EVT_SYSCALL, evt.typ);
+    TEST_ASSERT_EQUAL(true, uvm32_blit_syscall(&vmst, &evt));
+    return vmst._core.regs[12];
+}
+
+void test_blit_syscall(void) {
+    uint32_t offset, len;
+    uvm32_blit_t b = { .op = UVM32_BLIT_FILL, .colour = 0xFFFFFFFF, .dst = blit_dst, .dx = 0, .dy = 1, .dw = 8, .dh = 1 };
+
+    uvm32_load(&vmst, syscall_loop, sizeof(syscall_loop));
+    TEST_ASSERT_EQUAL_HEX32(0, blit_syscall(&b));
+    TEST_ASSERT_EQUAL_HEX32(0xFFFFFFFF, pixel_at(60));
+    // host writes are seen as dirty
+    TEST_ASSERT_EQUAL(true, uvm32_regionDirtyRange(&vmst, 0, &offset, &len));
+    TEST_ASSERT_EQUAL(32, offset);
+    TEST_ASSERT_EQUAL(32, len);
+
+    b.dst.format = 99;
+    TEST_ASSERT_EQUAL_HEX32(0xFFFFFFFF, blit_syscall(&b));
+    b.dst.format = UVM32_BLIT_RGBA8888;
+    b.dst.pitch = 4;
+    TEST_ASSERT_EQUAL_HEX32(0xFFFFFFFF, blit_syscall(&b));
+
+    // surface runs past end of extram
+    b.dst.pitch = 32;
+    b.dst.height = 1000;
+    blit_syscall(&b);
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(UVM32_EVT_ERR, evt.typ);
+    TEST_ASSERT_EQUAL(UVM32_ERR_MEM_WR, evt.data.err.errcode);
+}
+
+void test_blit_asset(void) {
+    static const uint32_t asset[4] = { 0xFF0000FF, 0xFF00FF00, 0xFFFF0000, 0xFFFFFFFF };
+    uvm32_blit_t b = { .op = UVM32_BLIT_COPY, .dst = blit_dst,
+        .src = { 0x40000000, 4, 1, 16, UVM32_BLIT_RGBA8888 }, .sw = 4, .sh = 1 };
+
+    uvm32_load(&vmst, syscall_loop, sizeof(syscall_loop));
+    uvm32_mapAsset(&vmst, (const uint8_t *)asset, sizeof(asset));
+    // asset window may be a source
+    TEST_ASSERT_EQUAL_HEX32(0, blit_syscall(&b));
+    TEST_ASSERT_EQUAL_HEX32(0xFF00FF00, pixel_at(4));
+
+    // but not a destination
+    b.dst = b.src;
+    b.src = blit_dst;
+    TEST_ASSERT_EQUAL_HEX32(0xFFFFFFFF, blit_syscall(&b));
+    TEST_ASSERT_EQUAL_HEX32(0xFF0000FF, asset[0]);
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(UVM32_EVT_ERR, evt.typ);
+    TEST_ASSERT_EQUAL(UVM32_ERR_MEM_WR, evt.data.err.errcode);
+}
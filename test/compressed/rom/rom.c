@@ -0,0 +1,31 @@
+#include "uvm32_target.h"
+#include "../shared.h"
+
+static uint32_t fib(uint32_t n) {
+    if (n < 2) {
+        return n;
+    }
+    return fib(n - 1) + fib(n - 2);
+}
+
+static uint32_t add(uint32_t a, uint32_t b) { return a + b; }
+static uint32_t sub(uint32_t a, uint32_t b) { return a - b; }
+static uint32_t shl(uint32_t a, uint32_t b) { return a << b; }
+
+void main(void) {
+    switch(syscall(SYSCALL_PICKTEST, 0, 0)) {
+        case TEST1:
+            // recursion, exercises c.jal/c.jr and sp relative loads/stores
+            printdec(fib(20));
+        break;
+        case TEST2: {
+            // indirect calls, exercises c.jalr
+            uint32_t (* volatile ops[])(uint32_t, uint32_t) = { add, sub, shl };
+            uint32_t acc = 7;
+            for (int i=0;i<3;i++) {
+                acc = ops[i](acc, 3);
+            }
+            printdec(acc);
+        } break;
+    }
+}
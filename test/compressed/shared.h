@@ -0,0 +1,7 @@
+#define SYSCALL_BASE 0x200
+#define SYSCALL_PICKTEST SYSCALL_BASE+0
+
+enum {
+    TEST1,
+    TEST2,
+};
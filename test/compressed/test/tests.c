@@ -0,0 +1,108 @@
+#include <string.h>
+#include "unity.h"
+#include "uvm32.h"
+#include "../common/uvm32_common_custom.h"
+
+#include "rom-header.h"
+#include "../shared.h"
+
+static uvm32_state_t vmst;
+static uvm32_evt_t evt;
+
+void setUp(void) {
+    uvm32_init(&vmst);
+    uvm32_load(&vmst, rom_bin, rom_bin_len);
+}
+
+void tearDown(void) {
+}
+
+void test_fib(void) {
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, SYSCALL_PICKTEST);
+    uvm32_arg_setval(&vmst, &evt, RET, TEST1);
+
+    uvm32_run(&vmst, &evt, 1000000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, UVM32_SYSCALL_PRINTDEC);
+    TEST_ASSERT_EQUAL(6765, uvm32_arg_getval(&vmst, &evt, ARG0));
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+}
+
+void test_indirect_calls(void) {
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, SYSCALL_PICKTEST);
+    uvm32_arg_setval(&vmst, &evt, RET, TEST2);
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, UVM32_SYSCALL_PRINTDEC);
+    TEST_ASSERT_EQUAL(((7 + 3) - 3) << 3, uvm32_arg_getval(&vmst, &evt, ARG0));
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+}
+
+void test_mixed_lengths(void) {
+    uint8_t code[] = {
+        0x55, 0x45,             // c.li a0, 21
+        0x13, 0x05, 0x55, 0x01, // addi a0, a0, 21 (only 2 byte aligned)
+        0xb7, 0x08, 0x00, 0x01, // lui a7, 0x1000 (UVM32_SYSCALL_HALT)
+        0x73, 0x00, 0x00, 0x00, // ecall
+    };
+
+    uvm32_init(&vmst);
+    uvm32_load(&vmst, code, sizeof(code));
+    TEST_ASSERT_EQUAL(4, uvm32_run(&vmst, &evt, 100));
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+    TEST_ASSERT_EQUAL(42, vmst._core.regs[10]);
+}
+
+void test_compressed_link_address(void) {
+    uint8_t code[] = {
+        0x11, 0x20,             // c.jal 4
+        0x01, 0x00,             // c.nop (skipped)
+        0xb7, 0x08, 0x00, 0x01, // lui a7, 0x1000 (UVM32_SYSCALL_HALT)
+        0x73, 0x00, 0x00, 0x00, // ecall
+    };
+
+    uvm32_init(&vmst);
+    uvm32_load(&vmst, code, sizeof(code));
+    TEST_ASSERT_EQUAL(3, uvm32_run(&vmst, &evt, 100));
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+    // return address is after the 2 byte c.jal
+    TEST_ASSERT_EQUAL(0x80000002, vmst._core.regs[1]);
+}
+
+void test_illegal_compressed(void) {
+    uint8_t code[] = {
+        0x00, 0x00,             // all zero is defined to be illegal
+    };
+
+    uvm32_init(&vmst);
+    uvm32_load(&vmst, code, sizeof(code));
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_ERR);
+    TEST_ASSERT_EQUAL(evt.data.err.errcode, UVM32_ERR_INTERNAL_CORE);
+}
+
+void test_pc_unaligned_odd(void) {
+    vmst._core.pc = 0x80000000 + 1;
+    uvm32_run(&vmst, &evt, 1);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_ERR);
+    TEST_ASSERT_EQUAL(evt.data.err.errcode, UVM32_ERR_INTERNAL_CORE);
+}
+
+void test_split_instruction_at_end_of_memory(void) {
+    // lower half of a 32 bit instruction in the last 2 bytes of memory
+    vmst._memory[UVM32_MEMORY_SIZE - 2] = 0x03;
+    vmst._memory[UVM32_MEMORY_SIZE - 1] = 0x00;
+    vmst._core.pc = 0x80000000 + UVM32_MEMORY_SIZE - 2;
+    uvm32_run(&vmst, &evt, 1);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_ERR);
+    TEST_ASSERT_EQUAL(evt.data.err.errcode, UVM32_ERR_INTERNAL_CORE);
+}
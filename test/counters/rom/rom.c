@@ -0,0 +1,18 @@
+#include "uvm32_target.h"
+#include "../shared.h"
+
+void main(void) {
+    switch(syscall(SYSCALL_PICKTEST, 0, 0)) {
+        case TEST1: {
+            uint64_t t = rdtime64();
+            printhex((uint32_t)(t >> 32));
+            printhex((uint32_t)t);
+        } break;
+        case TEST2: {
+            // the syscalls above have already retired some instructions
+            uint32_t a = rdinstret();
+            uint32_t b = rdinstret();
+            printdec(a > 0 && b > a);
+        } break;
+    }
+}
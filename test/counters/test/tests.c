@@ -0,0 +1,198 @@
+#include <string.h>
+#include "unity.h"
+#include "uvm32.h"
+#include "../common/uvm32_common_custom.h"
+
+#include "rom-header.h"
+#include "../shared.h"
+
+static uvm32_state_t vmst;
+static uvm32_evt_t evt;
+
+static uint64_t fixed_clock(void *userdata) {
+    return *(uint64_t *)userdata;
+}
+
+static uint64_t now = 0x123456789ULL;
+
+void setUp(void) {
+    uvm32_init(&vmst);
+    uvm32_load(&vmst, rom_bin, rom_bin_len);
+    uvm32_setClock(&vmst, fixed_clock, &now);
+}
+
+void tearDown(void) {
+}
+
+static void run_code(const uint8_t *code, int len) {
+    uvm32_init(&vmst);
+    uvm32_load(&vmst, code, len);
+    uvm32_run(&vmst, &evt, 100);
+}
+
+void test_rom_time(void) {
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, SYSCALL_PICKTEST);
+    uvm32_arg_setval(&vmst, &evt, RET, TEST1);
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, UVM32_SYSCALL_PRINTHEX);
+    TEST_ASSERT_EQUAL_HEX32(0x00000001, uvm32_arg_getval(&vmst, &evt, ARG0));
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, UVM32_SYSCALL_PRINTHEX);
+    TEST_ASSERT_EQUAL_HEX32(0x23456789, uvm32_arg_getval(&vmst, &evt, ARG0));
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+}
+
+void test_rom_instret(void) {
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, SYSCALL_PICKTEST);
+    uvm32_arg_setval(&vmst, &evt, RET, TEST2);
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, UVM32_SYSCALL_PRINTDEC);
+    TEST_ASSERT_EQUAL(1, uvm32_arg_getval(&vmst, &evt, ARG0));
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+}
+
+void test_instret_cycle(void) {
+    uint8_t code[] = {
+        0x13, 0x00, 0x00, 0x00,  // nop
+        0x13, 0x00, 0x00, 0x00,  // nop
+        0x73, 0x25, 0x20, 0xc0,  // rdinstret a0
+        0xf3, 0x25, 0x00, 0xc0,  // rdcycle a1
+        0x73, 0x26, 0x20, 0xc8,  // rdinstreth a2
+        0x73, 0x65, 0x20, 0xc0,  // csrrsi a0, instret, 0
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    run_code(code, sizeof(code));
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+    TEST_ASSERT_EQUAL(5, vmst._core.regs[10]); // a0
+    TEST_ASSERT_EQUAL(3, vmst._core.regs[11]); // a1
+    TEST_ASSERT_EQUAL(0, vmst._core.regs[12]); // a2
+}
+
+void test_instret_across_runs(void) {
+    uint8_t code[] = {
+        0x93, 0x08, 0x00, 0x20,  // li a7, 0x200
+        0x73, 0x00, 0x00, 0x00,  // ecall
+        0x73, 0x25, 0x20, 0xc0,  // rdinstret a0
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    run_code(code, sizeof(code));
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+    TEST_ASSERT_EQUAL(2, vmst._core.regs[10]); // a0
+}
+
+void test_time(void) {
+    uint8_t code[] = {
+        0x73, 0x25, 0x10, 0xc0,  // rdtime a0
+        0xf3, 0x25, 0x10, 0xc8,  // rdtimeh a1
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    uvm32_init(&vmst);
+    uvm32_setClock(&vmst, fixed_clock, &now);
+    uvm32_load(&vmst, code, sizeof(code));
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+    TEST_ASSERT_EQUAL_HEX32(0x23456789, vmst._core.regs[10]); // a0
+    TEST_ASSERT_EQUAL_HEX32(0x00000001, vmst._core.regs[11]); // a1
+}
+
+void test_time_no_clock(void) {
+    uint8_t code[] = {
+        0x73, 0x25, 0x10, 0xc0,  // rdtime a0
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    run_code(code, sizeof(code));
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_ERR);
+    TEST_ASSERT_EQUAL(evt.data.err.errcode, UVM32_ERR_INTERNAL_CORE);
+}
+
+void test_counter_write(void) {
+    uint8_t code[] = {
+        0x73, 0x10, 0x05, 0xc0,  // csrw cycle, a0
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    run_code(code, sizeof(code));
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_ERR);
+    TEST_ASSERT_EQUAL(evt.data.err.errcode, UVM32_ERR_INTERNAL_CORE);
+}
+
+void test_counter_set_bits(void) {
+    uint8_t code[] = {
+        0x73, 0xa5, 0x05, 0xc0,  // csrrs a0, cycle, a1
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    run_code(code, sizeof(code));
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_ERR);
+    TEST_ASSERT_EQUAL(evt.data.err.errcode, UVM32_ERR_INTERNAL_CORE);
+}
+
+void test_virtual_time(void) {
+    uint8_t code[] = {
+        0x13, 0x00, 0x00, 0x00,  // nop
+        0x13, 0x00, 0x00, 0x00,  // nop
+        0x13, 0x00, 0x00, 0x00,  // nop
+        0x73, 0x25, 0x10, 0xc0,  // rdtime a0
+        0xf3, 0x25, 0x10, 0xc8,  // rdtimeh a1
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    // replaces the host clock, 2us per instruction
+    uvm32_init(&vmst);
+    uvm32_setClock(&vmst, fixed_clock, &now);
+    uvm32_setVirtualClock(&vmst, 500000);
+    uvm32_load(&vmst, code, sizeof(code));
+    TEST_ASSERT_EQUAL(0, uvm32_getClock(&vmst));
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+    TEST_ASSERT_EQUAL(6, vmst._core.regs[10]); // a0
+    TEST_ASSERT_EQUAL(0, vmst._core.regs[11]); // a1
+    TEST_ASSERT_EQUAL(vmst._instret * 2, uvm32_getClock(&vmst));
+
+    uvm32_skipClock(&vmst, 1000);
+    TEST_ASSERT_EQUAL(vmst._instret * 2 + 1000, uvm32_getClock(&vmst));
+
+    // back to the host clock
+    uvm32_setVirtualClock(&vmst, 0);
+    TEST_ASSERT_EQUAL(now, uvm32_getClock(&vmst));
+}
+
+void test_virtual_time_large(void) {
+    uvm32_init(&vmst);
+    uvm32_setVirtualClock(&vmst, 1000);
+    // instret * 1000000 would overflow
+    vmst._instret = 1ULL << 46;
+    TEST_ASSERT_TRUE((1ULL << 46) * 1000 == uvm32_getClock(&vmst));
+
+    // no clock at all
+    uvm32_setVirtualClock(&vmst, 0);
+    uvm32_skipClock(&vmst, 1000);
+    TEST_ASSERT_EQUAL(0, uvm32_getClock(&vmst));
+}
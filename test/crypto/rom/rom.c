@@ -0,0 +1,92 @@
+#include "uvm32_target.h"
+#include "uvm32_crypto.h"
+#include "../shared.h"
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static uint32_t h[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+// "abc", already padded
+static uint32_t w[64] = { 0x61626380, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x18 };
+
+static void sha256_block(void) {
+    uint32_t s[8];
+
+    for (int i=16;i<64;i++) {
+        w[i] = sha256sig1(w[i-2]) + w[i-7] + sha256sig0(w[i-15]) + w[i-16];
+    }
+    for (int i=0;i<8;i++) {
+        s[i] = h[i];
+    }
+    for (int i=0;i<64;i++) {
+        uint32_t t1 = s[7] + sha256sum1(s[4]) + ((s[4] & s[5]) ^ (~s[4] & s[6])) + sha256_k[i] + w[i];
+        uint32_t t2 = sha256sum0(s[0]) + ((s[0] & s[1]) ^ (s[0] & s[2]) ^ (s[1] & s[2]));
+        for (int j=7;j>0;j--) {
+            s[j] = s[j-1];
+        }
+        s[4] += t1;
+        s[0] = t1 + t2;
+    }
+    for (int i=0;i<8;i++) {
+        h[i] += s[i];
+    }
+}
+
+// FIPS 197 appendix C.1, as little endian words
+static uint32_t rk[44] = { 0x03020100, 0x07060504, 0x0b0a0908, 0x0f0e0d0c };
+static const uint32_t plain[4] = { 0x33221100, 0x77665544, 0xbbaa9988, 0xffeeddcc };
+static const uint8_t rcon[10] = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36 };
+
+static uint32_t aes128_encrypt_word0(void) {
+    for (int i=4;i<44;i+=4) {
+        uint32_t x = (rk[i-1] >> 8) | (rk[i-1] << 24);
+        uint32_t t = rcon[i/4 - 1];
+        t = aes32esi(t, x, 0);
+        t = aes32esi(t, x, 1);
+        t = aes32esi(t, x, 2);
+        t = aes32esi(t, x, 3);
+        rk[i] = rk[i-4] ^ t;
+        rk[i+1] = rk[i-3] ^ rk[i];
+        rk[i+2] = rk[i-2] ^ rk[i+1];
+        rk[i+3] = rk[i-1] ^ rk[i+2];
+    }
+
+    uint32_t t0 = plain[0] ^ rk[0];
+    uint32_t t1 = plain[1] ^ rk[1];
+    uint32_t t2 = plain[2] ^ rk[2];
+    uint32_t t3 = plain[3] ^ rk[3];
+    for (int r=1;r<10;r++) {
+        const uint32_t *k = rk + r * 4;
+        uint32_t u0 = k[0], u1 = k[1], u2 = k[2], u3 = k[3];
+        u0 = aes32esmi(u0, t0, 0); u0 = aes32esmi(u0, t1, 1); u0 = aes32esmi(u0, t2, 2); u0 = aes32esmi(u0, t3, 3);
+        u1 = aes32esmi(u1, t1, 0); u1 = aes32esmi(u1, t2, 1); u1 = aes32esmi(u1, t3, 2); u1 = aes32esmi(u1, t0, 3);
+        u2 = aes32esmi(u2, t2, 0); u2 = aes32esmi(u2, t3, 1); u2 = aes32esmi(u2, t0, 2); u2 = aes32esmi(u2, t1, 3);
+        u3 = aes32esmi(u3, t3, 0); u3 = aes32esmi(u3, t0, 1); u3 = aes32esmi(u3, t1, 2); u3 = aes32esmi(u3, t2, 3);
+        t0 = u0; t1 = u1; t2 = u2; t3 = u3;
+    }
+    return aes32esi(aes32esi(aes32esi(aes32esi(rk[40], t0, 0), t1, 1), t2, 2), t3, 3);
+}
+
+void main(void) {
+    switch(syscall(SYSCALL_PICKTEST, 0, 0)) {
+        case TEST1:
+            sha256_block();
+            printhex(h[0]);
+            printhex(h[7]);
+        break;
+        case TEST2:
+            printhex(aes128_encrypt_word0());
+        break;
+    }
+}
@@ -0,0 +1,194 @@
+#include <string.h>
+#include "unity.h"
+#include "uvm32.h"
+#include "../common/uvm32_common_custom.h"
+
+#include "rom-header.h"
+#include "../shared.h"
+
+static uvm32_state_t vmst;
+static uvm32_evt_t evt;
+
+void setUp(void) {
+    uvm32_init(&vmst);
+    uvm32_load(&vmst, rom_bin, rom_bin_len);
+}
+
+void tearDown(void) {
+}
+
+static void run_code(const uint8_t *code, int len) {
+    uvm32_init(&vmst);
+    uvm32_load(&vmst, code, len);
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+}
+
+void test_rom_sha256(void) {
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, SYSCALL_PICKTEST);
+    uvm32_arg_setval(&vmst, &evt, RET, TEST1);
+
+    // sha256("abc")
+    uvm32_run(&vmst, &evt, 100000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, UVM32_SYSCALL_PRINTHEX);
+    TEST_ASSERT_EQUAL_HEX32(0xba7816bf, uvm32_arg_getval(&vmst, &evt, ARG0));
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, UVM32_SYSCALL_PRINTHEX);
+    TEST_ASSERT_EQUAL_HEX32(0xf20015ad, uvm32_arg_getval(&vmst, &evt, ARG0));
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+}
+
+void test_rom_aes128(void) {
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, SYSCALL_PICKTEST);
+    uvm32_arg_setval(&vmst, &evt, RET, TEST2);
+
+    // FIPS 197 C.1 ciphertext starts 69c4e0d8
+    uvm32_run(&vmst, &evt, 100000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, UVM32_SYSCALL_PRINTHEX);
+    TEST_ASSERT_EQUAL_HEX32(0xd8e0c469, uvm32_arg_getval(&vmst, &evt, ARG0));
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+}
+
+void test_aes(void) {
+    // S-box of 0 is 0x63, inverse S-box of 0 is 0x52, matching the usual T-tables
+    uint8_t code[] = {
+        0x13, 0x05, 0x00, 0x00,  // li a0, 0
+        0xb3, 0x05, 0xa5, 0x26,  // aes32esmi a1, a0, a0, 0
+        0x33, 0x06, 0xa5, 0x66,  // aes32esmi a2, a0, a0, 1
+        0xb3, 0x06, 0xa5, 0x22,  // aes32esi a3, a0, a0, 0
+        0x33, 0x07, 0xa5, 0x2e,  // aes32dsmi a4, a0, a0, 0
+        0xb3, 0x07, 0xa5, 0x2a,  // aes32dsi a5, a0, a0, 0
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    run_code(code, sizeof(code));
+    TEST_ASSERT_EQUAL_HEX32(0xa56363c6, vmst._core.regs[11]); // a1
+    TEST_ASSERT_EQUAL_HEX32(0x6363c6a5, vmst._core.regs[12]); // a2
+    TEST_ASSERT_EQUAL_HEX32(0x00000063, vmst._core.regs[13]); // a3
+    TEST_ASSERT_EQUAL_HEX32(0x50a7f451, vmst._core.regs[14]); // a4
+    TEST_ASSERT_EQUAL_HEX32(0x00000052, vmst._core.regs[15]); // a5
+}
+
+void test_sha256_sm3(void) {
+    uint8_t code[] = {
+        0x37, 0x55, 0x34, 0x12,  // lui a0, 0x12345
+        0x13, 0x05, 0x85, 0x67,  // addi a0, a0, 0x678
+        0x93, 0x15, 0x25, 0x10,  // sha256sig0 a1, a0
+        0x13, 0x16, 0x35, 0x10,  // sha256sig1 a2, a0
+        0x93, 0x16, 0x05, 0x10,  // sha256sum0 a3, a0
+        0x13, 0x17, 0x15, 0x10,  // sha256sum1 a4, a0
+        0x93, 0x17, 0x85, 0x10,  // sm3p0 a5, a0
+        0x13, 0x18, 0x95, 0x10,  // sm3p1 a6, a0
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    run_code(code, sizeof(code));
+    TEST_ASSERT_EQUAL_HEX32(0xe7fce6ee, vmst._core.regs[11]); // a1
+    TEST_ASSERT_EQUAL_HEX32(0xa1f78649, vmst._core.regs[12]); // a2
+    TEST_ASSERT_EQUAL_HEX32(0x66146474, vmst._core.regs[13]); // a3
+    TEST_ASSERT_EQUAL_HEX32(0x3561abda, vmst._core.regs[14]); // a4
+    TEST_ASSERT_EQUAL_HEX32(0xd6688234, vmst._core.regs[15]); // a5
+    TEST_ASSERT_EQUAL_HEX32(0x05014549, vmst._core.regs[16]); // a6
+}
+
+void test_sha512(void) {
+    // halves of 0x12345678_9abcddef
+    uint8_t code[] = {
+        0x37, 0x55, 0x34, 0x12,  // lui a0, 0x12345
+        0x13, 0x05, 0x85, 0x67,  // addi a0, a0, 0x678
+        0xb7, 0xe2, 0xbc, 0x9a,  // lui t0, 0x9abce
+        0x93, 0x82, 0xf2, 0xde,  // addi t0, t0, -0x211
+        0xb3, 0x05, 0x55, 0x5c,  // sha512sig0h a1, a0, t0
+        0x33, 0x86, 0xa2, 0x54,  // sha512sig0l a2, t0, a0
+        0xb3, 0x06, 0x55, 0x5e,  // sha512sig1h a3, a0, t0
+        0x33, 0x87, 0xa2, 0x56,  // sha512sig1l a4, t0, a0
+        0xb3, 0x87, 0xa2, 0x50,  // sha512sum0r a5, t0, a0
+        0x33, 0x88, 0xa2, 0x52,  // sha512sum1r a6, t0, a0
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    run_code(code, sizeof(code));
+    TEST_ASSERT_EQUAL_HEX32(0x662c77c6, vmst._core.regs[11]); // a1
+    TEST_ASSERT_EQUAL_HEX32(0xc4f1ab91, vmst._core.regs[12]); // a2
+    TEST_ASSERT_EQUAL_HEX32(0x0a5780db, vmst._core.regs[13]); // a3
+    TEST_ASSERT_EQUAL_HEX32(0xbd430f58, vmst._core.regs[14]); // a4
+    TEST_ASSERT_EQUAL_HEX32(0x39ec1abb, vmst._core.regs[15]); // a5
+    TEST_ASSERT_EQUAL_HEX32(0xbbf55677, vmst._core.regs[16]); // a6
+}
+
+void test_crypto_bitmanip(void) {
+    uint8_t code[] = {
+        0x37, 0x55, 0x34, 0x12,  // lui a0, 0x12345
+        0x13, 0x05, 0x85, 0x67,  // addi a0, a0, 0x678
+        0xb7, 0xe2, 0xbc, 0x9a,  // lui t0, 0x9abce
+        0x93, 0x82, 0xf2, 0xde,  // addi t0, t0, -0x211
+        0xb3, 0x45, 0x55, 0x08,  // pack a1, a0, t0
+        0x33, 0x76, 0x55, 0x08,  // packh a2, a0, t0
+        0x93, 0x56, 0x75, 0x68,  // brev8 a3, a0
+        0x13, 0x17, 0xf5, 0x08,  // zip a4, a0
+        0x93, 0x57, 0xf7, 0x08,  // unzip a5, a4
+        0x33, 0x18, 0x55, 0x0a,  // clmul a6, a0, t0
+        0x33, 0x33, 0x55, 0x0a,  // clmulh t1, a0, t0
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    run_code(code, sizeof(code));
+    TEST_ASSERT_EQUAL_HEX32(0xddef5678, vmst._core.regs[11]); // a1
+    TEST_ASSERT_EQUAL_HEX32(0x0000ef78, vmst._core.regs[12]); // a2
+    TEST_ASSERT_EQUAL_HEX32(0x482c6a1e, vmst._core.regs[13]); // a3
+    TEST_ASSERT_EQUAL_HEX32(0x131c1f60, vmst._core.regs[14]); // a4
+    TEST_ASSERT_EQUAL_HEX32(0x12345678, vmst._core.regs[15]); // a5
+    TEST_ASSERT_EQUAL_HEX32(0xcc42a5a8, vmst._core.regs[16]); // a6
+    TEST_ASSERT_EQUAL_HEX32(0x08860ea3, vmst._core.regs[6]); // t1
+}
+
+void test_crossbar_permutation(void) {
+    uint8_t code[] = {
+        0x37, 0x55, 0x34, 0x12,  // lui a0, 0x12345
+        0x13, 0x05, 0x85, 0x67,  // addi a0, a0, 0x678
+        0xb7, 0x02, 0xff, 0x01,  // lui t0, 0x1ff0
+        0x93, 0x82, 0x22, 0x30,  // addi t0, t0, 0x302
+        0xb3, 0x45, 0x55, 0x28,  // xperm8 a1, a0, t0
+        0xb7, 0x42, 0x54, 0x76,  // lui t0, 0x76544
+        0x93, 0x82, 0xf2, 0x8f,  // addi t0, t0, -0x701
+        0x33, 0x26, 0x55, 0x28,  // xperm4 a2, a0, t0
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    run_code(code, sizeof(code));
+    TEST_ASSERT_EQUAL_HEX32(0x56001234, vmst._core.regs[11]); // a1
+    TEST_ASSERT_EQUAL_HEX32(0x12345000, vmst._core.regs[12]); // a2
+}
+
+void test_unsupported_encoding(void) {
+    // sm4ed is Zksed, which is not implemented
+    uint8_t code[] = {
+        0x13, 0x05, 0x10, 0x00,  // li a0, 1
+        0x33, 0x05, 0xa5, 0x30,  // sm4ed a0, a0, a0, 0
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    uvm32_init(&vmst);
+    uvm32_load(&vmst, code, sizeof(code));
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_ERR);
+    TEST_ASSERT_EQUAL(evt.data.err.errcode, UVM32_ERR_INTERNAL_CORE);
+}
@@ -0,0 +1,15 @@
+#include "uvm32_target.h"
+#include "../shared.h"
+
+void main(void) {
+    switch(syscall(SYSCALL_PICKTEST, 0, 0)) {
+        case TEST1:
+            printhex(custom(0, 1, 3, 0x1000, 0x0234));
+            printhex(custom(3, 7, 127, 5, 6));
+        break;
+        case TEST2:
+            // no handler registered for custom-2
+            printhex(custom(2, 0, 0, 1, 2));
+        break;
+    }
+}
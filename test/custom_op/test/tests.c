@@ -0,0 +1,121 @@
+#include <string.h>
+#include "unity.h"
+#include "uvm32.h"
+#include "../common/uvm32_common_custom.h"
+
+#include "rom-header.h"
+#include "../shared.h"
+
+static uvm32_state_t vmst;
+static uvm32_evt_t evt;
+static uint32_t calls;
+
+static uint32_t handler(void *userdata, uint32_t funct3, uint32_t funct7, uint32_t rs1, uint32_t rs2) {
+    (*(uint32_t *)userdata)++;
+    return (funct3 << 24) + (funct7 << 16) + rs1 + rs2;
+}
+
+void setUp(void) {
+    calls = 0;
+    uvm32_init(&vmst);
+    uvm32_load(&vmst, rom_bin, rom_bin_len);
+    uvm32_setCustomOp(&vmst, 0, handler, &calls);
+    uvm32_setCustomOp(&vmst, 3, handler, &calls);
+}
+
+void tearDown(void) {
+}
+
+void test_rom_custom_op(void) {
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, SYSCALL_PICKTEST);
+    uvm32_arg_setval(&vmst, &evt, RET, TEST1);
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, UVM32_SYSCALL_PRINTHEX);
+    TEST_ASSERT_EQUAL_HEX32(0x01031234, uvm32_arg_getval(&vmst, &evt, ARG0));
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, UVM32_SYSCALL_PRINTHEX);
+    TEST_ASSERT_EQUAL_HEX32(0x077f000b, uvm32_arg_getval(&vmst, &evt, ARG0));
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+    TEST_ASSERT_EQUAL(2, calls);
+}
+
+void test_rom_custom_op_unregistered(void) {
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, SYSCALL_PICKTEST);
+    uvm32_arg_setval(&vmst, &evt, RET, TEST2);
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_ERR);
+    TEST_ASSERT_EQUAL(evt.data.err.errcode, UVM32_ERR_INTERNAL_CORE);
+}
+
+void test_custom_op(void) {
+    uint8_t code[] = {
+        0x13, 0x05, 0x50, 0x00,  // li a0, 5
+        0x93, 0x05, 0x70, 0x00,  // li a1, 7
+        0x0b, 0x16, 0xb5, 0x06,  // .insn r 0x0b, 1, 3, a2, a0, a1
+        0xfb, 0x26, 0xb5, 0x0a,  // .insn r 0x7b, 2, 5, a3, a0, a1
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    uvm32_init(&vmst);
+    uvm32_setCustomOp(&vmst, 0, handler, &calls);
+    uvm32_setCustomOp(&vmst, 3, handler, &calls);
+    uvm32_load(&vmst, code, sizeof(code));
+    // handlers run inline, without pausing the VM
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+    TEST_ASSERT_EQUAL_HEX32(0x0103000c, vmst._core.regs[12]); // a2
+    TEST_ASSERT_EQUAL_HEX32(0x0205000c, vmst._core.regs[13]); // a3
+    TEST_ASSERT_EQUAL(2, calls);
+}
+
+void test_custom_op_rd_zero(void) {
+    uint8_t code[] = {
+        0x13, 0x05, 0x50, 0x00,  // li a0, 5
+        0x93, 0x05, 0x70, 0x00,  // li a1, 7
+        0x2b, 0x00, 0xb5, 0x00,  // .insn r 0x2b, 0, 0, zero, a0, a1
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    uvm32_init(&vmst);
+    uvm32_setCustomOp(&vmst, 1, handler, &calls);
+    uvm32_load(&vmst, code, sizeof(code));
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+    TEST_ASSERT_EQUAL(1, calls);
+    TEST_ASSERT_EQUAL_HEX32(0, vmst._core.regs[0]);
+}
+
+void test_custom_op_removed(void) {
+    uint8_t code[] = {
+        0x5b, 0x05, 0xa5, 0x00,  // .insn r 0x5b, 0, 0, a0, a0, a0
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    uvm32_init(&vmst);
+    uvm32_setCustomOp(&vmst, 2, handler, &calls);
+    uvm32_setCustomOp(&vmst, 2, NULL, NULL);
+    uvm32_load(&vmst, code, sizeof(code));
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_ERR);
+    TEST_ASSERT_EQUAL(evt.data.err.errcode, UVM32_ERR_INTERNAL_CORE);
+    TEST_ASSERT_EQUAL(0, calls);
+}
+
+void test_custom_op_range(void) {
+    TEST_ASSERT_TRUE(uvm32_setCustomOp(&vmst, 3, handler, &calls));
+    TEST_ASSERT_FALSE(uvm32_setCustomOp(&vmst, 4, handler, &calls));
+}
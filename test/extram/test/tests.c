@@ -493,3 +493,381 @@ void test_extram_signed_short_read(void) {
     TEST_ASSERT_EQUAL(-4567, (int16_t)uvm32_arg_getval(&vmst, &evt, ARG0));
 }
 
+
+void test_extram_execute(void) {
+    uint8_t code[] = {
+        0xb7, 0x02, 0x00, 0x10,  // lui t0, 0x10000
+        0x67, 0x80, 0x02, 0x00,  // jr t0
+    };
+    uint8_t extcode[] = {
+        0x13, 0x05, 0xa0, 0x02,  // li a0, 42
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    uvm32_load(&vmst, code, sizeof(code));
+    memcpy(extram, extcode, sizeof(extcode));
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(UVM32_EVT_END, evt.typ);
+    TEST_ASSERT_EQUAL(42, vmst._core.regs[10]); // a0
+}
+
+void test_extram_execute_out_of_bounds(void) {
+    uint8_t code[] = {
+        0xb7, 0x02, 0x00, 0x10,  // lui t0, 0x10000
+        0x93, 0x82, 0x02, 0x08,  // addi t0, t0, 128
+        0x67, 0x80, 0x02, 0x00,  // jr t0
+    };
+
+    uvm32_load(&vmst, code, sizeof(code));
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(UVM32_EVT_ERR, evt.typ);
+    TEST_ASSERT_EQUAL(UVM32_ERR_INTERNAL_CORE, evt.data.err.errcode);
+}
+
+void test_region_map(void) {
+    uint32_t ro[4] = { 0x12345678 };
+    uint8_t code[] = {
+        0xb7, 0x02, 0x00, 0x40,  // lui t0, 0x40000
+        0x03, 0xa5, 0x02, 0x00,  // lw a0, 0(t0)
+        0x37, 0x03, 0x00, 0x10,  // lui t1, 0x10000
+        0x23, 0x22, 0xa3, 0x00,  // sw a0, 4(t1)
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    int r = uvm32_mapRegion(&vmst, 0x40000000, (uint8_t *)ro, sizeof(ro), UVM32_REGION_R);
+    TEST_ASSERT_NOT_EQUAL(-1, r);
+    uvm32_load(&vmst, code, sizeof(code));
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(UVM32_EVT_END, evt.typ);
+    TEST_ASSERT_EQUAL_HEX32(0x12345678, extram[1]);
+    TEST_ASSERT_EQUAL(true, uvm32_extramDirty(&vmst));
+    TEST_ASSERT_EQUAL(false, uvm32_regionDirty(&vmst, r));
+}
+
+void test_region_read_only(void) {
+    uint32_t ro[4] = { 0 };
+    uint8_t code[] = {
+        0xb7, 0x02, 0x00, 0x40,  // lui t0, 0x40000
+        0x23, 0xa0, 0xa2, 0x00,  // sw a0, 0(t0)
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    uvm32_mapRegion(&vmst, 0x40000000, (uint8_t *)ro, sizeof(ro), UVM32_REGION_R);
+    uvm32_load(&vmst, code, sizeof(code));
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(UVM32_EVT_ERR, evt.typ);
+    TEST_ASSERT_EQUAL(UVM32_ERR_MEM_WR, evt.data.err.errcode);
+}
+
+void test_region_dirty(void) {
+    uint32_t rw[4] = { 0 };
+    uint8_t code[] = {
+        0xb7, 0x02, 0x00, 0x40,  // lui t0, 0x40000
+        0x23, 0xa0, 0xa2, 0x00,  // sw a0, 0(t0)
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    int r = uvm32_mapRegion(&vmst, 0x40000000, (uint8_t *)rw, sizeof(rw), UVM32_REGION_R | UVM32_REGION_W);
+    uvm32_load(&vmst, code, sizeof(code));
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(UVM32_EVT_END, evt.typ);
+    TEST_ASSERT_EQUAL(true, uvm32_regionDirty(&vmst, r));
+    TEST_ASSERT_EQUAL(true, uvm32_extramDirty(&vmst));
+}
+
+void test_region_no_execute(void) {
+    uint32_t rw[4] = { 0 };
+    uint8_t code[] = {
+        0xb7, 0x02, 0x00, 0x40,  // lui t0, 0x40000
+        0x67, 0x80, 0x02, 0x00,  // jr t0
+    };
+
+    uvm32_mapRegion(&vmst, 0x40000000, (uint8_t *)rw, sizeof(rw), UVM32_REGION_R | UVM32_REGION_W);
+    uvm32_load(&vmst, code, sizeof(code));
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(UVM32_EVT_ERR, evt.typ);
+    TEST_ASSERT_EQUAL(UVM32_ERR_INTERNAL_CORE, evt.data.err.errcode);
+}
+
+void test_region_unmapped(void) {
+    uint32_t rw[4] = { 0 };
+    uint8_t code[] = {
+        0xb7, 0x02, 0x00, 0x40,  // lui t0, 0x40000
+        0x03, 0xa5, 0x02, 0x00,  // lw a0, 0(t0)
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    int r = uvm32_mapRegion(&vmst, 0x40000000, (uint8_t *)rw, sizeof(rw), UVM32_REGION_R);
+    uvm32_unmapRegion(&vmst, r);
+    uvm32_load(&vmst, code, sizeof(code));
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(UVM32_EVT_ERR, evt.typ);
+    TEST_ASSERT_EQUAL(UVM32_ERR_MEM_RD, evt.data.err.errcode);
+}
+
+void test_region_map_invalid(void) {
+    uint8_t buf[16];
+
+    // overlaps extram
+    TEST_ASSERT_EQUAL(-1, uvm32_mapRegion(&vmst, UVM32_EXTRAM_BASE + 4, buf, sizeof(buf), UVM32_REGION_R));
+    // outside the MMIO window
+    TEST_ASSERT_EQUAL(-1, uvm32_mapRegion(&vmst, 0x08000000, buf, sizeof(buf), UVM32_REGION_R));
+    TEST_ASSERT_EQUAL(-1, uvm32_mapRegion(&vmst, UVM32_MMIO_END - 8, buf, sizeof(buf), UVM32_REGION_R));
+    TEST_ASSERT_EQUAL(-1, uvm32_mapRegion(&vmst, 0x40000000, buf, 0, UVM32_REGION_R));
+    // table full
+    for (int i=1;i<UVM32_MAX_REGIONS;i++) {
+        TEST_ASSERT_NOT_EQUAL(-1, uvm32_mapRegion(&vmst, 0x40000000 + i * 16, buf, sizeof(buf), UVM32_REGION_R));
+    }
+    TEST_ASSERT_EQUAL(-1, uvm32_mapRegion(&vmst, 0x50000000, buf, sizeof(buf), UVM32_REGION_R));
+}
+
+void test_region_dirty_range(void) {
+    uint32_t offset, len;
+    uint8_t code[] = {
+        0x37, 0x03, 0x00, 0x10,  // lui t1, 0x10000
+        0x23, 0x24, 0xa3, 0x00,  // sw a0, 8(t1)
+        0x23, 0x00, 0xa3, 0x04,  // sb a0, 64(t1)
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    uvm32_load(&vmst, code, sizeof(code));
+    TEST_ASSERT_EQUAL(false, uvm32_regionDirtyRange(&vmst, 0, &offset, &len));
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(UVM32_EVT_END, evt.typ);
+    // kept after the next run
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(true, uvm32_regionDirtyRange(&vmst, 0, &offset, &len));
+    TEST_ASSERT_EQUAL(8, offset);
+    TEST_ASSERT_EQUAL(57, len);
+    // cleared once read
+    TEST_ASSERT_EQUAL(false, uvm32_regionDirtyRange(&vmst, 0, &offset, &len));
+    TEST_ASSERT_EQUAL(false, uvm32_regionDirtyRange(&vmst, UVM32_MAX_REGIONS, &offset, &len));
+}
+
+void test_region_dirty_bitmap(void) {
+    uint32_t offset, len;
+    uint32_t bitmap[1];
+    uint8_t code[] = {
+        0x37, 0x03, 0x00, 0x10,  // lui t1, 0x10000
+        0x23, 0x24, 0xa3, 0x00,  // sw a0, 8(t1)
+        0xa3, 0x1f, 0xa3, 0x00,  // sh a0, 31(t1)
+        0x23, 0x02, 0xa3, 0x06,  // sb a0, 100(t1)
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    // 16 byte blocks, 128 bytes of extram needs 8 bits
+    TEST_ASSERT_EQUAL(false, uvm32_regionTrackDirty(&vmst, 0, bitmap, 0, 4));
+    TEST_ASSERT_EQUAL(true, uvm32_regionTrackDirty(&vmst, 0, bitmap, 1, 4));
+    uvm32_load(&vmst, code, sizeof(code));
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(UVM32_EVT_END, evt.typ);
+    TEST_ASSERT_EQUAL_HEX32(0x47, bitmap[0]);
+
+    // misaligned sh spans blocks 1 and 2, so joins the sw in block 0
+    TEST_ASSERT_EQUAL(true, uvm32_regionNextDirty(&vmst, 0, &offset, &len));
+    TEST_ASSERT_EQUAL(0, offset);
+    TEST_ASSERT_EQUAL(48, len);
+    TEST_ASSERT_EQUAL(true, uvm32_regionNextDirty(&vmst, 0, &offset, &len));
+    TEST_ASSERT_EQUAL(96, offset);
+    TEST_ASSERT_EQUAL(16, len);
+    TEST_ASSERT_EQUAL(false, uvm32_regionNextDirty(&vmst, 0, &offset, &len));
+    TEST_ASSERT_EQUAL_HEX32(0, bitmap[0]);
+    TEST_ASSERT_EQUAL(false, uvm32_regionDirtyRange(&vmst, 0, &offset, &len));
+}
+
+void test_region_dirty_no_bitmap(void) {
+    uint32_t offset, len;
+    uint8_t code[] = {
+        0x37, 0x03, 0x00, 0x10,  // lui t1, 0x10000
+        0x23, 0x24, 0xa3, 0x00,  // sw a0, 8(t1)
+        0x23, 0x02, 0xa3, 0x06,  // sb a0, 100(t1)
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    // without a bitmap, the whole written range is one run
+    uvm32_load(&vmst, code, sizeof(code));
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(true, uvm32_regionNextDirty(&vmst, 0, &offset, &len));
+    TEST_ASSERT_EQUAL(8, offset);
+    TEST_ASSERT_EQUAL(93, len);
+    TEST_ASSERT_EQUAL(false, uvm32_regionNextDirty(&vmst, 0, &offset, &len));
+}
+
+static const uint8_t watch_code[] = {
+    0x37, 0x03, 0x00, 0x10,  // lui t1, 0x10000
+    0x13, 0x05, 0x50, 0x15,  // li a0, 0x155
+    0x23, 0x20, 0xa3, 0x00,  // sw a0, 0(t1)
+    0x23, 0x08, 0xa3, 0x00,  // sb a0, 16(t1)
+    0x23, 0x2a, 0xa3, 0x00,  // sw a0, 20(t1)
+    0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+    0x73, 0x00, 0x00, 0x00,  // ecall
+};
+
+void test_watch_event(void) {
+    uvm32_load(&vmst, watch_code, sizeof(watch_code));
+    TEST_ASSERT_EQUAL(0, uvm32_watch(&vmst, UVM32_EXTRAM_BASE + 16, 4, NULL, NULL));
+
+    // stops straight after the sb, with the store done
+    TEST_ASSERT_EQUAL(4, uvm32_run(&vmst, &evt, 100));
+    TEST_ASSERT_EQUAL(UVM32_EVT_WATCH, evt.typ);
+    TEST_ASSERT_EQUAL(0, evt.data.watch.watch);
+    TEST_ASSERT_EQUAL_HEX32(UVM32_EXTRAM_BASE + 16, evt.data.watch.addr);
+    TEST_ASSERT_EQUAL_HEX32(0x55, evt.data.watch.val);
+    TEST_ASSERT_EQUAL_HEX32(0x55, extram[4]);
+
+    // sw at 20 is outside the watch
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(UVM32_EVT_END, evt.typ);
+    TEST_ASSERT_EQUAL_HEX32(0x155, extram[5]);
+}
+
+static uint32_t watch_calls;
+static uint32_t watch_addr;
+
+static void watch_cb(void *userdata, uint32_t addr, uint32_t val) {
+    TEST_ASSERT_EQUAL_PTR(&watch_calls, userdata);
+    TEST_ASSERT_EQUAL_HEX32(0x155, val);
+    watch_calls++;
+    watch_addr = addr;
+}
+
+void test_watch_callback(void) {
+    watch_calls = 0;
+    uvm32_load(&vmst, watch_code, sizeof(watch_code));
+    TEST_ASSERT_EQUAL(0, uvm32_watch(&vmst, UVM32_EXTRAM_BASE, 1, NULL, NULL));
+    uvm32_unwatch(&vmst, 0);
+    TEST_ASSERT_EQUAL(0, uvm32_watch(&vmst, UVM32_EXTRAM_BASE + 22, 8, watch_cb, &watch_calls));
+
+    // callback runs inline, so the VM carries on to the end
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(UVM32_EVT_END, evt.typ);
+    TEST_ASSERT_EQUAL(1, watch_calls);
+    TEST_ASSERT_EQUAL_HEX32(UVM32_EXTRAM_BASE + 20, watch_addr);
+}
+
+void test_watch_unmap(void) {
+    uint32_t other[4];
+
+    TEST_ASSERT_EQUAL(0, uvm32_watch(&vmst, UVM32_EXTRAM_BASE, 4, NULL, NULL));
+    TEST_ASSERT_TRUE(vmst._regions[0].watched);
+
+    // removing extram leaves nothing to check
+    uvm32_extram(&vmst, NULL, 0);
+    TEST_ASSERT_FALSE(vmst._regions[0].watched);
+
+    // a replacement is checked again, until unmapped
+    uvm32_extram(&vmst, (uint8_t *)other, sizeof(other));
+    TEST_ASSERT_TRUE(vmst._regions[0].watched);
+    uvm32_unmapRegion(&vmst, 0);
+    TEST_ASSERT_FALSE(vmst._regions[0].watched);
+}
+
+void test_watch_bad(void) {
+    TEST_ASSERT_EQUAL(-1, uvm32_watch(&vmst, UVM32_EXTRAM_BASE, 0, NULL, NULL));
+    TEST_ASSERT_EQUAL(-1, uvm32_watch(&vmst, 0, 4, NULL, NULL));
+    TEST_ASSERT_EQUAL(-1, uvm32_watch(&vmst, UVM32_MMIO_END - 4, 8, NULL, NULL));
+#ifndef UVM32_WATCH_RAM
+    TEST_ASSERT_EQUAL(-1, uvm32_watch(&vmst, 0x80000000, 4, NULL, NULL));
+#endif
+    for (int i=0;i<UVM32_MAX_WATCHES;i++) {
+        TEST_ASSERT_EQUAL(i, uvm32_watch(&vmst, UVM32_EXTRAM_BASE + i * 4, 4, NULL, NULL));
+    }
+    TEST_ASSERT_EQUAL(-1, uvm32_watch(&vmst, UVM32_EXTRAM_BASE, 4, NULL, NULL));
+}
+
+static const uint8_t asset_code[] = {
+    0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+    0x93, 0x88, 0x38, 0x00,  // addi a7, a7, 3
+    0x73, 0x00, 0x00, 0x00,  // ecall
+    0xb7, 0x02, 0x00, 0x40,  // lui t0, 0x40000
+    0x03, 0xa5, 0x02, 0x00,  // lw a0, 0(t0)
+    0x37, 0x03, 0x00, 0x10,  // lui t1, 0x10000
+    0x23, 0x20, 0xa3, 0x00,  // sw a0, 0(t1)
+    0x23, 0x22, 0xc3, 0x00,  // sw a2, 4(t1)
+    0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+    0x73, 0x00, 0x00, 0x00,  // ecall
+};
+
+void test_asset_map(void) {
+    static const uint32_t asset[3] = { 0xcafef00d };
+    static uvm32_state_t vmst2;
+
+    // same buffer shared by two vms
+    TEST_ASSERT_NOT_EQUAL(-1, uvm32_mapAsset(&vmst, (const uint8_t *)asset, sizeof(asset)));
+    uvm32_load(&vmst, asset_code, sizeof(asset_code));
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(UVM32_EVT_END, evt.typ);
+    TEST_ASSERT_EQUAL_HEX32(0xcafef00d, extram[0]);
+    TEST_ASSERT_EQUAL(sizeof(asset), extram[1]);
+
+    memset(extram, 0x00, sizeof(extram));
+    uvm32_init(&vmst2);
+    uvm32_extram(&vmst2, (uint8_t *)extram, sizeof(extram));
+    TEST_ASSERT_NOT_EQUAL(-1, uvm32_mapAsset(&vmst2, (const uint8_t *)asset, sizeof(asset)));
+    uvm32_load(&vmst2, asset_code, sizeof(asset_code));
+    uvm32_run(&vmst2, &evt, 100);
+    TEST_ASSERT_EQUAL(UVM32_EVT_END, evt.typ);
+    TEST_ASSERT_EQUAL_HEX32(0xcafef00d, extram[0]);
+}
+
+void test_asset_slice_read_only(void) {
+    static const uint32_t asset[3] = { 0xcafef00d };
+
+    TEST_ASSERT_NOT_EQUAL(-1, uvm32_mapAsset(&vmst, (const uint8_t *)asset, sizeof(asset)));
+    uvm32_load(&vmst, asset_code, sizeof(asset_code));
+
+    // host may read the asset window
+    uvm32_slice_t buf = uvm32_getslice(&vmst, 0x40000000, sizeof(asset));
+    TEST_ASSERT_EQUAL(sizeof(asset), buf.len);
+    TEST_ASSERT_EQUAL_PTR(asset, buf.ptr);
+
+    // but not write to it, writable extram is fine
+    buf = uvm32_getslice_w(&vmst, UVM32_EXTRAM_BASE, 4);
+    TEST_ASSERT_EQUAL(4, buf.len);
+    buf = uvm32_getslice_w(&vmst, 0x40000000, 4);
+    TEST_ASSERT_EQUAL(0, buf.len);
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(UVM32_EVT_ERR, evt.typ);
+    TEST_ASSERT_EQUAL(UVM32_ERR_MEM_WR, evt.data.err.errcode);
+}
+
+void test_slice_write_only(void) {
+    uint8_t wo[8] = { 'h', 'i', 0 };
+    uint8_t code[] = {
+        0x37, 0x05, 0x00, 0x40,  // lui a0, 0x40000
+        0x93, 0x08, 0x10, 0x00,  // li a7, 1
+        0x73, 0x00, 0x00, 0x00,  // ecall
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    uvm32_mapRegion(&vmst, 0x40000000, wo, sizeof(wo), UVM32_REGION_W);
+    uvm32_load(&vmst, code, sizeof(code));
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(UVM32_EVT_SYSCALL, evt.typ);
+
+    // host may write what VM code can, but not read it back
+    TEST_ASSERT_EQUAL(sizeof(wo), uvm32_getslice_w(&vmst, 0x40000000, sizeof(wo)).len);
+    TEST_ASSERT_EQUAL(0, uvm32_getslice(&vmst, 0x40000000, sizeof(wo)).len);
+    TEST_ASSERT_EQUAL_STRING("", uvm32_arg_getcstr(&vmst, &evt, ARG0));
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(UVM32_EVT_ERR, evt.typ);
+    TEST_ASSERT_EQUAL(UVM32_ERR_MEM_RD, evt.data.err.errcode);
+}
+
+void test_asset_none(void) {
+    // no asset, length is 0 and reading it faults
+    uvm32_load(&vmst, asset_code, sizeof(asset_code));
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(UVM32_EVT_ERR, evt.typ);
+    TEST_ASSERT_EQUAL(UVM32_ERR_MEM_RD, evt.data.err.errcode);
+    TEST_ASSERT_EQUAL(0, vmst._core.regs[12]);
+}
@@ -0,0 +1,24 @@
+#include "uvm32_target.h"
+#include "../shared.h"
+
+void main(void) {
+    char buf[32];
+    uint32_t h;
+    uint32_t n;
+
+    switch(syscall(SYSCALL_PICKTEST, 0, 0)) {
+        case TEST1:
+            h = file_open("hello.txt");
+            printdec(file_size(h));
+            n = file_read(h, buf, sizeof(buf) - 1);
+            buf[n] = '\0';
+            println(buf);
+            file_close(h);
+        break;
+        case TEST2:
+            // outside of the allowed directory
+            printhex(file_open("../Makefile"));
+            printhex(file_open("/etc/passwd"));
+        break;
+    }
+}
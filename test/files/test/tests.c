@@ -0,0 +1,226 @@
+// for symlink()
+#define _XOPEN_SOURCE 700
+
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "unity.h"
+#include "uvm32.h"
+#include "uvm32_files.h"
+#include "../common/uvm32_common_custom.h"
+
+#include "rom-header.h"
+#include "../shared.h"
+
+static uvm32_state_t vmst;
+static uvm32_evt_t evt;
+static uvm32_files_t files;
+
+static uint8_t extram[4096];
+
+// makes a syscall each time it is run, registers are set by the test
+static const uint8_t syscall_loop[] = {
+    0x73, 0x00, 0x00, 0x00,  // ecall
+    0x6f, 0xf0, 0xdf, 0xff,  // j -4
+};
+
+void setUp(void) {
+    // runs before each test
+    uvm32_init(&vmst);
+    uvm32_load(&vmst, rom_bin, rom_bin_len);
+    memset(extram, 0x00, sizeof(extram));
+    uvm32_extram(&vmst, extram, sizeof(extram));
+    uvm32_files_init(&files);
+    uvm32_files_allow(&files, "data");
+}
+
+void tearDown(void) {
+    uvm32_files_free(&files);
+}
+
+// run vm until the next syscall, passing any file syscalls to uvm32_files
+static void run_to_syscall(void) {
+    while(1) {
+        uvm32_run(&vmst, &evt, 1000);
+        if (evt.typ != UVM32_EVT_SYSCALL || !uvm32_files_syscall(&files, &vmst, &evt)) {
+            return;
+        }
+    }
+}
+
+// make a file syscall from syscall_loop, returning a2
+static uint32_t file_syscall(uint32_t code, uint32_t a0, uint32_t a1, uint32_t a3) {
+    vmst._core.regs[17] = code;
+    vmst._core.regs[10] = a0;
+    vmst._core.regs[11] = a1;
+    vmst._core.regs[13] = a3;
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(UVM32_EVT_SYSCALL, evt.typ);
+    TEST_ASSERT_EQUAL(true, uvm32_files_syscall(&files, &vmst, &evt));
+    return vmst._core.regs[12];
+}
+
+void test_rom_file_read(void) {
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, SYSCALL_PICKTEST);
+    uvm32_arg_setval(&vmst, &evt, RET, TEST1);
+
+    run_to_syscall();
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, UVM32_SYSCALL_PRINTDEC);
+    TEST_ASSERT_EQUAL(11, uvm32_arg_getval(&vmst, &evt, ARG0));
+
+    run_to_syscall();
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, UVM32_SYSCALL_PRINTLN);
+    TEST_ASSERT_EQUAL_STRING("hello world", uvm32_arg_getcstr(&vmst, &evt, ARG0));
+
+    run_to_syscall();
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+}
+
+void test_rom_file_outside_allowed(void) {
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, SYSCALL_PICKTEST);
+    uvm32_arg_setval(&vmst, &evt, RET, TEST2);
+
+    run_to_syscall();
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, UVM32_SYSCALL_PRINTHEX);
+    TEST_ASSERT_EQUAL_HEX32(0xFFFFFFFF, uvm32_arg_getval(&vmst, &evt, ARG0));
+
+    run_to_syscall();
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, UVM32_SYSCALL_PRINTHEX);
+    TEST_ASSERT_EQUAL_HEX32(0xFFFFFFFF, uvm32_arg_getval(&vmst, &evt, ARG0));
+
+    run_to_syscall();
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+}
+
+void test_file_seek(void) {
+    uvm32_load(&vmst, syscall_loop, sizeof(syscall_loop));
+    strcpy((char *)extram, "hello.txt");
+
+    uint32_t h = file_syscall(UVM32_SYSCALL_FOPEN, UVM32_EXTRAM_BASE, 0, 0);
+    TEST_ASSERT_EQUAL(0, h);
+    TEST_ASSERT_EQUAL(6, file_syscall(UVM32_SYSCALL_FSEEK, h, (uint32_t)-5, UVM32_SEEK_END));
+    TEST_ASSERT_EQUAL(5, file_syscall(UVM32_SYSCALL_FREAD, h, UVM32_EXTRAM_BASE + 16, 100));
+    TEST_ASSERT_EQUAL_MEMORY("world", &extram[16], 5);
+    // at end of file
+    TEST_ASSERT_EQUAL(0, file_syscall(UVM32_SYSCALL_FREAD, h, UVM32_EXTRAM_BASE + 16, 100));
+    TEST_ASSERT_EQUAL(2, file_syscall(UVM32_SYSCALL_FSEEK, h, 2, UVM32_SEEK_SET));
+    TEST_ASSERT_EQUAL(3, file_syscall(UVM32_SYSCALL_FSEEK, h, 1, UVM32_SEEK_CUR));
+    // beyond end of file
+    TEST_ASSERT_EQUAL_HEX32(0xFFFFFFFF, file_syscall(UVM32_SYSCALL_FSEEK, h, 12, UVM32_SEEK_SET));
+    TEST_ASSERT_EQUAL_HEX32(0xFFFFFFFF, file_syscall(UVM32_SYSCALL_FSEEK, h, 0, 3));
+}
+
+void test_file_open_paths(void) {
+    uvm32_load(&vmst, syscall_loop, sizeof(syscall_loop));
+
+    strcpy((char *)extram, "./hello.txt");
+    TEST_ASSERT_EQUAL(0, file_syscall(UVM32_SYSCALL_FOPEN, UVM32_EXTRAM_BASE, 0, 0));
+    // leads back into the allowed directory, but through ..
+    strcpy((char *)extram, "../data/hello.txt");
+    TEST_ASSERT_EQUAL_HEX32(0xFFFFFFFF, file_syscall(UVM32_SYSCALL_FOPEN, UVM32_EXTRAM_BASE, 0, 0));
+
+    // symlinks are never followed, wherever they point
+    remove("data/link.txt");
+    TEST_ASSERT_EQUAL(0, symlink("hello.txt", "data/link.txt"));
+    strcpy((char *)extram, "link.txt");
+    TEST_ASSERT_EQUAL_HEX32(0xFFFFFFFF, file_syscall(UVM32_SYSCALL_FOPEN, UVM32_EXTRAM_BASE, 0, 0));
+    remove("data/link.txt");
+}
+
+void test_file_bad_handle(void) {
+    uvm32_load(&vmst, syscall_loop, sizeof(syscall_loop));
+    TEST_ASSERT_EQUAL_HEX32(0xFFFFFFFF, file_syscall(UVM32_SYSCALL_FREAD, 3, UVM32_EXTRAM_BASE, 16));
+    TEST_ASSERT_EQUAL_HEX32(0xFFFFFFFF, file_syscall(UVM32_SYSCALL_FSTAT, UVM32_FILES_MAX_OPEN, 0, 0));
+    TEST_ASSERT_EQUAL_HEX32(0xFFFFFFFF, file_syscall(UVM32_SYSCALL_FCLOSE, 0, 0, 0));
+}
+
+void test_file_read_bad_buffer(void) {
+    uvm32_load(&vmst, syscall_loop, sizeof(syscall_loop));
+    strcpy((char *)extram, "hello.txt");
+
+    uint32_t h = file_syscall(UVM32_SYSCALL_FOPEN, UVM32_EXTRAM_BASE, 0, 0);
+    // runs past end of extram
+    TEST_ASSERT_EQUAL_HEX32(0xFFFFFFFF, file_syscall(UVM32_SYSCALL_FREAD, h, UVM32_EXTRAM_BASE + sizeof(extram) - 4, 8));
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(UVM32_EVT_ERR, evt.typ);
+    TEST_ASSERT_EQUAL(UVM32_ERR_MEM_WR, evt.data.err.errcode);
+}
+
+void test_file_read_asset(void) {
+    static const uint8_t asset[16] = { 0 };
+    uvm32_load(&vmst, syscall_loop, sizeof(syscall_loop));
+    uvm32_mapAsset(&vmst, asset, sizeof(asset));
+    strcpy((char *)extram, "hello.txt");
+
+    // asset window is read-only, so reading into it fails without touching it
+    uint32_t h = file_syscall(UVM32_SYSCALL_FOPEN, UVM32_EXTRAM_BASE, 0, 0);
+    TEST_ASSERT_EQUAL_HEX32(0xFFFFFFFF, file_syscall(UVM32_SYSCALL_FREAD, h, 0x40000000, 5));
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(UVM32_EVT_ERR, evt.typ);
+    TEST_ASSERT_EQUAL(UVM32_ERR_MEM_WR, evt.data.err.errcode);
+}
+
+void test_file_read_marks_dirty(void) {
+    uvm32_load(&vmst, syscall_loop, sizeof(syscall_loop));
+    strcpy((char *)extram, "hello.txt");
+
+    uint32_t h = file_syscall(UVM32_SYSCALL_FOPEN, UVM32_EXTRAM_BASE, 0, 0);
+    TEST_ASSERT_EQUAL(false, uvm32_extramDirty(&vmst));
+    TEST_ASSERT_EQUAL(5, file_syscall(UVM32_SYSCALL_FREAD, h, UVM32_EXTRAM_BASE + 64, 5));
+    // host wrote extram, as if VM code had stored there
+    TEST_ASSERT_EQUAL(true, uvm32_extramDirty(&vmst));
+    uint32_t offset, len;
+    TEST_ASSERT_EQUAL(true, uvm32_regionDirtyRange(&vmst, 0, &offset, &len));
+    TEST_ASSERT_EQUAL(64, offset);
+    TEST_ASSERT_EQUAL(5, len);
+}
+
+void test_file_readahead_shared_cache(void) {
+    const uint32_t pages = 64;
+    uvm32_files_t files2;
+    FILE *f = fopen("data/big.bin", "wb");
+    TEST_ASSERT_NOT_NULL(f);
+    for (uint32_t i=0;i<pages * UVM32_FILES_PAGE_SIZE;i++) {
+        fputc(i / UVM32_FILES_PAGE_SIZE, f);
+    }
+    fclose(f);
+
+    uvm32_load(&vmst, syscall_loop, sizeof(syscall_loop));
+    strcpy((char *)extram, "big.bin");
+
+    // sequential reads, readahead window grows so far fewer reads than pages
+    uvm32_files_stats_t before = uvm32_files_getStats();
+    uint32_t h = file_syscall(UVM32_SYSCALL_FOPEN, UVM32_EXTRAM_BASE, 0, 0);
+    for (uint32_t i=0;i<pages * 4;i++) {
+        TEST_ASSERT_EQUAL(1024, file_syscall(UVM32_SYSCALL_FREAD, h, UVM32_EXTRAM_BASE + 1024, 1024));
+        TEST_ASSERT_EQUAL(i / 4, extram[1024]);
+    }
+    uvm32_files_stats_t after = uvm32_files_getStats();
+    TEST_ASSERT_LESS_OR_EQUAL(8, after.reads - before.reads);
+
+    // another vm reading the same file is served from the cache
+    uvm32_files_init(&files2);
+    uvm32_files_allow(&files2, "data");
+    uvm32_files_t tmp = files;
+    files = files2;
+    h = file_syscall(UVM32_SYSCALL_FOPEN, UVM32_EXTRAM_BASE, 0, 0);
+    TEST_ASSERT_EQUAL(pages * UVM32_FILES_PAGE_SIZE, file_syscall(UVM32_SYSCALL_FSTAT, h, 0, 0));
+    TEST_ASSERT_EQUAL(UVM32_FILES_PAGE_SIZE * (pages - 1), file_syscall(UVM32_SYSCALL_FSEEK, h, (uint32_t)-UVM32_FILES_PAGE_SIZE, UVM32_SEEK_END));
+    TEST_ASSERT_EQUAL(1024, file_syscall(UVM32_SYSCALL_FREAD, h, UVM32_EXTRAM_BASE + 1024, 1024));
+    TEST_ASSERT_EQUAL(pages - 1, extram[1024]);
+    TEST_ASSERT_EQUAL(after.reads, uvm32_files_getStats().reads);
+    uvm32_files_free(&files);
+    files = tmp;
+
+    remove("data/big.bin");
+}
+
+void test_files_allow_missing(void) {
+    TEST_ASSERT_EQUAL(false, uvm32_files_allow(&files, "no_such_dir"));
+}
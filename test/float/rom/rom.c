@@ -0,0 +1,30 @@
+#include "uvm32_target.h"
+#include "../shared.h"
+
+static float basel(int n) {
+    float acc = 0;
+    for (int i=1;i<=n;i++) {
+        float f = (float)i;
+        acc += 1.0f / (f * f);
+    }
+    return acc;
+}
+
+void main(void) {
+    switch(syscall(SYSCALL_PICKTEST, 0, 0)) {
+        case TEST1: {
+            // sum of 1/n^2 tends to pi^2/6
+            volatile int n = 100;
+            printdec((int32_t)(basel(n) * 6.0f * 100000.0f));
+        } break;
+        case TEST2: {
+            // newton's method for sqrt(2)
+            volatile float two = 2.0f;
+            float x = 1.0f;
+            for (int i=0;i<6;i++) {
+                x = (x + two / x) * 0.5f;
+            }
+            printdec((int32_t)(x * 1000000.0f));
+        } break;
+    }
+}
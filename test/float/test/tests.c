@@ -0,0 +1,357 @@
+#include <string.h>
+#include "unity.h"
+#include "uvm32.h"
+#include "../common/uvm32_common_custom.h"
+
+#include "rom-header.h"
+#include "../shared.h"
+
+static uvm32_state_t vmst;
+static uvm32_evt_t evt;
+
+void setUp(void) {
+    uvm32_init(&vmst);
+    uvm32_load(&vmst, rom_bin, rom_bin_len);
+}
+
+void tearDown(void) {
+}
+
+static void run_code(const uint8_t *code, int len) {
+    uvm32_init(&vmst);
+    uvm32_load(&vmst, code, len);
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+}
+
+void test_rom_basel(void) {
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, SYSCALL_PICKTEST);
+    uvm32_arg_setval(&vmst, &evt, RET, TEST1);
+
+    uvm32_run(&vmst, &evt, 100000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, UVM32_SYSCALL_PRINTDEC);
+    TEST_ASSERT_EQUAL(980990, uvm32_arg_getval(&vmst, &evt, ARG0));
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+}
+
+void test_rom_newton(void) {
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, SYSCALL_PICKTEST);
+    uvm32_arg_setval(&vmst, &evt, RET, TEST2);
+
+    uvm32_run(&vmst, &evt, 100000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, UVM32_SYSCALL_PRINTDEC);
+    TEST_ASSERT_EQUAL(1414213, uvm32_arg_getval(&vmst, &evt, ARG0));
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+}
+
+void test_arith(void) {
+    // 3.0 and 2.0
+    uint8_t code[] = {
+        0x37, 0x05, 0x40, 0x40,  // lui a0, 0x40400
+        0x53, 0x05, 0x05, 0xf0,  // fmv.w.x fa0, a0
+        0xb7, 0x05, 0x00, 0x40,  // lui a1, 0x40000
+        0xd3, 0x85, 0x05, 0xf0,  // fmv.w.x fa1, a1
+        0x53, 0x76, 0xb5, 0x00,  // fadd.s fa2, fa0, fa1
+        0xd3, 0x76, 0xb5, 0x10,  // fmul.s fa3, fa0, fa1
+        0x53, 0x77, 0xb5, 0x18,  // fdiv.s fa4, fa0, fa1
+        0xd3, 0xf7, 0xa5, 0x08,  // fsub.s fa5, fa1, fa0
+        0x53, 0xf8, 0x05, 0x58,  // fsqrt.s fa6, fa1
+        0xc3, 0x78, 0xb5, 0x58,  // fmadd.s fa7, fa0, fa1, fa1
+        0x53, 0x06, 0x06, 0xe0,  // fmv.x.w a2, fa2
+        0xd3, 0x86, 0x06, 0xe0,  // fmv.x.w a3, fa3
+        0x53, 0x07, 0x07, 0xe0,  // fmv.x.w a4, fa4
+        0xd3, 0x87, 0x07, 0xe0,  // fmv.x.w a5, fa5
+        0x53, 0x08, 0x08, 0xe0,  // fmv.x.w a6, fa6
+        0xd3, 0x82, 0x08, 0xe0,  // fmv.x.w t0, fa7
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    run_code(code, sizeof(code));
+    TEST_ASSERT_EQUAL_HEX32(0x40a00000, vmst._core.regs[12]); // 5.0
+    TEST_ASSERT_EQUAL_HEX32(0x40c00000, vmst._core.regs[13]); // 6.0
+    TEST_ASSERT_EQUAL_HEX32(0x3fc00000, vmst._core.regs[14]); // 1.5
+    TEST_ASSERT_EQUAL_HEX32(0xbf800000, vmst._core.regs[15]); // -1.0
+    TEST_ASSERT_EQUAL_HEX32(0x3fb504f3, vmst._core.regs[16]); // sqrt(2)
+    TEST_ASSERT_EQUAL_HEX32(0x41000000, vmst._core.regs[5]); // 8.0
+}
+
+void test_convert_rounding(void) {
+    // 2.5 and -2.5 to int with each rounding mode
+    uint8_t code[] = {
+        0x37, 0x05, 0x20, 0x40,  // lui a0, 0x40200
+        0x53, 0x05, 0x05, 0xf0,  // fmv.w.x fa0, a0
+        0xd3, 0x15, 0xa5, 0x20,  // fneg.s fa1, fa0
+        0xd3, 0x05, 0x05, 0xc0,  // fcvt.w.s a1, fa0, rne
+        0x53, 0x16, 0x05, 0xc0,  // fcvt.w.s a2, fa0, rtz
+        0xd3, 0xa6, 0x05, 0xc0,  // fcvt.w.s a3, fa1, rdn
+        0x53, 0x37, 0x05, 0xc0,  // fcvt.w.s a4, fa0, rup
+        0xd3, 0xc7, 0x05, 0xc0,  // fcvt.w.s a5, fa1, rmm
+        0x53, 0x98, 0x15, 0xc0,  // fcvt.wu.s a6, fa1, rtz
+        0x93, 0x02, 0x90, 0xff,  // li t0, -7
+        0x53, 0xf6, 0x02, 0xd0,  // fcvt.s.w fa2, t0
+        0x53, 0x03, 0x06, 0xe0,  // fmv.x.w t1, fa2
+        0xf3, 0x23, 0x10, 0x00,  // frflags t2
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    run_code(code, sizeof(code));
+    TEST_ASSERT_EQUAL(2, (int32_t)vmst._core.regs[11]);
+    TEST_ASSERT_EQUAL(2, (int32_t)vmst._core.regs[12]);
+    TEST_ASSERT_EQUAL(-3, (int32_t)vmst._core.regs[13]);
+    TEST_ASSERT_EQUAL(3, (int32_t)vmst._core.regs[14]);
+    TEST_ASSERT_EQUAL(-3, (int32_t)vmst._core.regs[15]);
+    TEST_ASSERT_EQUAL(0, (int32_t)vmst._core.regs[16]); // negative to unsigned saturates
+    TEST_ASSERT_EQUAL_HEX32(0xc0e00000, vmst._core.regs[6]); // -7.0
+    TEST_ASSERT_EQUAL_HEX32(0x00000011, vmst._core.regs[7]); // NV, NX
+}
+
+void test_convert_saturates(void) {
+    // 2^32, -2^32 and NaN to int
+    uint8_t code[] = {
+        0x37, 0x05, 0x80, 0x4f,  // lui a0, 0x4f800
+        0x53, 0x05, 0x05, 0xf0,  // fmv.w.x fa0, a0
+        0xd3, 0x15, 0x05, 0xc0,  // fcvt.w.s a1, fa0, rtz
+        0x53, 0x16, 0x15, 0xc0,  // fcvt.wu.s a2, fa0, rtz
+        0xd3, 0x15, 0xa5, 0x20,  // fneg.s fa1, fa0
+        0xd3, 0x96, 0x05, 0xc0,  // fcvt.w.s a3, fa1, rtz
+        0x37, 0x05, 0xc0, 0x7f,  // lui a0, 0x7fc00
+        0x53, 0x06, 0x05, 0xf0,  // fmv.w.x fa2, a0
+        0x53, 0x17, 0x06, 0xc0,  // fcvt.w.s a4, fa2, rtz
+        0xf3, 0x27, 0x10, 0x00,  // frflags a5
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    run_code(code, sizeof(code));
+    TEST_ASSERT_EQUAL_HEX32(0x7fffffff, vmst._core.regs[11]);
+    TEST_ASSERT_EQUAL_HEX32(0xffffffff, vmst._core.regs[12]);
+    TEST_ASSERT_EQUAL_HEX32(0x80000000, vmst._core.regs[13]);
+    TEST_ASSERT_EQUAL_HEX32(0x7fffffff, vmst._core.regs[14]);
+    TEST_ASSERT_EQUAL_HEX32(0x00000010, vmst._core.regs[15]); // NV
+}
+
+void test_nan_and_flags(void) {
+    uint8_t code[] = {
+        0x53, 0x05, 0x00, 0xf0,  // fmv.w.x fa0, zero
+        0xd3, 0x75, 0xa5, 0x18,  // fdiv.s fa1, fa0, fa0
+        0xd3, 0x85, 0x05, 0xe0,  // fmv.x.w a1, fa1
+        0x73, 0x26, 0x10, 0x00,  // frflags a2
+        0x73, 0x10, 0x10, 0x00,  // fsflags zero
+        0x13, 0x05, 0x10, 0x00,  // li a0, 1
+        0x53, 0x76, 0x05, 0xd0,  // fcvt.s.w fa2, a0
+        0xd3, 0x76, 0xa6, 0x18,  // fdiv.s fa3, fa2, fa0
+        0xd3, 0x86, 0x06, 0xe0,  // fmv.x.w a3, fa3
+        0x73, 0x27, 0x10, 0x00,  // frflags a4
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    run_code(code, sizeof(code));
+    TEST_ASSERT_EQUAL_HEX32(0x7fc00000, vmst._core.regs[11]); // 0/0 is the canonical NaN
+    TEST_ASSERT_EQUAL_HEX32(0x00000010, vmst._core.regs[12]); // NV
+    TEST_ASSERT_EQUAL_HEX32(0x7f800000, vmst._core.regs[13]); // 1/0 is inf
+    TEST_ASSERT_EQUAL_HEX32(0x00000008, vmst._core.regs[14]); // DZ
+}
+
+void test_compare(void) {
+    uint8_t code[] = {
+        0x37, 0x05, 0xc0, 0x7f,  // lui a0, 0x7fc00
+        0x53, 0x05, 0x05, 0xf0,  // fmv.w.x fa0, a0
+        0x13, 0x05, 0x10, 0x00,  // li a0, 1
+        0xd3, 0x75, 0x05, 0xd0,  // fcvt.s.w fa1, a0
+        0xd3, 0x25, 0xb5, 0xa0,  // feq.s a1, fa0, fa1
+        0x73, 0x26, 0x10, 0x00,  // frflags a2
+        0xd3, 0x16, 0xb5, 0xa0,  // flt.s a3, fa0, fa1
+        0x73, 0x27, 0x10, 0x00,  // frflags a4
+        0x73, 0x10, 0x10, 0x00,  // fsflags zero
+        0xd3, 0x87, 0xb5, 0xa0,  // fle.s a5, fa1, fa1
+        0x53, 0x98, 0xb5, 0xa0,  // flt.s a6, fa1, fa1
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    run_code(code, sizeof(code));
+    TEST_ASSERT_EQUAL(0, (int32_t)vmst._core.regs[11]); // feq NaN
+    TEST_ASSERT_EQUAL_HEX32(0x00000000, vmst._core.regs[12]); // feq is quiet
+    TEST_ASSERT_EQUAL(0, (int32_t)vmst._core.regs[13]); // flt NaN
+    TEST_ASSERT_EQUAL_HEX32(0x00000010, vmst._core.regs[14]); // flt signals NV
+    TEST_ASSERT_EQUAL(1, (int32_t)vmst._core.regs[15]); // 1 <= 1
+    TEST_ASSERT_EQUAL(0, (int32_t)vmst._core.regs[16]); // 1 < 1
+}
+
+void test_min_max(void) {
+    uint8_t code[] = {
+        0x37, 0x05, 0x00, 0x80,  // lui a0, 0x80000
+        0x53, 0x05, 0x05, 0xf0,  // fmv.w.x fa0, a0
+        0xd3, 0x05, 0x00, 0xf0,  // fmv.w.x fa1, zero
+        0x53, 0x06, 0xb5, 0x28,  // fmin.s fa2, fa0, fa1
+        0xd3, 0x16, 0xb5, 0x28,  // fmax.s fa3, fa0, fa1
+        0xd3, 0x05, 0x06, 0xe0,  // fmv.x.w a1, fa2
+        0x53, 0x86, 0x06, 0xe0,  // fmv.x.w a2, fa3
+        0x37, 0x05, 0xc0, 0x7f,  // lui a0, 0x7fc00
+        0x53, 0x07, 0x05, 0xf0,  // fmv.w.x fa4, a0
+        0x13, 0x05, 0x10, 0x00,  // li a0, 1
+        0xd3, 0x77, 0x05, 0xd0,  // fcvt.s.w fa5, a0
+        0x53, 0x08, 0xf7, 0x28,  // fmin.s fa6, fa4, fa5
+        0xd3, 0x06, 0x08, 0xe0,  // fmv.x.w a3, fa6
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    run_code(code, sizeof(code));
+    TEST_ASSERT_EQUAL_HEX32(0x80000000, vmst._core.regs[11]); // min(-0, +0) is -0
+    TEST_ASSERT_EQUAL_HEX32(0x00000000, vmst._core.regs[12]); // max(-0, +0) is +0
+    TEST_ASSERT_EQUAL_HEX32(0x3f800000, vmst._core.regs[13]); // min(NaN, 1) is 1
+}
+
+void test_classify(void) {
+    uint8_t code[] = {
+        0x37, 0x05, 0x80, 0xff,  // lui a0, 0xff800
+        0x53, 0x05, 0x05, 0xf0,  // fmv.w.x fa0, a0
+        0xd3, 0x15, 0x05, 0xe0,  // fclass.s a1, fa0
+        0xd3, 0x15, 0xa5, 0x20,  // fneg.s fa1, fa0
+        0x53, 0x96, 0x05, 0xe0,  // fclass.s a2, fa1
+        0x37, 0x05, 0xa0, 0x7f,  // lui a0, 0x7fa00
+        0x53, 0x06, 0x05, 0xf0,  // fmv.w.x fa2, a0
+        0xd3, 0x16, 0x06, 0xe0,  // fclass.s a3, fa2
+        0x13, 0x05, 0x10, 0x00,  // li a0, 1
+        0xd3, 0x06, 0x05, 0xf0,  // fmv.w.x fa3, a0
+        0x53, 0x97, 0x06, 0xe0,  // fclass.s a4, fa3
+        0x53, 0x07, 0x00, 0xf0,  // fmv.w.x fa4, zero
+        0x53, 0x17, 0xe7, 0x20,  // fneg.s fa4, fa4
+        0xd3, 0x17, 0x07, 0xe0,  // fclass.s a5, fa4
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    run_code(code, sizeof(code));
+    TEST_ASSERT_EQUAL_HEX32(0x00000001, vmst._core.regs[11]); // -inf
+    TEST_ASSERT_EQUAL_HEX32(0x00000080, vmst._core.regs[12]); // +inf
+    TEST_ASSERT_EQUAL_HEX32(0x00000100, vmst._core.regs[13]); // signalling NaN
+    TEST_ASSERT_EQUAL_HEX32(0x00000020, vmst._core.regs[14]); // +subnormal
+    TEST_ASSERT_EQUAL_HEX32(0x00000008, vmst._core.regs[15]); // -0
+}
+
+void test_sign_injection(void) {
+    uint8_t code[] = {
+        0x37, 0x05, 0x40, 0x40,  // lui a0, 0x40400
+        0x53, 0x05, 0x05, 0xf0,  // fmv.w.x fa0, a0
+        0xb7, 0x05, 0x80, 0xbf,  // lui a1, 0xbf800
+        0xd3, 0x85, 0x05, 0xf0,  // fmv.w.x fa1, a1
+        0x53, 0x06, 0xb5, 0x20,  // fsgnj.s fa2, fa0, fa1
+        0xd3, 0x16, 0xb5, 0x20,  // fsgnjn.s fa3, fa0, fa1
+        0x53, 0xa7, 0xb5, 0x20,  // fsgnjx.s fa4, fa1, fa1
+        0xd3, 0xa7, 0xb5, 0x20,  // fabs.s fa5, fa1
+        0x53, 0x06, 0x06, 0xe0,  // fmv.x.w a2, fa2
+        0xd3, 0x86, 0x06, 0xe0,  // fmv.x.w a3, fa3
+        0x53, 0x07, 0x07, 0xe0,  // fmv.x.w a4, fa4
+        0xd3, 0x87, 0x07, 0xe0,  // fmv.x.w a5, fa5
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    run_code(code, sizeof(code));
+    TEST_ASSERT_EQUAL_HEX32(0xc0400000, vmst._core.regs[12]); // -3.0
+    TEST_ASSERT_EQUAL_HEX32(0x40400000, vmst._core.regs[13]); // 3.0
+    TEST_ASSERT_EQUAL_HEX32(0x3f800000, vmst._core.regs[14]); // 1.0
+    TEST_ASSERT_EQUAL_HEX32(0x3f800000, vmst._core.regs[15]); // 1.0
+}
+
+void test_load_store(void) {
+    uint8_t code[] = {
+        0x37, 0x05, 0x40, 0x40,  // lui a0, 0x40400
+        0x53, 0x05, 0x05, 0xf0,  // fmv.w.x fa0, a0
+        0x37, 0x14, 0x00, 0x80,  // lui s0, 0x80001
+        0x27, 0x24, 0xa4, 0x00,  // fsw fa0, 8(s0)
+        0x87, 0x25, 0x84, 0x00,  // flw fa1, 8(s0)
+        0x53, 0xf6, 0xb5, 0x00,  // fadd.s fa2, fa1, fa1
+        0x27, 0x26, 0xc4, 0x00,  // fsw fa2, 12(s0)
+        0x83, 0x25, 0xc4, 0x00,  // lw a1, 12(s0)
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    run_code(code, sizeof(code));
+    TEST_ASSERT_EQUAL_HEX32(0x40c00000, vmst._core.regs[11]); // 6.0
+    TEST_ASSERT_EQUAL_HEX32(0x40400000, vmst._core.fregs[11]); // fa1
+}
+
+void test_compressed_load_store(void) {
+    uint8_t code[] = {
+        0x37, 0x05, 0x40, 0x40,  // lui a0, 0x40400
+        0x53, 0x05, 0x05, 0xf0,  // fmv.w.x fa0, a0
+        0x37, 0x14, 0x00, 0x80,  // lui s0, 0x80001
+        0x08, 0xe4,              // c.fsw fa0, 8(s0)
+        0x0c, 0x64,              // c.flw fa1, 8(s0)
+        0x53, 0xf6, 0xb5, 0x00,  // fadd.s fa2, fa1, fa1
+        0x22, 0x81,              // c.mv sp, s0
+        0x32, 0xe6,              // c.fswsp fa2, 12(sp)
+        0x32, 0x60,              // c.flwsp ft0, 12(sp)
+        0xd3, 0x05, 0x00, 0xe0,  // fmv.x.w a1, ft0
+        0x10, 0x44,              // c.lw a2, 8(s0)
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    run_code(code, sizeof(code));
+    TEST_ASSERT_EQUAL_HEX32(0x40c00000, vmst._core.regs[11]); // 6.0
+    TEST_ASSERT_EQUAL_HEX32(0x40400000, vmst._core.regs[12]); // 3.0
+    TEST_ASSERT_EQUAL_HEX32(0x40400000, vmst._core.fregs[11]); // fa1
+}
+
+void test_rounding_modes(void) {
+    // 1/3 rounded down, up, then with frm set to round up
+    uint8_t code[] = {
+        0x13, 0x05, 0x10, 0x00,  // li a0, 1
+        0x53, 0x75, 0x05, 0xd0,  // fcvt.s.w fa0, a0
+        0x13, 0x05, 0x30, 0x00,  // li a0, 3
+        0xd3, 0x75, 0x05, 0xd0,  // fcvt.s.w fa1, a0
+        0x53, 0x26, 0xb5, 0x18,  // fdiv.s fa2, fa0, fa1, rdn
+        0xd3, 0x36, 0xb5, 0x18,  // fdiv.s fa3, fa0, fa1, rup
+        0xd3, 0x05, 0x06, 0xe0,  // fmv.x.w a1, fa2
+        0x53, 0x86, 0x06, 0xe0,  // fmv.x.w a2, fa3
+        0xf3, 0xd6, 0x21, 0x00,  // fsrmi a3, 3
+        0x53, 0x77, 0xb5, 0x18,  // fdiv.s fa4, fa0, fa1
+        0x53, 0x07, 0x07, 0xe0,  // fmv.x.w a4, fa4
+        0xf3, 0x27, 0x20, 0x00,  // frrm a5
+        0x73, 0x28, 0x30, 0x00,  // frcsr a6
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    run_code(code, sizeof(code));
+    TEST_ASSERT_EQUAL_HEX32(0x3eaaaaaa, vmst._core.regs[11]);
+    TEST_ASSERT_EQUAL_HEX32(0x3eaaaaab, vmst._core.regs[12]);
+    TEST_ASSERT_EQUAL(0, (int32_t)vmst._core.regs[13]); // previous frm
+    TEST_ASSERT_EQUAL_HEX32(0x3eaaaaab, vmst._core.regs[14]);
+    TEST_ASSERT_EQUAL(3, (int32_t)vmst._core.regs[15]); // frm
+    TEST_ASSERT_EQUAL_HEX32(0x00000061, vmst._core.regs[16]); // frm=RUP, NX
+}
+
+void test_invalid_rounding_mode(void) {
+    // frm=5 is reserved, so dynamic rounding is illegal
+    uint8_t code[] = {
+        0x73, 0xd0, 0x22, 0x00,  // fsrmi zero, 5
+        0x53, 0x75, 0xa5, 0x00,  // fadd.s fa0, fa0, fa0
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    uvm32_init(&vmst);
+    uvm32_load(&vmst, code, sizeof(code));
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_ERR);
+    TEST_ASSERT_EQUAL(evt.data.err.errcode, UVM32_ERR_INTERNAL_CORE);
+}
@@ -0,0 +1,26 @@
+#include "uvm32_target.h"
+#include "../shared.h"
+
+void main(void) {
+    uint32_t test = syscall(SYSCALL_PICKTEST, 0, 0);
+
+    switch(test) {
+        case TEST1:
+            // poll the clock until it reaches 10
+            while (millis() < 10) {
+            }
+        break;
+        case TEST2:
+            // the same, yielding between polls
+            while (millis() < 10) {
+                yield(0);
+            }
+        break;
+        case TEST3:
+            // a loop making progress is not idle
+            for (uint32_t i=0;i<8;i++) {
+                printdec(i);
+            }
+        break;
+    }
+}
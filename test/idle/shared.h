@@ -0,0 +1,8 @@
+#define SYSCALL_BASE 0x200
+#define SYSCALL_PICKTEST SYSCALL_BASE+0
+
+enum {
+    TEST1,
+    TEST2,
+    TEST3,
+};
@@ -0,0 +1,88 @@
+#include <string.h>
+#include "unity.h"
+#include "uvm32.h"
+#include "../common/uvm32_common_custom.h"
+
+#include "rom-header.h"
+#include "../shared.h"
+
+static uvm32_state_t vmst;
+static uvm32_evt_t evt;
+
+void setUp(void) {
+    uvm32_init(&vmst);
+    uvm32_load(&vmst, rom_bin, rom_bin_len);
+}
+
+void tearDown(void) {
+}
+
+static void pick_test(uint32_t test) {
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, SYSCALL_PICKTEST);
+    TEST_ASSERT_EQUAL(0, evt.data.syscall.idle);
+    uvm32_arg_setval(&vmst, &evt, RET, test);
+}
+
+static uint32_t poll_millis(uint32_t now) {
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, UVM32_SYSCALL_MILLIS);
+    uvm32_arg_setval(&vmst, &evt, RET, now);
+    return evt.data.syscall.idle;
+}
+
+void test_idle_poll(void) {
+    pick_test(TEST1);
+
+    // the first polls differ from those before in a2, the last time returned
+    TEST_ASSERT_EQUAL(0, poll_millis(5));
+    poll_millis(5);
+    TEST_ASSERT_EQUAL(1, poll_millis(5));
+    TEST_ASSERT_EQUAL(2, poll_millis(6));
+    // a new time is a change
+    TEST_ASSERT_EQUAL(0, poll_millis(6));
+    TEST_ASSERT_EQUAL(1, poll_millis(10));
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+}
+
+void test_idle_poll_yield(void) {
+    uint32_t idle;
+
+    pick_test(TEST2);
+
+    // settle, then every syscall in the loop repeats the last
+    for (int i=0;i<2;i++) {
+        poll_millis(5);
+        uvm32_run(&vmst, &evt, 1000);
+    }
+    idle = evt.data.syscall.idle;
+    for (int i=0;i<4;i++) {
+        TEST_ASSERT_EQUAL(++idle, poll_millis(5));
+        uvm32_run(&vmst, &evt, 1000);
+        TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+        TEST_ASSERT_EQUAL(evt.data.syscall.code, UVM32_SYSCALL_YIELD);
+        TEST_ASSERT_EQUAL(++idle, evt.data.syscall.idle);
+    }
+    poll_millis(10);
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+}
+
+void test_idle_progress(void) {
+    pick_test(TEST3);
+
+    for (uint32_t i=0;i<8;i++) {
+        uvm32_run(&vmst, &evt, 1000);
+        TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+        TEST_ASSERT_EQUAL(evt.data.syscall.code, UVM32_SYSCALL_PRINTDEC);
+        TEST_ASSERT_EQUAL(i, uvm32_arg_getval(&vmst, &evt, ARG0));
+        TEST_ASSERT_EQUAL(0, evt.data.syscall.idle);
+    }
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+}
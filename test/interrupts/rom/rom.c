@@ -0,0 +1,28 @@
+#include "uvm32_target.h"
+#include "../shared.h"
+
+static volatile uint32_t taken;
+
+static void handler(uint32_t irqs) {
+    taken |= irqs;
+}
+
+void main(void) {
+    uint32_t test = syscall(SYSCALL_PICKTEST, 0, 0);
+
+    irq_handler(handler);
+    switch(test) {
+        case TEST1:
+            // host raises 1 and 2 during the yield, only 1 is enabled
+            irq_enable(1 << 1);
+            yield(0);
+        break;
+        case TEST2:
+            // host raises 5 during the yield, taken once enabled
+            yield(0);
+            printhex(taken);
+            irq_enable(1 << 5);
+        break;
+    }
+    printhex(taken);
+}
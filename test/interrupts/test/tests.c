@@ -0,0 +1,269 @@
+#include <string.h>
+#include "unity.h"
+#include "uvm32.h"
+#include "../common/uvm32_common_custom.h"
+
+#include "rom-header.h"
+#include "../shared.h"
+
+static uvm32_state_t vmst;
+static uvm32_evt_t evt;
+
+void setUp(void) {
+    uvm32_init(&vmst);
+    uvm32_load(&vmst, rom_bin, rom_bin_len);
+}
+
+void tearDown(void) {
+}
+
+static void pick_test(uint32_t test) {
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, SYSCALL_PICKTEST);
+    uvm32_arg_setval(&vmst, &evt, RET, test);
+}
+
+void test_rom_enabled(void) {
+    pick_test(TEST1);
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, UVM32_SYSCALL_YIELD);
+    TEST_ASSERT_TRUE(uvm32_interrupt(&vmst, 1));
+    TEST_ASSERT_TRUE(uvm32_interrupt(&vmst, 2));
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, UVM32_SYSCALL_PRINTHEX);
+    TEST_ASSERT_EQUAL_HEX32(1 << 1, uvm32_arg_getval(&vmst, &evt, ARG0));
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+}
+
+void test_rom_pending(void) {
+    pick_test(TEST2);
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, UVM32_SYSCALL_YIELD);
+    uvm32_interrupt(&vmst, 5);
+
+    // not enabled yet
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, UVM32_SYSCALL_PRINTHEX);
+    TEST_ASSERT_EQUAL_HEX32(0, uvm32_arg_getval(&vmst, &evt, ARG0));
+
+    // taken by the enabling syscall
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, UVM32_SYSCALL_PRINTHEX);
+    TEST_ASSERT_EQUAL_HEX32(1 << 5, uvm32_arg_getval(&vmst, &evt, ARG0));
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+}
+
+static const uint8_t irq_code[] = {
+    0x17, 0x05, 0x00, 0x00,  // auipc a0, 0
+    0x13, 0x05, 0x85, 0x03,  // addi a0, a0, 56
+    0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+    0x93, 0x88, 0x48, 0x00,  // addi a7, a7, 4
+    0x73, 0x00, 0x00, 0x00,  // ecall, handler at 56
+    0x13, 0x05, 0x80, 0x00,  // li a0, 8
+    0x93, 0x88, 0x18, 0x00,  // addi a7, a7, 1
+    0x73, 0x00, 0x00, 0x00,  // ecall, enable irq 3
+    0x13, 0x04, 0x30, 0x12,  // li s0, 0x123
+    0x13, 0x05, 0x70, 0x00,  // li a0, 7
+    0x93, 0x08, 0x00, 0x20,  // li a7, 0x200
+    0x73, 0x00, 0x00, 0x00,  // ecall
+    0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+    0x73, 0x00, 0x00, 0x00,  // ecall
+    // handler
+    0x37, 0x43, 0x00, 0x80,  // lui t1, 0x80004
+    0x23, 0x2e, 0xa3, 0xfe,  // sw a0, -4(t1)
+    0x13, 0x04, 0x00, 0x00,  // li s0, 0
+    0x67, 0x80, 0x00, 0x00,  // ret
+};
+
+static uint32_t handler_arg(void) {
+    uint32_t v;
+    memcpy(&v, &uvm32_getMemory(&vmst)[UVM32_MEMORY_SIZE - 4], 4);
+    return v;
+}
+
+void test_irq_restores_registers(void) {
+    uvm32_load(&vmst, irq_code, sizeof(irq_code));
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, 0x200);
+    TEST_ASSERT_EQUAL(0, vmst._core.regs[12]); // a2, previous mask
+
+    uvm32_interrupt(&vmst, 3);
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+    TEST_ASSERT_EQUAL_HEX32(1 << 3, handler_arg());
+    TEST_ASSERT_EQUAL_HEX32(0x123, vmst._core.regs[8]); // s0
+    TEST_ASSERT_EQUAL(7, vmst._core.regs[10]); // a0
+    TEST_ASSERT_EQUAL(0, vmst._core.regs[1]); // ra
+}
+
+void test_irq_disabled(void) {
+    uvm32_load(&vmst, irq_code, sizeof(irq_code));
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+
+    // irq 4 is not enabled, so stays pending
+    uvm32_interrupt(&vmst, 4);
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+    TEST_ASSERT_EQUAL_HEX32(0, handler_arg());
+    TEST_ASSERT_EQUAL_HEX32(1 << 4, vmst._irqPending);
+}
+
+void test_irq_bad(void) {
+    TEST_ASSERT_FALSE(uvm32_interrupt(&vmst, UVM32_NUM_IRQS));
+}
+
+void test_irq_return_unexpected(void) {
+    uint8_t code[] = {
+        0x93, 0x00, 0xc0, 0xff,  // li ra, 0xfffffffc
+        0x67, 0x80, 0x00, 0x00,  // ret
+    };
+
+    // returning to UVM32_IRQ_RETURN outside a handler is a fault
+    uvm32_load(&vmst, code, sizeof(code));
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_ERR);
+    TEST_ASSERT_EQUAL(evt.data.err.errcode, UVM32_ERR_INTERNAL_CORE);
+}
+
+static uint64_t now;
+
+static uint64_t fixed_clock(void *userdata) {
+    return now;
+}
+
+// wait for up to timeout, or irq 2, then halt
+static void load_wait(uint8_t timeout) {
+    uint8_t code[] = {
+        0x13, 0x05, 0x00, 0x00,  // li a0, timeout
+        0x93, 0x05, 0x40, 0x00,  // li a1, 4
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x93, 0x88, 0x68, 0x00,  // addi a7, a7, 6
+        0x73, 0x00, 0x00, 0x00,  // ecall
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    if (timeout == 0xff) {
+        code[1] = 0x05; code[2] = 0xf0; code[3] = 0xff;    // li a0, -1
+    } else {
+        code[2] = (timeout & 0xf) << 4;
+        code[3] = timeout >> 4;
+    }
+    uvm32_load(&vmst, code, sizeof(code));
+}
+
+void test_wait_timeout(void) {
+    now = 1000;
+    uvm32_setClock(&vmst, fixed_clock, NULL);
+    load_wait(100);
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_WAITING);
+    TEST_ASSERT_EQUAL(1100, evt.data.wait.deadline);
+    TEST_ASSERT_EQUAL_HEX32(1 << 2, evt.data.wait.events);
+
+    // too soon, nothing runs
+    now = 1099;
+    TEST_ASSERT_EQUAL(0, uvm32_run(&vmst, &evt, 100));
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_WAITING);
+
+    now = 1100;
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+    TEST_ASSERT_EQUAL(0, vmst._core.regs[12]); // a2, timed out
+}
+
+void test_wait_sleep_to_deadline(void) {
+    now = 5000;
+    uvm32_setClock(&vmst, fixed_clock, NULL);
+    load_wait(200);
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_WAITING);
+
+    // a host with no interrupt sources sleeps for what is left, as hosts/host does
+    now += 50;
+    TEST_ASSERT_EQUAL(150, evt.data.wait.deadline - uvm32_getClock(&vmst));
+    now += evt.data.wait.deadline - uvm32_getClock(&vmst);
+
+    // one sleep is enough, the wait is over on the next run
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+    TEST_ASSERT_EQUAL(0, vmst._core.regs[12]); // a2, timed out
+}
+
+void test_wait_interrupt(void) {
+    load_wait(0xff);
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_WAITING);
+    TEST_ASSERT_TRUE(UVM32_DEADLINE_NONE == evt.data.wait.deadline);
+
+    // not waited for
+    uvm32_interrupt(&vmst, 3);
+    TEST_ASSERT_EQUAL(0, uvm32_run(&vmst, &evt, 100));
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_WAITING);
+
+    uvm32_interrupt(&vmst, 2);
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+    TEST_ASSERT_EQUAL_HEX32(1 << 2, vmst._core.regs[12]); // a2
+    TEST_ASSERT_EQUAL_HEX32(1 << 3, vmst._irqPending);
+}
+
+void test_wait_pending(void) {
+    // already raised, so no wait
+    uvm32_interrupt(&vmst, 2);
+    load_wait(0xff);
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+    TEST_ASSERT_EQUAL_HEX32(1 << 2, vmst._core.regs[12]); // a2
+}
+
+void test_wait_poll(void) {
+    load_wait(0);
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+    TEST_ASSERT_EQUAL(0, vmst._core.regs[12]); // a2
+}
+
+void test_wait_no_clock(void) {
+    load_wait(50);
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_WAITING);
+    TEST_ASSERT_EQUAL(50, evt.data.wait.deadline);
+
+    // host has no clock, so keeps the time itself
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+    TEST_ASSERT_EQUAL(0, vmst._core.regs[12]); // a2
+}
+
+void test_wait_virtual_clock(void) {
+    uint64_t deadline;
+
+    uvm32_setVirtualClock(&vmst, 1000000);
+    load_wait(100);
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_WAITING);
+    deadline = evt.data.wait.deadline;
+    TEST_ASSERT_EQUAL(uvm32_getClock(&vmst) + 100, deadline);
+
+    // nothing else moves the clock, so it skips to the deadline
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+    TEST_ASSERT_EQUAL(0, vmst._core.regs[12]); // a2
+    TEST_ASSERT_TRUE(uvm32_getClock(&vmst) >= deadline);
+}
@@ -40,6 +40,9 @@ uint32_t metered_run(uint32_t num_instr) {
             case UVM32_EVT_END:
                 TEST_ASSERT_EQUAL(0, 1);    // trigger an assert, we didn't get to 100000 yet
             break;
+            default:
+                TEST_ASSERT_EQUAL(0, 1);    // no other events expected
+            break;
         }
     }
 
@@ -65,3 +68,57 @@ void test_meter(void) {
     }
 }
 
+
+void test_meter_batch_boundary(void) {
+    uint8_t code[] = {
+        0x13, 0x00, 0x00, 0x00,  // nop
+        0x13, 0x00, 0x00, 0x00,  // nop
+        0x13, 0x00, 0x00, 0x00,  // nop
+        0x13, 0x00, 0x00, 0x00,  // nop
+        0x13, 0x00, 0x00, 0x00,  // nop
+        0x13, 0x00, 0x00, 0x00,  // nop
+        0x13, 0x00, 0x00, 0x00,  // nop
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    uvm32_init(&vmst);
+    uvm32_load(&vmst, code, sizeof(code));
+
+    // each batch stops exactly at the meter
+    for (uint32_t i=1;i<=2;i++) {
+        TEST_ASSERT_EQUAL(4, uvm32_run(&vmst, &evt, 4));
+        TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_ERR);
+        TEST_ASSERT_EQUAL(evt.data.err.errcode, UVM32_ERR_HUNG);
+        TEST_ASSERT_EQUAL(i * 4, vmst._instret);
+        TEST_ASSERT_EQUAL_HEX32(0x80000000 + i * 16, uvm32_getProgramCounter(&vmst));
+        uvm32_clearError(&vmst);
+    }
+    TEST_ASSERT_EQUAL(1, uvm32_run(&vmst, &evt, 100));
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+    TEST_ASSERT_EQUAL(9, vmst._instret);
+}
+
+void test_meter_extram_fault(void) {
+    uint8_t code[] = {
+        0x13, 0x00, 0x00, 0x00,  // nop
+        0x13, 0x00, 0x00, 0x00,  // nop
+        0x37, 0x05, 0x00, 0x10,  // lui a0, 0x10000
+        0x83, 0x25, 0x05, 0x00,  // lw a1, 0(a0), no extram mapped
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    uvm32_init(&vmst);
+    uvm32_load(&vmst, code, sizeof(code));
+
+    // the batch ends at the fault, which is counted as run, as an ecall is
+    TEST_ASSERT_EQUAL(2, uvm32_run(&vmst, &evt, 2));
+    TEST_ASSERT_EQUAL(evt.data.err.errcode, UVM32_ERR_HUNG);
+    uvm32_clearError(&vmst);
+    TEST_ASSERT_EQUAL(2, uvm32_run(&vmst, &evt, 100));
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_ERR);
+    TEST_ASSERT_EQUAL(evt.data.err.errcode, UVM32_ERR_MEM_RD);
+    TEST_ASSERT_EQUAL(4, vmst._instret);
+    TEST_ASSERT_EQUAL_HEX32(0x8000000c, uvm32_getProgramCounter(&vmst));
+}
@@ -0,0 +1,12 @@
+#include "uvm32_target.h"
+#include "../shared.h"
+
+void main(void) {
+    switch(syscall(SYSCALL_PICKTEST, 0, 0)) {
+        case TEST1:
+            // store to persistent extram, then wait for it to reach the file
+            *(volatile uint32_t *)(UVM32_EXTRAM_BASE + 4100) = 0xcafef00d;
+            printhex(extram_checkpoint());
+        break;
+    }
+}
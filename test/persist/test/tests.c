@@ -0,0 +1,151 @@
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "unity.h"
+#include "uvm32.h"
+#include "uvm32_persist.h"
+#include "../common/uvm32_common_custom.h"
+
+#include "rom-header.h"
+#include "../shared.h"
+
+static uvm32_state_t vmst;
+static uvm32_evt_t evt;
+
+static uint8_t extram[4096];
+
+void setUp(void) {
+    // runs before each test
+    uvm32_init(&vmst);
+    uvm32_load(&vmst, rom_bin, rom_bin_len);
+    memset(extram, 0x00, sizeof(extram));
+    uvm32_extram(&vmst, extram, sizeof(extram));
+}
+
+void tearDown(void) {
+}
+
+void test_rom_checkpoint(void) {
+    uvm32_persist_t persist;
+    uint32_t val = 0;
+
+    remove("persist.bin");
+    uvm32_init(&vmst);
+    TEST_ASSERT_EQUAL(true, uvm32_persist_open(&persist, &vmst, "persist.bin", 8192));
+    uvm32_load(&vmst, rom_bin, rom_bin_len);
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, SYSCALL_PICKTEST);
+    uvm32_arg_setval(&vmst, &evt, RET, TEST1);
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(true, uvm32_persist_syscall(&persist, &vmst, &evt));
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, UVM32_SYSCALL_PRINTHEX);
+    TEST_ASSERT_EQUAL_HEX32(0, uvm32_arg_getval(&vmst, &evt, ARG0));
+
+    // on disk before the vm ends
+    FILE *f = fopen("persist.bin", "rb");
+    TEST_ASSERT_NOT_NULL(f);
+    fseek(f, 4100, SEEK_SET);
+    TEST_ASSERT_EQUAL(1, fread(&val, sizeof(val), 1, f));
+    fclose(f);
+    TEST_ASSERT_EQUAL_HEX32(0xcafef00d, val);
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+    uvm32_persist_close(&persist, &vmst);
+    remove("persist.bin");
+}
+
+void test_persist_extram(void) {
+    uvm32_persist_t persist;
+    uint32_t val = 0;
+    uint8_t code[] = {
+        0x37, 0x13, 0x00, 0x10,  // lui t1, 0x10001
+        0x37, 0x55, 0x34, 0x12,  // lui a0, 0x12345
+        0x23, 0x22, 0xa3, 0x00,  // sw a0, 4(t1)
+        0x93, 0x08, 0x30, 0x01,  // li a7, UVM32_SYSCALL_CHECKPOINT
+        0x73, 0x00, 0x00, 0x00,  // ecall
+        0xb7, 0x08, 0x00, 0x01,  // lui a7, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    remove("persist.bin");
+    uvm32_init(&vmst);
+    TEST_ASSERT_EQUAL(true, uvm32_persist_open(&persist, &vmst, "persist.bin", 8192));
+    uvm32_load(&vmst, code, sizeof(code));
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(UVM32_EVT_SYSCALL, evt.typ);
+    TEST_ASSERT_EQUAL(true, uvm32_persist_syscall(&persist, &vmst, &evt));
+    TEST_ASSERT_EQUAL(0, vmst._core.regs[12]);
+
+    // written to the file
+    FILE *f = fopen("persist.bin", "rb");
+    TEST_ASSERT_NOT_NULL(f);
+    fseek(f, 4100, SEEK_SET);
+    TEST_ASSERT_EQUAL(1, fread(&val, sizeof(val), 1, f));
+    fclose(f);
+    TEST_ASSERT_EQUAL_HEX32(0x12345000, val);
+
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(UVM32_EVT_END, evt.typ);
+    uvm32_persist_close(&persist, &vmst);
+
+    // reopened at its existing length, with contents kept
+    uvm32_init(&vmst);
+    TEST_ASSERT_EQUAL(true, uvm32_persist_open(&persist, &vmst, "persist.bin", 0));
+    TEST_ASSERT_EQUAL(8192, persist.len);
+    TEST_ASSERT_EQUAL_HEX32(0x12345000, *(uint32_t *)&persist.ptr[4100]);
+    uvm32_persist_close(&persist, &vmst);
+    remove("persist.bin");
+}
+
+void test_persist_sync_fail(void) {
+    uvm32_persist_t persist;
+    uint32_t offset, len;
+
+    remove("persist.bin");
+    uvm32_init(&vmst);
+    TEST_ASSERT_EQUAL(true, uvm32_persist_open(&persist, &vmst, "persist.bin", 8192));
+    uvm32_markDirty(&vmst, UVM32_EXTRAM_BASE + 4100, 4);
+
+    // point at an address which is no longer mapped, so msync fails
+    uint8_t *mapped = persist.ptr;
+    int fd = open("persist.bin", O_RDONLY);
+    void *gone = mmap(NULL, persist.len, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    TEST_ASSERT_NOT_EQUAL(MAP_FAILED, gone);
+    munmap(gone, persist.len);
+    persist.ptr = (uint8_t *)gone;
+    TEST_ASSERT_EQUAL(false, uvm32_persist_sync(&persist, &vmst, true));
+    persist.ptr = mapped;
+
+    // failed page is still dirty, and is written by the next sync
+    TEST_ASSERT_EQUAL(true, uvm32_regionNextDirty(&vmst, persist.region, &offset, &len));
+    TEST_ASSERT_EQUAL(4096, offset);
+    uvm32_markDirty(&vmst, UVM32_EXTRAM_BASE + offset, len);
+    TEST_ASSERT_EQUAL(true, uvm32_persist_sync(&persist, &vmst, true));
+    TEST_ASSERT_EQUAL(false, uvm32_regionNextDirty(&vmst, persist.region, &offset, &len));
+
+    uvm32_persist_close(&persist, &vmst);
+    remove("persist.bin");
+}
+
+void test_persist_open_fail(void) {
+    uvm32_persist_t persist;
+
+    // extram already mapped
+    TEST_ASSERT_EQUAL(false, uvm32_persist_open(&persist, &vmst, "persist.bin", 4096));
+    // no file and no length
+    remove("persist.bin");
+    uvm32_init(&vmst);
+    TEST_ASSERT_EQUAL(false, uvm32_persist_open(&persist, &vmst, "persist.bin", 0));
+    remove("persist.bin");
+}
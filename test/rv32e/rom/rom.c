@@ -0,0 +1,17 @@
+#include "uvm32_target.h"
+#include "../shared.h"
+
+static uint32_t fib(uint32_t n) {
+    return n < 2 ? n : fib(n - 1) + fib(n - 2);
+}
+
+void main(void) {
+    switch(syscall(SYSCALL_PICKTEST, 0, 0)) {
+        case TEST1:
+            printdec(fib(20));
+        break;
+        case TEST2:
+            println("hello");
+        break;
+    }
+}
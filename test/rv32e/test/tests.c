@@ -0,0 +1,174 @@
+#include <string.h>
+#include "unity.h"
+#include "uvm32.h"
+#include "../common/uvm32_common_custom.h"
+
+#include "rom-header.h"
+#include "../shared.h"
+
+static uvm32_state_t vmst;
+static uvm32_evt_t evt;
+
+void setUp(void) {
+    uvm32_init(&vmst);
+    uvm32_load(&vmst, rom_bin, rom_bin_len);
+}
+
+void tearDown(void) {
+}
+
+void test_rom_fib(void) {
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, SYSCALL_PICKTEST);
+    uvm32_arg_setval(&vmst, &evt, RET, TEST1);
+
+    uvm32_run(&vmst, &evt, 1000000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, UVM32_SYSCALL_PRINTDEC);
+    TEST_ASSERT_EQUAL(6765, uvm32_arg_getval(&vmst, &evt, ARG0));
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+}
+
+void test_rom_println(void) {
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, SYSCALL_PICKTEST);
+    uvm32_arg_setval(&vmst, &evt, RET, TEST2);
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, UVM32_SYSCALL_PRINTLN);
+    TEST_ASSERT_EQUAL_STRING("hello", uvm32_arg_getcstr(&vmst, &evt, ARG0));
+
+    uvm32_run(&vmst, &evt, 1000);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+}
+
+void test_register_file_size(void) {
+    TEST_ASSERT_EQUAL(16 * sizeof(uint32_t), sizeof(vmst._core.regs));
+}
+
+void test_syscall_id_in_t0(void) {
+    uint8_t code[] = {
+        0x13, 0x05, 0x50, 0x00,  // li a0, 5
+        0x93, 0x05, 0x70, 0x00,  // li a1, 7
+        0x33, 0x06, 0xb5, 0x00,  // add a2, a0, a1
+        0x93, 0x02, 0x40, 0x00,  // li t0, 4
+        0x73, 0x00, 0x00, 0x00,  // ecall
+        0xb7, 0x02, 0x00, 0x01,  // lui t0, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    uvm32_init(&vmst);
+    uvm32_load(&vmst, code, sizeof(code));
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_SYSCALL);
+    TEST_ASSERT_EQUAL(evt.data.syscall.code, UVM32_SYSCALL_PRINTDEC);
+    TEST_ASSERT_EQUAL(5, uvm32_arg_getval(&vmst, &evt, ARG0));
+    TEST_ASSERT_EQUAL(12, uvm32_arg_getval(&vmst, &evt, RET));
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+}
+
+void test_high_register_write(void) {
+    uint8_t code[] = {
+        0x13, 0x08, 0x10, 0x00,  // li a6, 1
+        0xb7, 0x02, 0x00, 0x01,  // lui t0, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    uvm32_init(&vmst);
+    uvm32_load(&vmst, code, sizeof(code));
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_ERR);
+    TEST_ASSERT_EQUAL(evt.data.err.errcode, UVM32_ERR_INTERNAL_CORE);
+    TEST_ASSERT_EQUAL(0, vmst._core.regs[0]);
+}
+
+void test_high_register_jal(void) {
+    uint8_t code[] = {
+        0x13, 0x00, 0x00, 0x00,  // nop
+        0x6f, 0x08, 0x80, 0x00,  // jal a6, 8
+        0xb7, 0x02, 0x00, 0x01,  // lui t0, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    uvm32_init(&vmst);
+    uvm32_load(&vmst, code, sizeof(code));
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_ERR);
+    TEST_ASSERT_EQUAL(evt.data.err.errcode, UVM32_ERR_INTERNAL_CORE);
+    // trapped before the jump, so pc is the jal itself
+    TEST_ASSERT_EQUAL_HEX32(0x80000004, uvm32_getProgramCounter(&vmst));
+    TEST_ASSERT_EQUAL(0, vmst._core.regs[0]);
+}
+
+void test_high_register_read(void) {
+    uint8_t code[] = {
+        0x13, 0x05, 0x10, 0x00,  // li a0, 1
+        0x33, 0x05, 0xa8, 0x00,  // add a0, a6, a0
+        0xb7, 0x02, 0x00, 0x01,  // lui t0, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    uvm32_init(&vmst);
+    uvm32_load(&vmst, code, sizeof(code));
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_ERR);
+    TEST_ASSERT_EQUAL(evt.data.err.errcode, UVM32_ERR_INTERNAL_CORE);
+    // a6 would have read a0, but traps instead
+    TEST_ASSERT_EQUAL_HEX32(0x80000004, uvm32_getProgramCounter(&vmst));
+    TEST_ASSERT_EQUAL(1, vmst._core.regs[10]);
+}
+
+void test_high_register_store_source(void) {
+    uint8_t code[] = {
+        0x37, 0x15, 0x00, 0x80,  // lui a0, 0x80001
+        0x23, 0x20, 0x05, 0x01,  // sw a6, 0(a0)
+        0xb7, 0x02, 0x00, 0x01,  // lui t0, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    uvm32_init(&vmst);
+    uvm32_load(&vmst, code, sizeof(code));
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_ERR);
+    TEST_ASSERT_EQUAL(evt.data.err.errcode, UVM32_ERR_INTERNAL_CORE);
+    TEST_ASSERT_EQUAL_HEX32(0x80000004, uvm32_getProgramCounter(&vmst));
+}
+
+void test_shift_immediate_not_rs2(void) {
+    // bits 20-24 of a shift are its amount, 16 is not x16
+    uint8_t code[] = {
+        0x13, 0x05, 0x10, 0x00,  // li a0, 1
+        0x13, 0x15, 0x05, 0x01,  // slli a0, a0, 16
+        0xb7, 0x02, 0x00, 0x01,  // lui t0, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    uvm32_init(&vmst);
+    uvm32_load(&vmst, code, sizeof(code));
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+    TEST_ASSERT_EQUAL_HEX32(0x10000, vmst._core.regs[10]);
+}
+
+void test_store_immediate_not_rd(void) {
+    // bits 7-11 of a store are part of its offset, 16 is not x16
+    uint8_t code[] = {
+        0x37, 0x15, 0x00, 0x80,  // lui a0, 0x80001
+        0x23, 0x28, 0xa5, 0x00,  // sw a0, 16(a0)
+        0x83, 0x25, 0x05, 0x01,  // lw a1, 16(a0)
+        0xb7, 0x02, 0x00, 0x01,  // lui t0, 0x1000
+        0x73, 0x00, 0x00, 0x00,  // ecall
+    };
+
+    uvm32_init(&vmst);
+    uvm32_load(&vmst, code, sizeof(code));
+    uvm32_run(&vmst, &evt, 100);
+    TEST_ASSERT_EQUAL(evt.typ, UVM32_EVT_END);
+    TEST_ASSERT_EQUAL_HEX32(0x80001000, vmst._core.regs[11]); // a1
+}
@@ -19,12 +19,22 @@
 		* There is free MMIO from there to 0x12000000.
 		* You can put things like a UART, or whatever there.
 		* Feel free to override any of the functionality with macros.
+		* Define MINIRV32_EXT_C to accept RV32C compressed instructions.
+		* Define MINIRV32_EXT_ZB to accept Zba, Zbb and Zbs bit manipulation instructions.
+		* Define MINIRV32_EXT_F to accept RV32F single precision floating point instructions.
+		* Define MINIRV32_EXT_ZK to accept Zkn and Zksh scalar crypto instructions (implies MINIRV32_EXT_ZB).
+		* Define MINIRV32_RV32E for the RV32E base with 16 registers. Instructions writing x16-x31
+		  trap as illegal before they execute, reads of them are masked to stay inside the register file.
 */
 
 #ifndef MINIRV32_DECORATE
 	#define MINIRV32_DECORATE static
 #endif
 
+#if defined( MINIRV32_EXT_ZK ) && !defined( MINIRV32_EXT_ZB )
+	#define MINIRV32_EXT_ZB // Zbkb shares rotates, rev8, andn etc with Zbb
+#endif
+
 #ifndef MINIRV32_RAM_IMAGE_OFFSET
 	#define MINIRV32_RAM_IMAGE_OFFSET  0x80000000
 #endif
@@ -37,6 +47,12 @@
 	#define MINIRV32_POSTEXEC(...);
 #endif
 
+// Called once per MiniRV32IMAStep() with the number of instructions executed,
+// including one which caused a trap.
+#ifndef MINIRV32_RETIRE
+	#define MINIRV32_RETIRE(...);
+#endif
+
 #ifndef MINIRV32_HANDLE_MEM_STORE_CONTROL
 	#define MINIRV32_HANDLE_MEM_STORE_CONTROL(...);
 #endif
@@ -45,6 +61,21 @@
 	#define MINIRV32_HANDLE_MEM_LOAD_CONTROL(...);
 #endif
 
+// Define this to execute code from MMIO. Called with the pc and must set ir to
+// the instruction there, only the low 16 bits need to be valid for a
+// compressed instruction, or set trap.
+//#define MINIRV32_HANDLE_FETCH_CONTROL( addy, ir )
+
+// Define this to be called for the custom-0..3 major opcodes (0x0b, 0x2b,
+// 0x5b, 0x7b) with the values of rs1 and rs2. Set rval to the value for rd,
+// or set trap. Without it they are illegal instructions.
+//#define MINIRV32_HANDLE_CUSTOM( ir, rs1, rs2, rval )
+
+// With MINIRV32_NO_ZICSR, define this to provide read-only cycle, time and
+// instret counters (0xc00-0xc02, 0xc80-0xc82). icount is the number of
+// instructions already executed in this step. Set rval, or set trap.
+//#define MINIRV32_HANDLE_COUNTER_READ( csrno, icount, rval )
+
 #ifndef MINIRV32_NO_ZICSR
 #ifndef MINIRV32_OTHERCSR_WRITE
 	#define MINIRV32_OTHERCSR_WRITE(...);
@@ -72,7 +103,11 @@
 // We're going to try to keep the full processor state to 12 x uint4.
 struct MiniRV32IMAState
 {
+#ifdef MINIRV32_RV32E
+	uint32_t regs[16];
+#else
 	uint32_t regs[32];
+#endif
 
 	uint32_t pc;
 	uint32_t mstatus;
@@ -100,8 +135,78 @@ struct MiniRV32IMAState
 	// Bit 2 = WFI (Wait for interrupt)
 	// Bit 3+ = Load/Store reservation LSBs.
 	uint32_t extraflags;
+
+#ifdef MINIRV32_EXT_F
+	uint32_t fregs[32]; // Raw bit patterns of f0..f31
+	uint32_t fcsr;      // Bits 0..4 = fflags, 5..7 = frm
+#endif
 };
 
+#ifdef MINIRV32_RV32E
+// Does ir write an x register? Bits 7-11 are an immediate in branches and
+// stores, and name an f register in most float instructions.
+MINIRV32_DECORATE int MiniRV32IMAWritesX( uint32_t ir )
+{
+	switch( ir & 0x7f )
+	{
+		case 0x63: // Branch
+		case 0x23: // Store
+		case 0x0f: // Fence
+		case 0x07: // FLW
+		case 0x27: // FSW
+		case 0x43: // FMADD.S
+		case 0x47: // FMSUB.S
+		case 0x4b: // FNMSUB.S
+		case 0x4f: // FNMADD.S
+			return 0;
+		case 0x53: // OP-FP, only compares, FCVT.W[U].S, FMV.X.W and FCLASS.S
+		{
+			uint32_t funct5 = ir >> 27;
+			return funct5 == 0x14 || funct5 == 0x18 || funct5 == 0x1c;
+		}
+		default:
+			return 1;
+	}
+}
+
+// Which x registers does ir read? Bit 0 is rs1, bit 1 rs2. Elsewhere the
+// fields are immediates (shift amounts, csr forms) or name f registers, as
+// rs3 always does.
+MINIRV32_DECORATE int MiniRV32IMAReadsX( uint32_t ir )
+{
+	switch( ir & 0x7f )
+	{
+		case 0x67: // JALR
+		case 0x03: // Load
+		case 0x13: // OP-IMM
+		case 0x07: // FLW
+		case 0x27: // FSW, rs2 is an f register
+			return 1;
+		case 0x63: // Branch
+		case 0x23: // Store
+		case 0x33: // OP
+		case 0x2f: // AMO
+		case 0x0b: // custom-0..3
+		case 0x2b:
+		case 0x5b:
+		case 0x7b:
+			return 3;
+		case 0x73: // SYSTEM, only the register forms of csr access
+		{
+			uint32_t funct3 = ( ir >> 12 ) & 0x7;
+			return funct3 >= 1 && funct3 <= 3;
+		}
+		case 0x53: // OP-FP, only FCVT.S.W[U] and FMV.W.X
+		{
+			uint32_t funct5 = ir >> 27;
+			return funct5 == 0x1a || funct5 == 0x1e;
+		}
+		default:
+			return 0;
+	}
+}
+#endif
+
 #ifndef MINIRV32_STEPPROTO
 MINIRV32_DECORATE int32_t MiniRV32IMAStep(void *userdata, struct MiniRV32IMAState * state, uint8_t * image,
 #ifndef MINIRV32_NO_TIMERS_NO_CYCLES
@@ -115,9 +220,575 @@ int count );
 #ifndef MINIRV32_CUSTOM_INTERNALS
 #define CSR( x ) state->x
 #define SETCSR( x, val ) { state->x = val; }
+#ifdef MINIRV32_RV32E
+#define REG( x ) state->regs[(x) & 0xf]
+#define REGSET( x, val ) { state->regs[(x) & 0xf] = val; }
+#else
 #define REG( x ) state->regs[x]
 #define REGSET( x, val ) { state->regs[x] = val; }
 #endif
+#ifdef MINIRV32_EXT_F
+#define FREG( x ) state->fregs[x]
+#define FREGSET( x, val ) { state->fregs[x] = val; }
+#endif
+#endif
+
+#ifdef MINIRV32_EXT_C
+// RV32C: expand a 16-bit compressed instruction into its 32-bit equivalent, so it
+// executes through the same paths as everything else. Returns 0 (an illegal
+// opcode) for reserved or unsupported encodings.
+#define MINIRV32_C_RD_( ci ) ( 8 + ( ( ( ci ) >> 2 ) & 7 ) )
+#define MINIRV32_C_RS1_( ci ) ( 8 + ( ( ( ci ) >> 7 ) & 7 ) )
+#define MINIRV32_ENC_I( imm, rs1, f3, rd, op ) ( ( ( imm ) << 20 ) | ( ( rs1 ) << 15 ) | ( ( f3 ) << 12 ) | ( ( rd ) << 7 ) | ( op ) )
+#define MINIRV32_ENC_S( imm, rs2, rs1, f3, op ) ( ( ( ( imm ) >> 5 ) << 25 ) | ( ( rs2 ) << 20 ) | ( ( rs1 ) << 15 ) | ( ( f3 ) << 12 ) | ( ( ( imm ) & 0x1f ) << 7 ) | ( op ) )
+#define MINIRV32_ENC_R( f7, rs2, rs1, f3, rd, op ) ( ( ( f7 ) << 25 ) | ( ( rs2 ) << 20 ) | ( ( rs1 ) << 15 ) | ( ( f3 ) << 12 ) | ( ( rd ) << 7 ) | ( op ) )
+#define MINIRV32_ENC_B( imm, rs2, rs1, f3 ) ( ( ( ( imm ) >> 12 & 1 ) << 31 ) | ( ( ( imm ) >> 5 & 0x3f ) << 25 ) | ( ( rs2 ) << 20 ) | ( ( rs1 ) << 15 ) | ( ( f3 ) << 12 ) | ( ( ( imm ) >> 1 & 0xf ) << 8 ) | ( ( ( imm ) >> 11 & 1 ) << 7 ) | 0x63 )
+#define MINIRV32_ENC_J( imm, rd ) ( ( ( ( imm ) >> 20 & 1 ) << 31 ) | ( ( ( imm ) >> 1 & 0x3ff ) << 21 ) | ( ( ( imm ) >> 11 & 1 ) << 20 ) | ( ( imm ) & 0xff000 ) | ( ( rd ) << 7 ) | 0x6f )
+
+MINIRV32_DECORATE uint32_t MiniRV32IMAExpandC( uint32_t ci )
+{
+	uint32_t rd = ( ci >> 7 ) & 0x1f;
+	uint32_t rs2 = ( ci >> 2 ) & 0x1f;
+	// Sign extended 6 bit immediate used by c.addi, c.li, c.andi
+	uint32_t imm6 = ( ( ci >> 2 ) & 0x1f ) | ( ( ci & 0x1000 ) ? 0xffffffe0 : 0 );
+
+	switch( ( ( ci & 3 ) << 3 ) | ( ( ci >> 13 ) & 7 ) )
+	{
+		case 0x00: // C.ADDI4SPN
+		{
+			uint32_t imm = ( ( ci >> 7 ) & 0x30 ) | ( ( ci >> 1 ) & 0x3c0 ) | ( ( ci >> 4 ) & 0x4 ) | ( ( ci >> 2 ) & 0x8 );
+			if( imm == 0 ) return 0;
+			return MINIRV32_ENC_I( imm, 2, 0, MINIRV32_C_RD_( ci ), 0x13 );
+		}
+		case 0x02: // C.LW
+		case 0x06: // C.SW
+#ifdef MINIRV32_EXT_F
+		case 0x03: // C.FLW
+		case 0x07: // C.FSW
+#endif
+		{
+			uint32_t imm = ( ( ci >> 7 ) & 0x38 ) | ( ( ci >> 4 ) & 0x4 ) | ( ( ci << 1 ) & 0x40 );
+			uint32_t fp = ( ci >> 11 ) & 4; // funct3 bit 0 selects LOAD-FP/STORE-FP
+			if( ci & 0x8000 )
+				return MINIRV32_ENC_S( imm, MINIRV32_C_RD_( ci ), MINIRV32_C_RS1_( ci ), 2, 0x23 | fp );
+			return MINIRV32_ENC_I( imm, MINIRV32_C_RS1_( ci ), 2, MINIRV32_C_RD_( ci ), 0x03 | fp );
+		}
+		case 0x08: // C.ADDI (C.NOP)
+			return MINIRV32_ENC_I( imm6 & 0xfff, rd, 0, rd, 0x13 );
+		case 0x09: // C.JAL
+		case 0x0d: // C.J
+		{
+			uint32_t imm = ( ( ci >> 1 ) & 0x800 ) | ( ( ci >> 7 ) & 0x10 ) | ( ( ci >> 1 ) & 0x300 ) | ( ( ci << 2 ) & 0x400 ) |
+				( ( ci >> 1 ) & 0x40 ) | ( ( ci << 1 ) & 0x80 ) | ( ( ci >> 2 ) & 0xe ) | ( ( ci << 3 ) & 0x20 );
+			if( imm & 0x800 ) imm |= 0xfffff000;
+			return MINIRV32_ENC_J( imm, ( ci & 0x8000 ) ? 0 : 1 );
+		}
+		case 0x0a: // C.LI
+			return MINIRV32_ENC_I( imm6 & 0xfff, 0, 0, rd, 0x13 );
+		case 0x0b: // C.ADDI16SP, C.LUI
+			if( rd == 2 )
+			{
+				uint32_t imm = ( ( ci >> 3 ) & 0x200 ) | ( ( ci >> 2 ) & 0x10 ) | ( ( ci << 1 ) & 0x40 ) | ( ( ci << 4 ) & 0x180 ) | ( ( ci << 3 ) & 0x20 );
+				if( imm == 0 ) return 0;
+				if( imm & 0x200 ) imm |= 0xfffffc00;
+				return MINIRV32_ENC_I( imm & 0xfff, 2, 0, 2, 0x13 );
+			}
+			if( ( imm6 & 0x3f ) == 0 ) return 0;
+			return ( imm6 << 12 ) | ( rd << 7 ) | 0x37;
+		case 0x0c: // MISC-ALU
+		{
+			uint32_t rdp = MINIRV32_C_RS1_( ci );
+			switch( ( ci >> 10 ) & 3 )
+			{
+				case 0: // C.SRLI
+					if( ci & 0x1000 ) return 0;
+					return MINIRV32_ENC_I( rs2, rdp, 5, rdp, 0x13 );
+				case 1: // C.SRAI
+					if( ci & 0x1000 ) return 0;
+					return MINIRV32_ENC_I( 0x400 | rs2, rdp, 5, rdp, 0x13 );
+				case 2: // C.ANDI
+					return MINIRV32_ENC_I( imm6 & 0xfff, rdp, 7, rdp, 0x13 );
+				default:
+				{
+					// C.SUB, C.XOR, C.OR, C.AND
+					static const uint8_t f3[4] = { 0, 4, 6, 7 };
+					uint32_t op = ( ci >> 5 ) & 3;
+					if( ci & 0x1000 ) return 0;
+					return MINIRV32_ENC_R( op ? 0 : 0x20, MINIRV32_C_RD_( ci ), rdp, f3[op], rdp, 0x33 );
+				}
+			}
+		}
+		case 0x0e: // C.BEQZ
+		case 0x0f: // C.BNEZ
+		{
+			uint32_t imm = ( ( ci >> 4 ) & 0x100 ) | ( ( ci >> 7 ) & 0x18 ) | ( ( ci << 1 ) & 0xc0 ) | ( ( ci >> 2 ) & 0x6 ) | ( ( ci << 3 ) & 0x20 );
+			if( imm & 0x100 ) imm |= 0xfffffe00;
+			return MINIRV32_ENC_B( imm, 0, MINIRV32_C_RS1_( ci ), ( ci >> 13 ) & 1 );
+		}
+		case 0x10: // C.SLLI
+			if( ci & 0x1000 ) return 0;
+			return MINIRV32_ENC_I( rs2, rd, 1, rd, 0x13 );
+		case 0x12: // C.LWSP
+#ifdef MINIRV32_EXT_F
+		case 0x13: // C.FLWSP
+#endif
+		{
+			uint32_t imm = ( ( ci >> 7 ) & 0x20 ) | ( ( ci >> 2 ) & 0x1c ) | ( ( ci << 4 ) & 0xc0 );
+			uint32_t fp = ( ci >> 11 ) & 4;
+			if( rd == 0 && !fp ) return 0; // f0 is a valid C.FLWSP destination
+			return MINIRV32_ENC_I( imm, 2, 2, rd, 0x03 | fp );
+		}
+		case 0x14: // C.JR, C.MV, C.EBREAK, C.JALR, C.ADD
+			if( !( ci & 0x1000 ) )
+			{
+				if( rs2 ) return MINIRV32_ENC_R( 0, rs2, 0, 0, rd, 0x33 ); // C.MV
+				if( rd == 0 ) return 0;
+				return MINIRV32_ENC_I( 0, rd, 0, 0, 0x67 ); // C.JR
+			}
+			if( rs2 ) return MINIRV32_ENC_R( 0, rs2, rd, 0, rd, 0x33 ); // C.ADD
+			if( rd == 0 ) return 0x00100073; // C.EBREAK
+			return MINIRV32_ENC_I( 0, rd, 0, 1, 0x67 ); // C.JALR
+		case 0x16: // C.SWSP
+#ifdef MINIRV32_EXT_F
+		case 0x17: // C.FSWSP
+#endif
+		{
+			uint32_t imm = ( ( ci >> 7 ) & 0x3c ) | ( ( ci >> 1 ) & 0xc0 );
+			return MINIRV32_ENC_S( imm, rs2, 2, 2, 0x23 | ( ( ci >> 11 ) & 4 ) );
+		}
+		default:
+			return 0;
+	}
+}
+#endif
+
+#ifdef MINIRV32_EXT_ZK
+// Zbkb (the parts not in Zbb), Zbkc, Zbkx, Zkne, Zknd, Zknh and Zksh: scalar
+// crypto. Called for encodings MiniRV32IMAExecZb() doesn't recognise. The AES
+// instructions each do a single byte of a round, so are table driven.
+static const uint8_t MiniRV32IMAAesSbox[256] = {
+	0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+	0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+	0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+	0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+	0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+	0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+	0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+	0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+	0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+	0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+	0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+	0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+	0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+	0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+	0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+	0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16,
+};
+static const uint8_t MiniRV32IMAAesInvSbox[256] = {
+	0x52, 0x09, 0x6a, 0xd5, 0x30, 0x36, 0xa5, 0x38, 0xbf, 0x40, 0xa3, 0x9e, 0x81, 0xf3, 0xd7, 0xfb,
+	0x7c, 0xe3, 0x39, 0x82, 0x9b, 0x2f, 0xff, 0x87, 0x34, 0x8e, 0x43, 0x44, 0xc4, 0xde, 0xe9, 0xcb,
+	0x54, 0x7b, 0x94, 0x32, 0xa6, 0xc2, 0x23, 0x3d, 0xee, 0x4c, 0x95, 0x0b, 0x42, 0xfa, 0xc3, 0x4e,
+	0x08, 0x2e, 0xa1, 0x66, 0x28, 0xd9, 0x24, 0xb2, 0x76, 0x5b, 0xa2, 0x49, 0x6d, 0x8b, 0xd1, 0x25,
+	0x72, 0xf8, 0xf6, 0x64, 0x86, 0x68, 0x98, 0x16, 0xd4, 0xa4, 0x5c, 0xcc, 0x5d, 0x65, 0xb6, 0x92,
+	0x6c, 0x70, 0x48, 0x50, 0xfd, 0xed, 0xb9, 0xda, 0x5e, 0x15, 0x46, 0x57, 0xa7, 0x8d, 0x9d, 0x84,
+	0x90, 0xd8, 0xab, 0x00, 0x8c, 0xbc, 0xd3, 0x0a, 0xf7, 0xe4, 0x58, 0x05, 0xb8, 0xb3, 0x45, 0x06,
+	0xd0, 0x2c, 0x1e, 0x8f, 0xca, 0x3f, 0x0f, 0x02, 0xc1, 0xaf, 0xbd, 0x03, 0x01, 0x13, 0x8a, 0x6b,
+	0x3a, 0x91, 0x11, 0x41, 0x4f, 0x67, 0xdc, 0xea, 0x97, 0xf2, 0xcf, 0xce, 0xf0, 0xb4, 0xe6, 0x73,
+	0x96, 0xac, 0x74, 0x22, 0xe7, 0xad, 0x35, 0x85, 0xe2, 0xf9, 0x37, 0xe8, 0x1c, 0x75, 0xdf, 0x6e,
+	0x47, 0xf1, 0x1a, 0x71, 0x1d, 0x29, 0xc5, 0x89, 0x6f, 0xb7, 0x62, 0x0e, 0xaa, 0x18, 0xbe, 0x1b,
+	0xfc, 0x56, 0x3e, 0x4b, 0xc6, 0xd2, 0x79, 0x20, 0x9a, 0xdb, 0xc0, 0xfe, 0x78, 0xcd, 0x5a, 0xf4,
+	0x1f, 0xdd, 0xa8, 0x33, 0x88, 0x07, 0xc7, 0x31, 0xb1, 0x12, 0x10, 0x59, 0x27, 0x80, 0xec, 0x5f,
+	0x60, 0x51, 0x7f, 0xa9, 0x19, 0xb5, 0x4a, 0x0d, 0x2d, 0xe5, 0x7a, 0x9f, 0x93, 0xc9, 0x9c, 0xef,
+	0xa0, 0xe0, 0x3b, 0x4d, 0xae, 0x2a, 0xf5, 0xb0, 0xc8, 0xeb, 0xbb, 0x3c, 0x83, 0x53, 0x99, 0x61,
+	0x17, 0x2b, 0x04, 0x7e, 0xba, 0x77, 0xd6, 0x26, 0xe1, 0x69, 0x14, 0x63, 0x55, 0x21, 0x0c, 0x7d,
+};
+
+#define MINIRV32_ROR32( x, n ) ( ( ( x ) >> ( n ) ) | ( ( x ) << ( 32 - ( n ) ) ) )
+#define MINIRV32_XTIME( x ) ( ( ( x ) << 1 ) ^ ( ( ( x ) & 0x80 ) ? 0x11b : 0 ) )
+
+MINIRV32_DECORATE uint32_t MiniRV32IMAExecZk( uint32_t ir, uint32_t rs1, uint32_t rs2, uint32_t * trap )
+{
+	uint32_t is_reg = !!( ir & 0x20 );
+	uint32_t sel = ( ir >> 20 ) & 0x1f;
+	uint32_t r = 0;
+	int i;
+
+	if( is_reg && ( ( ir >> 12 ) & 7 ) == 0 && ( ( ir >> 25 ) & 0x19 ) == 0x11 ) // AES32ESI, AES32ESMI, AES32DSI, AES32DSMI
+	{
+		uint32_t shamt = ( ir >> 27 ) & 0x18; // bs * 8
+		uint32_t si = ( rs2 >> shamt ) & 0xff;
+		uint32_t so, x2, x4, x8;
+		if( !( ir & 0x08000000 ) )
+		{
+			so = MiniRV32IMAAesSbox[si];
+			x2 = MINIRV32_XTIME( so );
+			r = ( ir & 0x04000000 ) ? ( ( ( x2 ^ so ) << 24 ) | ( so << 16 ) | ( so << 8 ) | x2 ) : so;
+		}
+		else
+		{
+			so = MiniRV32IMAAesInvSbox[si];
+			x2 = MINIRV32_XTIME( so );
+			x4 = MINIRV32_XTIME( x2 );
+			x8 = MINIRV32_XTIME( x4 );
+			r = ( ir & 0x04000000 ) ? ( ( ( x8 ^ x2 ^ so ) << 24 ) | ( ( x8 ^ x4 ^ so ) << 16 ) | ( ( x8 ^ so ) << 8 ) | ( x8 ^ x4 ^ x2 ) ) : so;
+		}
+		return rs1 ^ ( shamt ? MINIRV32_ROR32( r, 32 - shamt ) : r );
+	}
+
+	switch( ( ( ir >> 22 ) & 0x3f8 ) | ( ( ir >> 12 ) & 7 ) ) // funct7:funct3
+	{
+		case 0x24: if( is_reg ) return ( rs1 & 0xffff ) | ( rs2 << 16 ); break; // PACK
+		case 0x27: if( is_reg ) return ( rs1 & 0xff ) | ( ( rs2 & 0xff ) << 8 ); break; // PACKH
+		case 0x29: // CLMUL
+		case 0x2b: // CLMULH
+			if( !is_reg ) break;
+			for( i = 1; i < 32; i++ )
+				if( ( rs2 >> i ) & 1 ) r ^= ( ir & 0x2000 ) ? ( rs1 >> ( 32 - i ) ) : ( rs1 << i );
+			if( !( ir & 0x2000 ) && ( rs2 & 1 ) ) r ^= rs1;
+			return r;
+		case 0xa2: // XPERM4
+			if( !is_reg ) break;
+			for( i = 0; i < 32; i += 4 )
+			{
+				uint32_t idx = ( rs2 >> i ) & 0xf;
+				if( idx < 8 ) r |= ( ( rs1 >> ( idx * 4 ) ) & 0xf ) << i;
+			}
+			return r;
+		case 0xa4: // XPERM8
+			if( !is_reg ) break;
+			for( i = 0; i < 32; i += 8 )
+			{
+				uint32_t idx = ( rs2 >> i ) & 0xff;
+				if( idx < 4 ) r |= ( ( rs1 >> ( idx * 8 ) ) & 0xff ) << i;
+			}
+			return r;
+		case 0x21: // ZIP
+			if( is_reg || sel != 0xf ) break;
+			for( i = 0; i < 16; i++ )
+				r |= ( ( ( rs1 >> i ) & 1 ) << ( 2 * i ) ) | ( ( ( rs1 >> ( i + 16 ) ) & 1 ) << ( 2 * i + 1 ) );
+			return r;
+		case 0x25: // UNZIP
+			if( is_reg || sel != 0xf ) break;
+			for( i = 0; i < 16; i++ )
+				r |= ( ( ( rs1 >> ( 2 * i ) ) & 1 ) << i ) | ( ( ( rs1 >> ( 2 * i + 1 ) ) & 1 ) << ( i + 16 ) );
+			return r;
+		case 0x1a5: // BREV8
+			if( is_reg || sel != 7 ) break;
+			for( i = 0; i < 8; i++ )
+				r |= ( ( rs1 >> i ) & 0x01010101 ) << ( 7 - i );
+			return r;
+		case 0x41:
+			if( is_reg ) break;
+			switch( sel )
+			{
+				case 0: return MINIRV32_ROR32( rs1, 2 ) ^ MINIRV32_ROR32( rs1, 13 ) ^ MINIRV32_ROR32( rs1, 22 ); // SHA256SUM0
+				case 1: return MINIRV32_ROR32( rs1, 6 ) ^ MINIRV32_ROR32( rs1, 11 ) ^ MINIRV32_ROR32( rs1, 25 ); // SHA256SUM1
+				case 2: return MINIRV32_ROR32( rs1, 7 ) ^ MINIRV32_ROR32( rs1, 18 ) ^ ( rs1 >> 3 ); // SHA256SIG0
+				case 3: return MINIRV32_ROR32( rs1, 17 ) ^ MINIRV32_ROR32( rs1, 19 ) ^ ( rs1 >> 10 ); // SHA256SIG1
+				case 8: return rs1 ^ MINIRV32_ROR32( rs1, 23 ) ^ MINIRV32_ROR32( rs1, 15 ); // SM3P0
+				case 9: return rs1 ^ MINIRV32_ROR32( rs1, 17 ) ^ MINIRV32_ROR32( rs1, 9 ); // SM3P1
+			}
+			break;
+		// RV32 SHA-512, rs1 and rs2 hold the two halves of a 64 bit value
+		case 0x140: if( is_reg ) return ( rs1 << 25 ) ^ ( rs1 << 30 ) ^ ( rs1 >> 28 ) ^ ( rs2 >> 7 ) ^ ( rs2 >> 2 ) ^ ( rs2 << 4 ); break; // SHA512SUM0R
+		case 0x148: if( is_reg ) return ( rs1 << 23 ) ^ ( rs1 >> 14 ) ^ ( rs1 >> 18 ) ^ ( rs2 >> 9 ) ^ ( rs2 << 18 ) ^ ( rs2 << 14 ); break; // SHA512SUM1R
+		case 0x150: if( is_reg ) return ( rs1 >> 1 ) ^ ( rs1 >> 7 ) ^ ( rs1 >> 8 ) ^ ( rs2 << 31 ) ^ ( rs2 << 25 ) ^ ( rs2 << 24 ); break; // SHA512SIG0L
+		case 0x158: if( is_reg ) return ( rs1 << 3 ) ^ ( rs1 >> 6 ) ^ ( rs1 >> 19 ) ^ ( rs2 >> 29 ) ^ ( rs2 << 26 ) ^ ( rs2 << 13 ); break; // SHA512SIG1L
+		case 0x170: if( is_reg ) return ( rs1 >> 1 ) ^ ( rs1 >> 7 ) ^ ( rs1 >> 8 ) ^ ( rs2 << 31 ) ^ ( rs2 << 24 ); break; // SHA512SIG0H
+		case 0x178: if( is_reg ) return ( rs1 << 3 ) ^ ( rs1 >> 6 ) ^ ( rs1 >> 19 ) ^ ( rs2 >> 29 ) ^ ( rs2 << 13 ); break; // SHA512SIG1H
+	}
+	*trap = (2+1); // Illegal opcode.
+	return 0;
+}
+#endif
+
+#ifdef MINIRV32_EXT_ZB
+#ifndef MINIRV32_CLZ
+	#define MINIRV32_CLZ( x ) __builtin_clz( x )
+	#define MINIRV32_CTZ( x ) __builtin_ctz( x )
+	#define MINIRV32_CPOP( x ) __builtin_popcount( x )
+	#define MINIRV32_BSWAP( x ) __builtin_bswap32( x )
+#endif
+
+// Zba, Zbb, Zbs: bit manipulation. Called for OP and OP-IMM encodings which are
+// not part of the base ISA or RV32M. rs2 holds the register value for OP, the
+// sign extended immediate for OP-IMM.
+MINIRV32_DECORATE uint32_t MiniRV32IMAExecZb( uint32_t ir, uint32_t rs1, uint32_t rs2, uint32_t * trap )
+{
+	uint32_t is_reg = !!( ir & 0x20 );
+	uint32_t sh = rs2 & 0x1f;
+	uint32_t sel = ( ir >> 20 ) & 0x1f;
+
+	switch( ( ( ir >> 22 ) & 0x3f8 ) | ( ( ir >> 12 ) & 7 ) ) // funct7:funct3
+	{
+		case 0x24: if( is_reg && sel == 0 ) return rs1 & 0xffff; break; // ZEXT.H
+		case 0x2c: if( is_reg ) return (int32_t)rs1 < (int32_t)rs2 ? rs1 : rs2; break; // MIN
+		case 0x2d: if( is_reg ) return rs1 < rs2 ? rs1 : rs2; break; // MINU
+		case 0x2e: if( is_reg ) return (int32_t)rs1 > (int32_t)rs2 ? rs1 : rs2; break; // MAX
+		case 0x2f: if( is_reg ) return rs1 > rs2 ? rs1 : rs2; break; // MAXU
+		case 0x82: if( is_reg ) return ( rs1 << 1 ) + rs2; break; // SH1ADD
+		case 0x84: if( is_reg ) return ( rs1 << 2 ) + rs2; break; // SH2ADD
+		case 0x86: if( is_reg ) return ( rs1 << 3 ) + rs2; break; // SH3ADD
+		case 0x104: if( is_reg ) return ~( rs1 ^ rs2 ); break; // XNOR
+		case 0x106: if( is_reg ) return rs1 | ~rs2; break; // ORN
+		case 0x107: if( is_reg ) return rs1 & ~rs2; break; // ANDN
+		case 0xa1: return rs1 | ( 1u << sh ); // BSET, BSETI
+		case 0x121: return rs1 & ~( 1u << sh ); // BCLR, BCLRI
+		case 0x125: return ( rs1 >> sh ) & 1; // BEXT, BEXTI
+		case 0x1a1: return rs1 ^ ( 1u << sh ); // BINV, BINVI
+		case 0x185: return ( rs1 >> sh ) | ( rs1 << ( ( 32 - sh ) & 0x1f ) ); // ROR, RORI
+		case 0x181:
+			if( is_reg ) return ( rs1 << sh ) | ( rs1 >> ( ( 32 - sh ) & 0x1f ) ); // ROL
+			switch( sel )
+			{
+				case 0: return rs1 ? MINIRV32_CLZ( rs1 ) : 32; // CLZ
+				case 1: return rs1 ? MINIRV32_CTZ( rs1 ) : 32; // CTZ
+				case 2: return MINIRV32_CPOP( rs1 ); // CPOP
+				case 4: return (int32_t)(int8_t)rs1; // SEXT.B
+				case 5: return (int32_t)(int16_t)rs1; // SEXT.H
+			}
+			break;
+		case 0xa5: // ORC.B
+			if( !is_reg && sel == 7 )
+			{
+				uint32_t r = 0;
+				if( rs1 & 0x000000ff ) r |= 0x000000ff;
+				if( rs1 & 0x0000ff00 ) r |= 0x0000ff00;
+				if( rs1 & 0x00ff0000 ) r |= 0x00ff0000;
+				if( rs1 & 0xff000000 ) r |= 0xff000000;
+				return r;
+			}
+			break;
+		case 0x1a5: if( !is_reg && sel == 0x18 ) return MINIRV32_BSWAP( rs1 ); break; // REV8
+	}
+#ifdef MINIRV32_EXT_ZK
+	return MiniRV32IMAExecZk( ir, rs1, rs2, trap );
+#else
+	*trap = (2+1); // Illegal opcode.
+	return 0;
+#endif
+}
+#endif
+
+#ifdef MINIRV32_EXT_F
+#include <math.h>
+#include <fenv.h>
+
+// RV32F: single precision floating point, executed with host floats. Accrued
+// exception flags are collected from the host FPU, which is cleared at the start
+// of each MiniRV32IMAStep() and read back at the end of it (or when the guest
+// reads fflags). RMM rounding is only exact for conversions to integer, other
+// operations round to nearest even in that mode.
+#define MINIRV32_F_NV 0x10
+#define MINIRV32_F_DZ 0x08
+#define MINIRV32_F_OF 0x04
+#define MINIRV32_F_UF 0x02
+#define MINIRV32_F_NX 0x01
+#define MINIRV32_F_CANONICAL_NAN 0x7fc00000
+#define MINIRV32_F_ISNAN( u ) ( ( ( u ) & 0x7fffffff ) > 0x7f800000 )
+#define MINIRV32_F_ISSNAN( u ) ( MINIRV32_F_ISNAN( u ) && !( ( u ) & 0x00400000 ) )
+
+typedef union
+{
+	float f;
+	uint32_t u;
+} MiniRV32IMAFloat;
+
+MINIRV32_DECORATE uint32_t MiniRV32IMAHostFlags( void )
+{
+	int ex = fetestexcept( FE_ALL_EXCEPT );
+	return ( ( ex & FE_INVALID ) ? MINIRV32_F_NV : 0 ) | ( ( ex & FE_DIVBYZERO ) ? MINIRV32_F_DZ : 0 ) |
+		( ( ex & FE_OVERFLOW ) ? MINIRV32_F_OF : 0 ) | ( ( ex & FE_UNDERFLOW ) ? MINIRV32_F_UF : 0 ) |
+		( ( ex & FE_INEXACT ) ? MINIRV32_F_NX : 0 );
+}
+
+// CSRRW etc on fflags (1), frm (2) and fcsr (3), returns the old value.
+MINIRV32_DECORATE uint32_t MiniRV32IMACsrF( struct MiniRV32IMAState * state, uint32_t csrno, uint32_t microop, uint32_t rs1imm )
+{
+	uint32_t shift = ( csrno == 2 ) ? 5 : 0;
+	uint32_t mask = ( csrno == 1 ) ? 0x1f : ( ( csrno == 2 ) ? 0x07 : 0xff );
+	uint32_t rs1 = ( microop & 4 ) ? rs1imm : REG( rs1imm );
+	uint32_t rval, writeval;
+
+	CSR( fcsr ) |= MiniRV32IMAHostFlags();
+	rval = ( CSR( fcsr ) >> shift ) & mask;
+	switch( microop & 3 )
+	{
+		case 1: writeval = rs1; break;           //CSRRW(I)
+		case 2: writeval = rval | rs1; break;    //CSRRS(I)
+		default: writeval = rval & ~rs1; break;  //CSRRC(I)
+	}
+	CSR( fcsr ) = ( CSR( fcsr ) & ~( mask << shift ) ) | ( ( writeval & mask ) << shift );
+	feclearexcept( FE_ALL_EXCEPT ); // Already accrued into fcsr
+	return rval;
+}
+
+// FCVT.W.S and FCVT.WU.S, rounding is done here without touching the host
+// rounding mode. Out of range values saturate and raise NV.
+MINIRV32_DECORATE uint32_t MiniRV32IMAFToInt( struct MiniRV32IMAState * state, uint32_t u, uint32_t rm, uint32_t is_unsigned )
+{
+	MiniRV32IMAFloat v, t;
+	uint32_t e = ( u >> 23 ) & 0xff;
+	uint32_t inexact = 0;
+
+	v.u = u;
+	t.u = u;
+	if( MINIRV32_F_ISNAN( u ) )
+	{
+		CSR( fcsr ) |= MINIRV32_F_NV;
+		return is_unsigned ? 0xffffffff : 0x7fffffff;
+	}
+	if( e < 150 ) // Has a fractional part, truncate by masking it off
+	{
+		t.u &= ( e < 127 ) ? 0x80000000 : ~( ( 1u << ( 150 - e ) ) - 1 );
+		float d = v.f - t.f;
+		inexact = d != 0;
+		switch( rm )
+		{
+			case 0: // RNE
+				if( d > 0.5f || ( d == 0.5f && ( (int32_t)t.f & 1 ) ) ) t.f += 1;
+				else if( d < -0.5f || ( d == -0.5f && ( (int32_t)t.f & 1 ) ) ) t.f -= 1;
+				break;
+			case 2: if( d < 0 ) t.f -= 1; break; // RDN
+			case 3: if( d > 0 ) t.f += 1; break; // RUP
+			case 4: // RMM
+				if( d >= 0.5f ) t.f += 1;
+				else if( d <= -0.5f ) t.f -= 1;
+				break;
+		}
+	}
+	if( is_unsigned ? !( t.f >= 0 && t.f < 4294967296.0f ) : !( t.f >= -2147483648.0f && t.f < 2147483648.0f ) )
+	{
+		CSR( fcsr ) |= MINIRV32_F_NV;
+		if( is_unsigned ) return t.f < 0 ? 0 : 0xffffffff;
+		return t.f < 0 ? 0x80000000 : 0x7fffffff;
+	}
+	if( inexact ) CSR( fcsr ) |= MINIRV32_F_NX;
+	return is_unsigned ? (uint32_t)t.f : (uint32_t)(int32_t)t.f;
+}
+
+// FMADD.S etc and OP-FP. Results for f registers are written here and *rdid is
+// cleared, results for x registers are returned.
+MINIRV32_DECORATE uint32_t MiniRV32IMAExecF( struct MiniRV32IMAState * state, uint32_t ir, uint32_t * rdid, uint32_t * trap )
+{
+	uint32_t op = ir & 0x7f;
+	uint32_t funct5 = ir >> 27;
+	uint32_t funct3 = ( ir >> 12 ) & 7;
+	uint32_t rs2id = ( ir >> 20 ) & 0x1f;
+	uint32_t rm = funct3;
+	MiniRV32IMAFloat a, b, c, r;
+
+	a.u = FREG( ( ir >> 15 ) & 0x1f );
+	b.u = FREG( rs2id );
+	c.u = FREG( ir >> 27 );
+
+	if( ir & 0x06000000 ) // Only fmt=S
+	{
+		*trap = (2+1);
+		return 0;
+	}
+
+	if( op != 0x53 || funct5 <= 0x03 || funct5 == 0x0b || funct5 == 0x18 || funct5 == 0x1a ) // Uses rm
+	{
+		if( rm == 7 ) rm = ( CSR( fcsr ) >> 5 ) & 7;
+		if( rm > 4 )
+		{
+			*trap = (2+1);
+			return 0;
+		}
+	}
+
+	if( op == 0x53 )
+	{
+		// Operations which don't round
+		switch( funct5 )
+		{
+			case 0x04: // FSGNJ.S, FSGNJN.S, FSGNJX.S
+				if( funct3 > 2 ) break;
+				r.u = b.u & 0x80000000;
+				if( funct3 == 1 ) r.u ^= 0x80000000;
+				if( funct3 == 2 ) r.u ^= a.u & 0x80000000;
+				FREGSET( *rdid, ( a.u & 0x7fffffff ) | r.u );
+				*rdid = 0;
+				return 0;
+			case 0x05: // FMIN.S, FMAX.S
+				if( funct3 > 1 ) break;
+				if( MINIRV32_F_ISSNAN( a.u ) || MINIRV32_F_ISSNAN( b.u ) ) CSR( fcsr ) |= MINIRV32_F_NV;
+				if( MINIRV32_F_ISNAN( a.u ) && MINIRV32_F_ISNAN( b.u ) ) r.u = MINIRV32_F_CANONICAL_NAN;
+				else if( MINIRV32_F_ISNAN( a.u ) ) r.u = b.u;
+				else if( MINIRV32_F_ISNAN( b.u ) ) r.u = a.u;
+				else if( a.f == b.f ) r.u = funct3 ? ( a.u & b.u ) : ( a.u | b.u ); // -0.0 < +0.0
+				else r.u = ( ( a.f < b.f ) != funct3 ) ? a.u : b.u;
+				FREGSET( *rdid, r.u );
+				*rdid = 0;
+				return 0;
+			case 0x14: // FLE.S, FLT.S, FEQ.S
+				if( funct3 > 2 ) break;
+				if( MINIRV32_F_ISNAN( a.u ) || MINIRV32_F_ISNAN( b.u ) )
+				{
+					// FEQ.S is a quiet comparison
+					if( funct3 != 2 || MINIRV32_F_ISSNAN( a.u ) || MINIRV32_F_ISSNAN( b.u ) ) CSR( fcsr ) |= MINIRV32_F_NV;
+					return 0;
+				}
+				if( funct3 == 0 ) return a.f <= b.f;
+				if( funct3 == 1 ) return a.f < b.f;
+				return a.f == b.f;
+			case 0x18: // FCVT.W.S, FCVT.WU.S
+				if( rs2id > 1 ) break;
+				return MiniRV32IMAFToInt( state, a.u, rm, rs2id );
+			case 0x1c:
+				if( rs2id != 0 ) break;
+				if( funct3 == 0 ) return a.u; // FMV.X.W
+				if( funct3 == 1 ) // FCLASS.S
+				{
+					uint32_t neg = a.u >> 31;
+					uint32_t e = ( a.u >> 23 ) & 0xff;
+					uint32_t m = a.u & 0x7fffff;
+					if( e == 0xff ) return m ? ( ( m & 0x400000 ) ? 0x200 : 0x100 ) : ( neg ? 0x001 : 0x080 );
+					if( e == 0 ) return m ? ( neg ? 0x004 : 0x020 ) : ( neg ? 0x008 : 0x010 );
+					return neg ? 0x002 : 0x040;
+				}
+				break;
+			case 0x1e: // FMV.W.X
+				if( rs2id != 0 || funct3 != 0 ) break;
+				FREGSET( *rdid, REG( ( ir >> 15 ) & 0x1f ) );
+				*rdid = 0;
+				return 0;
+		}
+	}
+
+	if( rm >= 1 && rm <= 3 ) fesetround( rm == 1 ? FE_TOWARDZERO : ( rm == 2 ? FE_DOWNWARD : FE_UPWARD ) );
+	switch( op )
+	{
+		case 0x43: r.f = fmaf( a.f, b.f, c.f ); break; // FMADD.S
+		case 0x47: r.f = fmaf( a.f, b.f, -c.f ); break; // FMSUB.S
+		case 0x4b: r.f = fmaf( -a.f, b.f, c.f ); break; // FNMSUB.S
+		case 0x4f: r.f = fmaf( -a.f, b.f, -c.f ); break; // FNMADD.S
+		default:
+			switch( funct5 )
+			{
+				case 0x00: r.f = a.f + b.f; break; // FADD.S
+				case 0x01: r.f = a.f - b.f; break; // FSUB.S
+				case 0x02: r.f = a.f * b.f; break; // FMUL.S
+				case 0x03: r.f = a.f / b.f; break; // FDIV.S
+				case 0x0b: if( rs2id == 0 ) { r.f = sqrtf( a.f ); break; } *trap = (2+1); break; // FSQRT.S
+				case 0x1a: // FCVT.S.W, FCVT.S.WU
+					if( rs2id > 1 ) { *trap = (2+1); break; }
+					r.f = rs2id ? (float)REG( ( ir >> 15 ) & 0x1f ) : (float)(int32_t)REG( ( ir >> 15 ) & 0x1f );
+					break;
+				default: *trap = (2+1); break;
+			}
+	}
+	if( rm >= 1 && rm <= 3 ) fesetround( FE_TONEAREST );
+
+	if( !*trap )
+	{
+		FREGSET( *rdid, MINIRV32_F_ISNAN( r.u ) ? MINIRV32_F_CANONICAL_NAN : r.u );
+	}
+	*rdid = 0;
+	return 0;
+}
+#endif
 
 #ifndef MINIRV32_STEPPROTO
 MINIRV32_DECORATE int32_t MiniRV32IMAStep(void *userdata, struct MiniRV32IMAState * state, uint8_t * image,
@@ -151,6 +822,10 @@ MINIRV32_STEPPROTO
 	uint32_t trap = 0;
 	uint32_t rval = 0;
 	uint32_t pc = CSR( pc );
+	int icount = 0;
+#ifdef MINIRV32_EXT_F
+	feclearexcept( FE_ALL_EXCEPT );
+#endif
 #ifndef MINIRV32_NO_TIMERS_NO_CYCLES
 	uint32_t cycle = CSR( cyclel );
 #endif
@@ -164,7 +839,7 @@ MINIRV32_STEPPROTO
 	}
 	else // No timer interrupt?  Execute a bunch of instructions.
 #endif
-	for( int icount = 0; icount < count; icount++ )
+	for( ; icount < count; icount++ )
 	{
 		uint32_t ir = 0;
 		rval = 0;
@@ -172,22 +847,76 @@ MINIRV32_STEPPROTO
 		cycle++;
 #endif
 		uint32_t ofs_pc = pc - MINIRV32_RAM_IMAGE_OFFSET;
+		uint32_t ilen = 4; // Length of this instruction, 2 for RV32C
 
-		if( ofs_pc >= MINI_RV32_RAM_SIZE )
+#ifdef MINIRV32_EXT_C
+		if( ofs_pc & 1 )
+#else
+		if( ofs_pc & 3 )
+#endif
 		{
-			trap = 1 + 1;  // Handle access violation on instruction read.
+			trap = 1 + 0;  //Handle PC-misaligned access
 			break;
 		}
-		else if( ofs_pc & 3 )
+		else if( ofs_pc < MINI_RV32_RAM_SIZE )
 		{
-			trap = 1 + 0;  //Handle PC-misaligned access
-			break;
+#ifdef MINIRV32_EXT_C
+			// Instructions may only be 2 byte aligned, so MINIRV32_LOAD4 must allow unaligned access
+			if( ofs_pc < MINI_RV32_RAM_SIZE - 2 )
+			{
+				ir = MINIRV32_LOAD4( ofs_pc );
+			}
+			else
+			{
+				ir = MINIRV32_LOAD2( ofs_pc );
+				if( ( ir & 3 ) == 3 )
+				{
+					trap = 1 + 1;  // Second half of instruction is outside of memory
+					break;
+				}
+			}
+#else
+			ir = MINIRV32_LOAD4( ofs_pc );
+#endif
+		}
+#ifdef MINIRV32_HANDLE_FETCH_CONTROL
+		else if( MINIRV32_MMIO_RANGE( pc ) )
+		{
+			MINIRV32_HANDLE_FETCH_CONTROL( pc, ir );
+			if( trap ) break;
 		}
+#endif
 		else
 		{
-			ir = MINIRV32_LOAD4( ofs_pc );
+			trap = 1 + 1;  // Handle access violation on instruction read.
+			break;
+		}
+
+		{
+#ifdef MINIRV32_EXT_C
+			if( ( ir & 3 ) != 3 )
+			{
+				ir = MiniRV32IMAExpandC( ir & 0xffff );
+				ilen = 2;
+			}
+#endif
 			uint32_t rdid = (ir >> 7) & 0x1f;
 
+#ifdef MINIRV32_RV32E
+			// x16-x31 do not exist, trap before the instruction has any effect
+			// rather than let reads alias x0-x15
+			uint32_t readsx = MiniRV32IMAReadsX( ir );
+			if( ( ( rdid & 0x10 ) && MiniRV32IMAWritesX( ir ) ) ||
+				( ( readsx & 1 ) && ( ir & ( 0x10 << 15 ) ) ) ||
+				( ( readsx & 2 ) && ( ir & ( 0x10 << 20 ) ) ) )
+			{
+				trap = (2+1);
+				SETCSR( pc, pc );
+				MINIRV32_POSTEXEC( pc, ir, trap );
+				break;
+			}
+#endif
+
 			switch( ir & 0x7f )
 			{
 				case 0x37: // LUI (0b0110111)
@@ -200,16 +929,16 @@ MINIRV32_STEPPROTO
 				{
 					int32_t reladdy = ((ir & 0x80000000)>>11) | ((ir & 0x7fe00000)>>20) | ((ir & 0x00100000)>>9) | ((ir&0x000ff000));
 					if( reladdy & 0x00100000 ) reladdy |= 0xffe00000; // Sign extension.
-					rval = pc + 4;
-					pc = pc + reladdy - 4;
+					rval = pc + ilen;
+					pc = pc + reladdy - ilen;
 					break;
 				}
 				case 0x67: // JALR (0b1100111)
 				{
 					uint32_t imm = ir >> 20;
 					int32_t imm_se = imm | (( imm & 0x800 )?0xfffff000:0);
-					rval = pc + 4;
-					pc = ( (REG( (ir >> 15) & 0x1f ) + imm_se) & ~1) - 4;
+					rval = pc + ilen;
+					pc = ( (REG( (ir >> 15) & 0x1f ) + imm_se) & ~1) - ilen;
 					break;
 				}
 				case 0x63: // Branch (0b1100011)
@@ -218,7 +947,7 @@ MINIRV32_STEPPROTO
 					if( immm4 & 0x1000 ) immm4 |= 0xffffe000;
 					int32_t rs1 = REG((ir >> 15) & 0x1f);
 					int32_t rs2 = REG((ir >> 20) & 0x1f);
-					immm4 = pc + immm4 - 4;
+					immm4 = pc + immm4 - ilen;
 					rdid = 0;
 					switch( ( ir >> 12 ) & 0x7 )
 					{
@@ -233,6 +962,15 @@ MINIRV32_STEPPROTO
 					}
 					break;
 				}
+#ifdef MINIRV32_EXT_F
+				case 0x07: // FLW (0b0000111)
+					if( ( ( ir >> 12 ) & 0x7 ) != 2 )
+					{
+						trap = (2+1);
+						break;
+					}
+					// Fall through, it's a LW into an f register
+#endif
 				case 0x03: // Load (0b0000011)
 				{
 					uint32_t rs1 = REG((ir >> 15) & 0x1f);
@@ -267,12 +1005,32 @@ MINIRV32_STEPPROTO
 							default: trap = (2+1);
 						}
 					}
+#ifdef MINIRV32_EXT_F
+					if( ( ir & 0x04 ) && !trap )
+					{
+						FREGSET( rdid, rval );
+						rdid = 0;
+					}
+#endif
 					break;
 				}
+#ifdef MINIRV32_EXT_F
+				case 0x27: // FSW (0b0100111)
+					if( ( ( ir >> 12 ) & 0x7 ) != 2 )
+					{
+						trap = (2+1);
+						break;
+					}
+					// Fall through, it's a SW from an f register
+#endif
 				case 0x23: // Store 0b0100011
 				{
 					uint32_t rs1 = REG((ir >> 15) & 0x1f);
+#ifdef MINIRV32_EXT_F
+					uint32_t rs2 = ( ir & 0x04 ) ? FREG((ir >> 20) & 0x1f) : REG((ir >> 20) & 0x1f);
+#else
 					uint32_t rs2 = REG((ir >> 20) & 0x1f);
+#endif
 					uint32_t addy = ( ( ir >> 7 ) & 0x1f ) | ( ( ir & 0xfe000000 ) >> 20 );
 					if( addy & 0x800 ) addy |= 0xfffff000;
 					addy += rs1 - MINIRV32_RAM_IMAGE_OFFSET;
@@ -313,6 +1071,17 @@ MINIRV32_STEPPROTO
 					uint32_t is_reg = !!( ir & 0x20 );
 					uint32_t rs2 = is_reg ? REG(imm & 0x1f) : imm;
 
+#ifdef MINIRV32_EXT_ZB
+					uint32_t funct3 = ( ir >> 12 ) & 7;
+					uint32_t funct7 = ir >> 25;
+					// Everything other than the base shifts, SUB/SRA and RV32M is bit manipulation
+					if( is_reg ? ( funct7 > 1 && !( funct7 == 0x20 && ( funct3 == 0 || funct3 == 5 ) ) ) :
+						( ( funct3 & 3 ) == 1 && funct7 != 0 && !( funct7 == 0x20 && funct3 == 5 ) ) )
+					{
+						rval = MiniRV32IMAExecZb( ir, rs1, rs2, &trap );
+					}
+					else
+#endif
 					if( is_reg && ( ir & 0x02000000 ) )
 					{
 						switch( (ir>>12)&7 ) //0x02000000 = RV32M
@@ -347,6 +1116,27 @@ MINIRV32_STEPPROTO
 					}
 					break;
 				}
+#ifdef MINIRV32_EXT_F
+				case 0x53: // OP-FP (0b1010011)
+				case 0x43: // FMADD.S (0b1000011)
+				case 0x47: // FMSUB.S (0b1000111)
+				case 0x4b: // FNMSUB.S (0b1001011)
+				case 0x4f: // FNMADD.S (0b1001111)
+					rval = MiniRV32IMAExecF( state, ir, &rdid, &trap );
+					break;
+#endif
+#ifdef MINIRV32_HANDLE_CUSTOM
+				case 0x0b: // custom-0 (0b0001011)
+				case 0x2b: // custom-1 (0b0101011)
+				case 0x5b: // custom-2 (0b1011011)
+				case 0x7b: // custom-3 (0b1111011)
+				{
+					uint32_t rs1 = REG((ir >> 15) & 0x1f);
+					uint32_t rs2 = REG((ir >> 20) & 0x1f);
+					MINIRV32_HANDLE_CUSTOM( ir, rs1, rs2, rval );
+					break;
+				}
+#endif
 				case 0x0f: // 0b0001111
 					rdid = 0;   // fencetype = (ir >> 12) & 0b111; We ignore fences in this impl.
 					break;
@@ -354,6 +1144,21 @@ MINIRV32_STEPPROTO
 				{
 					uint32_t csrno = ir >> 20;
 					uint32_t microop = ( ir >> 12 ) & 0x7;
+#ifdef MINIRV32_EXT_F
+					if( ( microop & 3 ) && csrno >= 0x001 && csrno <= 0x003 ) // fflags, frm, fcsr, even without Zicsr
+					{
+						rval = MiniRV32IMACsrF( state, csrno, microop, ( ir >> 15 ) & 0x1f );
+					}
+					else
+#endif
+#if defined( MINIRV32_NO_ZICSR ) && defined( MINIRV32_HANDLE_COUNTER_READ )
+					// csrrs/csrrc with rs1 = x0 or zero immediate, ie. csrr rd, cycle
+					if( ( microop & 2 ) && ( ( ir >> 15 ) & 0x1f ) == 0 && ( csrno & ~0x83 ) == 0xc00 && ( csrno & 3 ) != 3 )
+					{
+						MINIRV32_HANDLE_COUNTER_READ( csrno, icount, rval );
+					}
+					else
+#endif
 #ifndef MINIRV32_NO_ZICSR
 					if( (microop & 3) ) // It's a Zicsr function.
 					{
@@ -528,9 +1333,13 @@ MINIRV32_STEPPROTO
 
 		MINIRV32_POSTEXEC( pc, ir, trap );
 
-		pc += 4;
+		pc += ilen;
 	}
 
+#ifdef MINIRV32_EXT_F
+	CSR( fcsr ) |= MiniRV32IMAHostFlags();
+#endif
+
 	// Handle traps and interrupts.
 	if( trap )
 	{
@@ -558,6 +1367,9 @@ MINIRV32_STEPPROTO
 		pc += 4;
 #else
         if (trap > 0) {
+            // Leave pc on the faulting instruction, count it as executed
+            SETCSR( pc, pc );
+            MINIRV32_RETIRE( icount + 1 );
             return trap;
         }
 #endif
@@ -568,6 +1380,7 @@ MINIRV32_STEPPROTO
 	SETCSR( cyclel, cycle );
 #endif
 	SETCSR( pc, pc );
+	MINIRV32_RETIRE( icount );
 	return 0;
 }
 
@@ -104,8 +104,7 @@ void uvm32_init(uvm32_state_t *vmst) {
 
     // handled by memset
     // vmst->_status = UVM32_STATUS_PAUSED;
-    // vmst->_extramLen = 0;
-    // vmst->_extram = (uint8_t *)NULL;
+    // vmst->_regions[n].ptr = (uint8_t *)NULL;
     // vmst->_extramDirty = false;
 
     vmst->_core.pc = MINIRV32_RAM_IMAGE_OFFSET;
@@ -133,30 +132,43 @@ bool uvm32_load(uvm32_state_t *vmst, const uint8_t *rom, int len) {
     return true;
 }
 
+// Find the region containing addr, checking the most recently used one first
+static uvm32_region_t *find_region(uvm32_state_t *vmst, uint32_t addr) {
+    uvm32_region_t *r = &vmst->_regions[vmst->_lastRegion];
+
+    if (r->ptr != NULL && addr - r->base < r->len) {
+        return r;
+    }
+    for (uint32_t i=0;i<UVM32_MAX_REGIONS;i++) {
+        r = &vmst->_regions[i];
+        if (r->ptr != NULL && addr - r->base < r->len) {
+            vmst->_lastRegion = i;
+            return r;
+        }
+    }
+    return (uvm32_region_t *)NULL;
+}
+
 // Read C-string up to terminator and return len,ptr
 bool get_safeptr_null_terminated(uvm32_state_t *vmst, uint32_t addr, uvm32_slice_t *buf) {
     if (MINIRV32_MMIO_RANGE(addr)) {
-        if (vmst->_extram == NULL) {
+        uvm32_region_t *r = find_region(vmst, addr);
+        if (r == NULL || !(r->perm & UVM32_REGION_R)) {
+            // host reads only what VM code could load itself
             return false;
         } else {
-            uint32_t ptrstart = addr - UVM32_EXTRAM_BASE;
+            uint32_t ptrstart = addr - r->base;
             uint32_t p = ptrstart;
-            if (p >= vmst->_extramLen) {
-                setStatusErr(vmst, UVM32_ERR_MEM_RD);
-                buf->ptr = (uint8_t *)NULL;
-                buf->len = 0;
-                return false;
-            }
-            while(vmst->_extram[p] != '\0') {
+            while(r->ptr[p] != '\0') {
                 p++;
-                if (p >= vmst->_extramLen) {
+                if (p >= r->len) {
                     setStatusErr(vmst, UVM32_ERR_MEM_RD);
                     buf->ptr = (uint8_t *)NULL;
                     buf->len = 0;
                     return false;
                 }
             }
-            buf->ptr = (uint8_t *)&vmst->_extram[ptrstart];
+            buf->ptr = &r->ptr[ptrstart];
             buf->len = p - ptrstart;
             return true;
         }
@@ -184,26 +196,28 @@ bool get_safeptr_null_terminated(uvm32_state_t *vmst, uint32_t addr, uvm32_slice
     }
 }
 
-static bool get_safeptr(uvm32_state_t *vmst, uint32_t addr, uint32_t len, uvm32_slice_t *buf) {
+static bool get_safeptr(uvm32_state_t *vmst, uint32_t addr, uint32_t len, bool write, uvm32_slice_t *buf) {
     if (MINIRV32_MMIO_RANGE(addr)) {
-        if (vmst->_extram == NULL) {
+        uvm32_region_t *r = find_region(vmst, addr);
+        if (r == NULL) {
+            return false;
+        } else if (!(r->perm & (write ? UVM32_REGION_W : UVM32_REGION_R))) {
+            // host may only read or write through the slice what VM code could itself
             return false;
         } else {
-            uint32_t ptrstart = addr - UVM32_EXTRAM_BASE;
-            if ((ptrstart > vmst->_extramLen) || (ptrstart + len > vmst->_extramLen)) {
-                setStatusErr(vmst, UVM32_ERR_MEM_RD);
+            uint32_t ptrstart = addr - r->base;
+            if (len > r->len - ptrstart) {
                 buf->ptr = (uint8_t *)NULL;
                 buf->len = 0;
                 return false;
             }
-            buf->ptr = (uint8_t *)&vmst->_extram[ptrstart];
+            buf->ptr = &r->ptr[ptrstart];
             buf->len = len;
             return true;
         }
     } else {
         uint32_t ptrstart = addr - MINIRV32_RAM_IMAGE_OFFSET;
         if ((ptrstart > UVM32_MEMORY_SIZE) || (ptrstart + len > UVM32_MEMORY_SIZE)) {
-            setStatusErr(vmst, UVM32_ERR_MEM_RD);
             buf->ptr = (uint8_t *)NULL;
             buf->len = 0;
             return false;
@@ -222,11 +236,126 @@ void uvm32_clearError(uvm32_state_t *vmst) {
     }
 }
 
+#ifdef UVM32_INTERRUPTS
+// Enter the handler if an enabled interrupt is pending, it returns to UVM32_IRQ_RETURN
+static void take_interrupt(uvm32_state_t *vmst) {
+    const uint32_t irqs = vmst->_irqPending & vmst->_irqEnabled;
+
+    if (irqs == 0 || vmst->_irqHandler == 0 || vmst->_irqActive) {
+        return;
+    }
+    vmst->_irqPending &= ~irqs;
+    UVM32_MEMCPY(&vmst->_irqContext, &vmst->_core, sizeof(vmst->_core));
+    vmst->_irqActive = true;
+    vmst->_core.regs[1] = UVM32_IRQ_RETURN;     // ra
+    vmst->_core.regs[10] = irqs;                // a0
+    vmst->_core.pc = vmst->_irqHandler;
+}
+#endif
+
+// Interrupts pending which end UVM32_SYSCALL_WAIT, there are none without UVM32_INTERRUPTS
+static uint32_t wait_events(const uvm32_state_t *vmst) {
+#ifdef UVM32_INTERRUPTS
+    return vmst->_irqPending & vmst->_waitEvents;
+#else
+    return 0;
+#endif
+}
+
+// Read the virtual clock if set, else the host clock. `icount` is the number of
+// instructions run so far in the current step, not yet added to _instret
+static bool read_clock(const uvm32_state_t *vmst, uint32_t icount, uint64_t *now) {
+    if (vmst->_virtualRate != 0) {
+        const uint64_t instret = vmst->_instret + icount;
+        const uint32_t rate = vmst->_virtualRate;
+        // whole seconds first, so instret * 1000000 can't overflow
+        *now = (instret / rate) * 1000000 + (instret % rate) * 1000000 / rate + vmst->_virtualSkip;
+        return true;
+    }
+    if (vmst->_clock != NULL) {
+        *now = vmst->_clock(vmst->_clockUserdata);
+        return true;
+    }
+    return false;
+}
+
+// End UVM32_SYSCALL_WAIT if an interrupt it waits for is pending or its deadline has passed
+static bool wait_over(uvm32_state_t *vmst) {
+    const uint32_t irqs = wait_events(vmst);
+    uint64_t now;
+
+    if (irqs != 0) {
+#ifdef UVM32_INTERRUPTS
+        // reported by the wait, so not also passed to the handler
+        vmst->_irqPending &= ~irqs;
+#endif
+    } else if (vmst->_waitDeadline == UVM32_DEADLINE_NONE) {
+        return false;
+    } else if (read_clock(vmst, 0, &now) && now < vmst->_waitDeadline) {
+        if (vmst->_virtualRate == 0) {
+            return false;
+        }
+        // virtual time only moves as code runs, so skip to the deadline
+        vmst->_virtualSkip += vmst->_waitDeadline - now;
+    }
+    vmst->_core.regs[12] = irqs;    // a2
+    return true;
+}
+
+#ifdef UVM32_IDLE_DETECT
+// Count syscalls in a row made from the same address as a recent one, soon after
+// it and with every register unchanged. Such a loop is polling and getting the
+// same answer each time
+static uint32_t check_idle(uvm32_state_t *vmst) {
+    const uint32_t pc = vmst->_core.pc - 4;     // the ecall, pc has been advanced
+    uint32_t regs = 2166136261u;                // FNV-1a
+    uvm32_idle_t *s;
+
+    for (uint32_t i=0;i<sizeof(vmst->_core.regs) / sizeof(vmst->_core.regs[0]);i++) {
+        regs = (regs ^ vmst->_core.regs[i]) * 16777619u;
+    }
+    for (uint32_t i=0;i<UVM32_IDLE_SYSCALLS;i++) {
+        s = &vmst->_idle[i];
+        if (s->pc == pc) {
+            if (s->regs == regs && vmst->_instret - s->instret <= UVM32_IDLE_MAX_INSTRS) {
+                vmst->_idleCount++;
+            } else {
+                vmst->_idleCount = 0;
+            }
+            s->regs = regs;
+            s->instret = vmst->_instret;
+            return vmst->_idleCount;
+        }
+    }
+    // not made recently, replace the oldest
+    s = &vmst->_idle[vmst->_idleNext];
+    vmst->_idleNext = (vmst->_idleNext + 1) % UVM32_IDLE_SYSCALLS;
+    s->pc = pc;
+    s->regs = regs;
+    s->instret = vmst->_instret;
+    vmst->_idleCount = 0;
+    return 0;
+}
+#endif
+
+#ifdef UVM32_INTERRUPTS
+bool uvm32_interrupt(uvm32_state_t *vmst, uint32_t irq) {
+    if (irq >= UVM32_NUM_IRQS) {
+        return false;
+    }
+    vmst->_irqPending |= 1u << irq;
+    return true;
+}
+#endif
+
 uint32_t uvm32_run(uvm32_state_t *vmst, uvm32_evt_t *evt, uint32_t instr_meter) {
     const uint32_t min_instrs = 1;
     uint32_t orig_instr_meter = instr_meter;
 
     vmst->_extramDirty = false;
+    for (uint32_t i=0;i<UVM32_MAX_REGIONS;i++) {
+        vmst->_regions[i].dirty = false;
+    }
 
     if (instr_meter < min_instrs) {
         instr_meter = min_instrs;
@@ -241,6 +370,15 @@ uint32_t uvm32_run(uvm32_state_t *vmst, uvm32_evt_t *evt, uint32_t instr_meter)
     }
 #endif
 
+    if (vmst->_status == UVM32_STATUS_WAITING) {
+        if (!wait_over(vmst)) {
+            // still waiting, run nothing
+            UVM32_MEMCPY(evt, &vmst->_ioevt, sizeof(uvm32_evt_t));
+            return 0;
+        }
+        setStatus(vmst, UVM32_STATUS_PAUSED);
+    }
+
     if (vmst->_status != UVM32_STATUS_PAUSED) {
         setStatusErr(vmst, UVM32_ERR_NOTREADY);
         setup_err_evt(vmst, evt);
@@ -248,20 +386,37 @@ uint32_t uvm32_run(uvm32_state_t *vmst, uvm32_evt_t *evt, uint32_t instr_meter)
     }
 
     setStatus(vmst, UVM32_STATUS_RUNNING);
+#ifdef UVM32_INTERRUPTS
+    take_interrupt(vmst);
+#endif
 
     // run CPU until no longer in running state
     while(vmst->_status == UVM32_STATUS_RUNNING && instr_meter > 0) {
         uint32_t ret;
+        uint64_t instret = vmst->_instret;
+
+        // Execute as many instructions as the meter allows in one go, the core only
+        // returns early on a trap (ecall, fault), so jumps and calls never leave the loop
+        ret = MiniRV32IMAStep(vmst, &vmst->_core, vmst->_memory, instr_meter > INT32_MAX ? INT32_MAX : instr_meter);
+        instr_meter -= (uint32_t)(vmst->_instret - instret);
 
-        ret = MiniRV32IMAStep(vmst, &vmst->_core, vmst->_memory, 1);
-        instr_meter--;
-    
         switch(ret) {
             case 0:  // ok
+#if UVM32_MAX_WATCHES > 0
+                if (vmst->_watchHit) {
+                    // step was ended just after a store to a watched address
+                    vmst->_watchHit = false;
+                    setStatus(vmst, UVM32_STATUS_PAUSED);
+                }
+#endif
             break;
             case 12: { // ecall
                 // Fetch registers used by syscall
+#ifdef UVM32_RV32E
+                const uint32_t syscall = vmst->_core.regs[5];   // t0, RV32E has no a7
+#else
                 const uint32_t syscall = vmst->_core.regs[17];  // a7
+#endif
                 // on exception we should jump to mtvec, but we handle directly
                 // and skip over the ecall instruction
                 vmst->_core.pc += 4;
@@ -270,6 +425,51 @@ uint32_t uvm32_run(uvm32_state_t *vmst, uvm32_evt_t *evt, uint32_t instr_meter)
                      case UVM32_SYSCALL_HALT:
                         setStatus(vmst, UVM32_STATUS_ENDED);
                     break;
+                    case UVM32_SYSCALL_ASSETLEN: {
+                        const uvm32_region_t *r = find_region(vmst, UVM32_ASSET_BASE);
+                        vmst->_core.regs[12] = (r != NULL && r->base == UVM32_ASSET_BASE) ? r->len : 0;    // a2
+                    } break;
+#ifdef UVM32_INTERRUPTS
+                    case UVM32_SYSCALL_IRQHANDLER:
+                        vmst->_irqHandler = vmst->_core.regs[10];  // a0
+                        take_interrupt(vmst);
+                    break;
+#endif
+                    case UVM32_SYSCALL_WAIT: {
+                        const uint32_t timeout = vmst->_core.regs[10];  // a0
+                        uint64_t now;
+#ifdef UVM32_INTERRUPTS
+                        vmst->_waitEvents = vmst->_core.regs[11];       // a1
+#endif
+                        if (timeout == UVM32_WAIT_FOREVER) {
+                            vmst->_waitDeadline = UVM32_DEADLINE_NONE;
+                        } else if (read_clock(vmst, 0, &now)) {
+                            vmst->_waitDeadline = now + timeout;
+                        } else {
+                            vmst->_waitDeadline = timeout;
+                        }
+                        if (timeout != 0 && wait_events(vmst) == 0) {
+                            vmst->_ioevt.typ = UVM32_EVT_WAITING;
+                            vmst->_ioevt.data.wait.deadline = vmst->_waitDeadline;
+#ifdef UVM32_INTERRUPTS
+                            vmst->_ioevt.data.wait.events = vmst->_waitEvents;
+#else
+                            vmst->_ioevt.data.wait.events = 0;
+#endif
+                            setStatus(vmst, UVM32_STATUS_WAITING);
+                        } else {
+                            // nothing to wait for
+                            wait_over(vmst);
+                        }
+                    } break;
+#ifdef UVM32_INTERRUPTS
+                    case UVM32_SYSCALL_IRQENABLE:
+                        vmst->_core.regs[12] = vmst->_irqEnabled;   // a2
+                        vmst->_irqEnabled = vmst->_core.regs[10];   // a0
+                        // a pending interrupt is taken as soon as it is enabled
+                        take_interrupt(vmst);
+                    break;
+#endif
 #ifdef UVM32_STACK_PROTECTION
                     case UVM32_SYSCALL_STACKPROTECT: {
                         // don't allow errant code to change it once set
@@ -301,10 +501,29 @@ uint32_t uvm32_run(uvm32_state_t *vmst, uvm32_evt_t *evt, uint32_t instr_meter)
                         vmst->_ioevt.data.syscall._ret = &vmst->_core.regs[12];        // a2
                         vmst->_ioevt.data.syscall._params[0] = &vmst->_core.regs[10];  // a0
                         vmst->_ioevt.data.syscall._params[1] = &vmst->_core.regs[11];  // a1
+                        vmst->_ioevt.data.syscall._params[2] = &vmst->_core.regs[13];  // a3
+#ifdef UVM32_IDLE_DETECT
+                        vmst->_ioevt.data.syscall.idle = check_idle(vmst);
+#else
+                        vmst->_ioevt.data.syscall.idle = 0;
+#endif
                         setStatus(vmst, UVM32_STATUS_PAUSED);
                     break;
                 }   // end switch(syscall)
             } break; // end ecall
+            case 2:  // instruction fetch fault
+#ifdef UVM32_INTERRUPTS
+                if (vmst->_irqActive && vmst->_core.pc == UVM32_IRQ_RETURN) {
+                    // handler has returned, resume interrupted code
+                    UVM32_MEMCPY(&vmst->_core, &vmst->_irqContext, sizeof(vmst->_core));
+                    vmst->_irqActive = false;
+                    take_interrupt(vmst);
+                    break;
+                }
+#endif
+                setStatusErr(vmst, UVM32_ERR_INTERNAL_CORE);
+                setup_err_evt(vmst, evt);
+            break;
             case 6:
                 setStatusErr(vmst, UVM32_ERR_MEM_RD);
                 setup_err_evt(vmst, evt);
@@ -331,7 +550,7 @@ uint32_t uvm32_run(uvm32_state_t *vmst, uvm32_evt_t *evt, uint32_t instr_meter)
     }
 
     // an event is ready
-    if (vmst->_status == UVM32_STATUS_PAUSED) {
+    if (vmst->_status == UVM32_STATUS_PAUSED || vmst->_status == UVM32_STATUS_WAITING) {
         // send back the built up event
         UVM32_MEMCPY(evt, &vmst->_ioevt, sizeof(uvm32_evt_t));
         return orig_instr_meter - instr_meter;
@@ -355,6 +574,9 @@ static uint32_t *arg_to_ptr(uvm32_state_t *vmst, uvm32_evt_t *evt, uvm32_arg_t a
         case ARG1:
             return evt->data.syscall._params[1];
         break;
+        case ARG2:
+            return evt->data.syscall._params[2];
+        break;
         case RET:
             return evt->data.syscall._ret;
         break;
@@ -387,10 +609,10 @@ const char *uvm32_arg_getcstr(uvm32_state_t *vmst, uvm32_evt_t *evt, uvm32_arg_t
     }
 }
 
-uvm32_slice_t uvm32_arg_getslice(uvm32_state_t *vmst, uvm32_evt_t *evt, uvm32_arg_t argPtr, uvm32_arg_t argLen) {
+static uvm32_slice_t get_slice(uvm32_state_t *vmst, uint32_t addr, uint32_t len, bool write) {
     uvm32_slice_t scb;
-    if (!get_safeptr(vmst, uvm32_arg_getval(vmst, evt, argPtr), uvm32_arg_getval(vmst, evt, argLen), &scb)) {
-        setStatusErr(vmst, UVM32_ERR_MEM_RD);
+    if (!get_safeptr(vmst, addr, len, write, &scb)) {
+        setStatusErr(vmst, write ? UVM32_ERR_MEM_WR : UVM32_ERR_MEM_RD);
         vmst->garbage = 0;
         scb.ptr = (uint8_t *)&vmst->garbage;
         scb.len = 0;
@@ -398,85 +620,499 @@ uvm32_slice_t uvm32_arg_getslice(uvm32_state_t *vmst, uvm32_evt_t *evt, uvm32_ar
     return scb;
 }
 
+uvm32_slice_t uvm32_arg_getslice(uvm32_state_t *vmst, uvm32_evt_t *evt, uvm32_arg_t argPtr, uvm32_arg_t argLen) {
+    return get_slice(vmst, uvm32_arg_getval(vmst, evt, argPtr), uvm32_arg_getval(vmst, evt, argLen), false);
+}
+
+uvm32_slice_t uvm32_arg_getslice_w(uvm32_state_t *vmst, uvm32_evt_t *evt, uvm32_arg_t argPtr, uvm32_arg_t argLen) {
+    return get_slice(vmst, uvm32_arg_getval(vmst, evt, argPtr), uvm32_arg_getval(vmst, evt, argLen), true);
+}
+
 uvm32_slice_t uvm32_arg_getslice_fixed(uvm32_state_t *vmst, uvm32_evt_t *evt, uvm32_arg_t argPtr, uint32_t len) {
-    uvm32_slice_t scb;
-    if (!get_safeptr(vmst, uvm32_arg_getval(vmst, evt, argPtr), len, &scb)) {
+    return get_slice(vmst, uvm32_arg_getval(vmst, evt, argPtr), len, false);
+}
+
+uvm32_slice_t uvm32_getslice(uvm32_state_t *vmst, uint32_t addr, uint32_t len) {
+    return get_slice(vmst, addr, len, false);
+}
+
+uvm32_slice_t uvm32_getslice_w(uvm32_state_t *vmst, uint32_t addr, uint32_t len) {
+    return get_slice(vmst, addr, len, true);
+}
+
+static void _uvm32_retire(void *userdata, uint32_t count) {
+    uvm32_state_t *vmst = (uvm32_state_t *)userdata;
+    vmst->_instret += count;
+}
+
+static bool _uvm32_extramLoad(void *userdata, uint32_t addr, uint32_t accessTyp, uint32_t *val) {
+    uvm32_state_t *vmst = (uvm32_state_t *)userdata;
+    uvm32_region_t *r = find_region(vmst, addr);
+
+    *val = 0;
+    // These are funct3 values for lX instructions, lb/lbu=1, lh/lhu=2, lw=4 bytes
+    if (accessTyp == 3 || accessTyp > 5) {
+        setStatusErr(vmst, UVM32_ERR_INTERNAL_CORE);
+        return false;
+    }
+    if (r == NULL || !(r->perm & UVM32_REGION_R) || (1u << (accessTyp & 3)) > r->len - (addr - r->base)) {
+        // Out of bounds
         setStatusErr(vmst, UVM32_ERR_MEM_RD);
-        vmst->garbage = 0;
-        scb.ptr = (uint8_t *)&vmst->garbage;
-        scb.len = 0;
+        return false;
     }
-    return scb;
+
+    const uvm32_val_t *v = ((uvm32_val_t *)(&r->ptr[addr - r->base]));
+    switch(accessTyp) {
+        case 0:
+            *val = v->i8;
+        break;
+        case 1:
+            *val = v->i16;
+        break;
+        case 2:
+            *val = v->u32;
+        break;
+        case 5:
+            *val = v->u16;
+        break;
+        // have a default case to keep coverage check happy
+        // no other values are possible here
+        default:    // fall through
+        case 4:
+            *val = v->u8;
+        break;
+    }
+    return true;
 }
 
-static uint32_t _uvm32_extramLoad(void *userdata, uint32_t addr, uint32_t accessTyp) {
-    uvm32_state_t *vmst = (uvm32_state_t *)userdata;
-    addr -= UVM32_EXTRAM_BASE;
-    const uvm32_val_t *v = ((uvm32_val_t *)(&((uint8_t *)vmst->_extram)[addr]));
-
-    if (vmst->_extram != NULL) {
-        if (addr < vmst->_extramLen) {
-            // These are funct3 values for lX instructions
-            // Any other value will have caused UVM32_ERR_INTERNAL_CORE
-            switch(accessTyp) {
-                case 0:
-                    return v->i8;
-                break;
-                case 1:
-                    return v->i16;
-                break;
-                case 2:
-                    return v->u32;
-                break;
-                case 5:
-                    return v->u16;
-                break;
-                // have a default case to keep coverage check happy
-                // no other values are possible here
-                default:    // fall through
-                case 4:
-                    return v->u8;
-                break;
+#if UVM32_MAX_WATCHES > 0
+// Check a completed store of len bytes against the watches. Watches with a callback
+// are called straight away, otherwise an event is set up and true returned to end the step
+static bool check_watches(uvm32_state_t *vmst, uint32_t addr, uint32_t val, uint32_t len) {
+    for (int i=0;i<UVM32_MAX_WATCHES;i++) {
+        const uvm32_watchrange_t *w = &vmst->_watches[i];
+        if (addr < w->end && w->start < addr + len) {
+            if (w->callback != NULL) {
+                w->callback(w->userdata, addr, val);
+            } else {
+                vmst->_ioevt.typ = UVM32_EVT_WATCH;
+                vmst->_ioevt.data.watch.watch = i;
+                vmst->_ioevt.data.watch.addr = addr;
+                vmst->_ioevt.data.watch.val = val;
+                vmst->_watchHit = true;
+                return true;
             }
-        } else {
-            // Out of bounds
-            setStatusErr(vmst, UVM32_ERR_MEM_RD);
         }
     }
-    return 0;
+    return false;
 }
+#endif
+
+#ifdef UVM32_WATCH_RAM
+static bool _uvm32_ramWatch(void *userdata, uint32_t ofs, uint32_t val, uint32_t len) {
+    uvm32_state_t *vmst = (uvm32_state_t *)userdata;
+    // one compare rejects stores nowhere near a watch
+    if (ofs - vmst->_watchRamStart >= vmst->_watchRamSpan) {
+        return false;
+    }
+    return check_watches(vmst, ofs + MINIRV32_RAM_IMAGE_OFFSET, val, len);
+}
+#endif
+
+// Record len bytes at offset into r as written
+static void mark_dirty(uvm32_state_t *vmst, uvm32_region_t *r, uint32_t offset, uint32_t len) {
+    if (r->dirtyStart == r->dirtyEnd) {
+        r->dirtyStart = offset;
+        r->dirtyEnd = offset + len;
+    } else {
+        if (offset < r->dirtyStart) {
+            r->dirtyStart = offset;
+        }
+        if (offset + len > r->dirtyEnd) {
+            r->dirtyEnd = offset + len;
+        }
+    }
+    if (r->dirtyBitmap != NULL) {
+        // a misaligned store may touch two blocks
+        const uint32_t last = (offset + len - 1) >> r->dirtyShift;
+        for (uint32_t b = offset >> r->dirtyShift; b <= last; b++) {
+            r->dirtyBitmap[b >> 5] |= 1u << (b & 31);
+        }
+    }
+    r->dirty = true;
+    vmst->_extramDirty = true;
+}
+
+void uvm32_markDirty(uvm32_state_t *vmst, uint32_t addr, uint32_t len) {
+    uvm32_region_t *r = find_region(vmst, addr);
 
+    if (r != NULL && len > 0 && len <= r->len - (addr - r->base)) {
+        mark_dirty(vmst, r, addr - r->base, len);
+    }
+}
+
+// Returns 0 on fault, 1 when stored, 2 when stored and the step must end for a watch
 static uint32_t _uvm32_extramStore(void *userdata, uint32_t addr, uint32_t val, uint32_t accessTyp) {
     uvm32_state_t *vmst = (uvm32_state_t *)userdata;
-    addr -= UVM32_EXTRAM_BASE;
-    uvm32_val_t *v = ((uvm32_val_t *)(&((uint8_t *)vmst->_extram)[addr]));
-
-    if (vmst->_extram != NULL) {
-        if (addr < vmst->_extramLen) {
-            switch(accessTyp) {
-                case 1:
-                    v->u16 = val;
-                break;
-                case 2:
-                    v->u32 = val;
-                break;
-                // no other values are valid here and will be stopped above
-                default: // fall through
-                case 0:
-                    v->u8 = val;
-                break;
+    uvm32_region_t *r = find_region(vmst, addr);
+
+    // sb=1, sh=2, sw=4 bytes
+    if (accessTyp > 2) {
+        setStatusErr(vmst, UVM32_ERR_INTERNAL_CORE);
+        return 0;
+    }
+    if (r == NULL || !(r->perm & UVM32_REGION_W) || (1u << accessTyp) > r->len - (addr - r->base)) {
+        setStatusErr(vmst, UVM32_ERR_MEM_WR);
+        return 0;
+    }
+
+    const uint32_t offset = addr - r->base;
+    uvm32_val_t *v = ((uvm32_val_t *)(&r->ptr[offset]));
+    switch(accessTyp) {
+        case 1:
+            v->u16 = val;
+        break;
+        case 2:
+            v->u32 = val;
+        break;
+        // no other values are valid here and will be stopped above
+        default: // fall through
+        case 0:
+            v->u8 = val;
+        break;
+    }
+    mark_dirty(vmst, r, offset, 1u << accessTyp);
+#if UVM32_MAX_WATCHES > 0
+    if (r->watched) {
+        const uint32_t mask = accessTyp == 2 ? 0xFFFFFFFF : (1u << (8u << accessTyp)) - 1;
+        if (check_watches(vmst, addr, val & mask, 1u << accessTyp)) {
+            return 2;
+        }
+    }
+#endif
+    return 1;
+}
+
+#ifdef UVM32_EXT_CUSTOM
+static bool _uvm32_customOp(void *userdata, uint32_t ir, uint32_t rs1, uint32_t rs2, uint32_t *rd) {
+    uvm32_state_t *vmst = (uvm32_state_t *)userdata;
+    // major opcodes 0x0b, 0x2b, 0x5b, 0x7b map to custom-0..3
+    uint32_t n = (ir >> 5) & 3;
+
+    if (vmst->_customOp[n] == NULL) {
+        return false;
+    }
+    *rd = vmst->_customOp[n](vmst->_customOpUserdata[n], (ir >> 12) & 0x7, ir >> 25, rs1, rs2);
+    return true;
+}
+
+bool uvm32_setCustomOp(uvm32_state_t *vmst, uint32_t n, uvm32_custom_op_t handler, void *userdata) {
+    if (n >= UVM32_NUM_CUSTOM_OPS) {
+        return false;
+    }
+    vmst->_customOp[n] = handler;
+    vmst->_customOpUserdata[n] = userdata;
+    return true;
+}
+#endif
+
+static bool _uvm32_counterRead(void *userdata, uint32_t csrno, uint32_t icount, uint32_t *val) {
+    uvm32_state_t *vmst = (uvm32_state_t *)userdata;
+    uint64_t v;
+
+    if ((csrno & 3) == 1) {
+        // time, timeh
+        if (!read_clock(vmst, icount, &v)) {
+            return false;
+        }
+    } else {
+        // cycle, instret and their high halves, one cycle per instruction
+        // _instret is only updated at the end of each step, so add those run so far
+        v = vmst->_instret + icount;
+    }
+    *val = (csrno & 0x80) ? (uint32_t)(v >> 32) : (uint32_t)v;
+    return true;
+}
+
+void uvm32_setClock(uvm32_state_t *vmst, uvm32_clock_t clock, void *userdata) {
+    vmst->_clock = clock;
+    vmst->_clockUserdata = userdata;
+}
+
+void uvm32_setVirtualClock(uvm32_state_t *vmst, uint32_t rate) {
+    vmst->_virtualRate = rate;
+}
+
+void uvm32_skipClock(uvm32_state_t *vmst, uint64_t us) {
+    if (vmst->_virtualRate != 0) {
+        vmst->_virtualSkip += us;
+    }
+}
+
+uint64_t uvm32_getClock(const uvm32_state_t *vmst) {
+    uint64_t now;
+    return read_clock(vmst, 0, &now) ? now : 0;
+}
+
+static bool _uvm32_extramFetch(void *userdata, uint32_t addr, uint32_t *ir) {
+    uvm32_state_t *vmst = (uvm32_state_t *)userdata;
+    uvm32_region_t *r = find_region(vmst, addr);
+
+    if (r == NULL || !(r->perm & UVM32_REGION_X)) {
+        return false;
+    }
+    const uvm32_val_t *v = ((uvm32_val_t *)(&r->ptr[addr - r->base]));
+    if (r->len - (addr - r->base) >= 4) {
+        *ir = v->u32;
+        return true;
+    }
+    if (r->len - (addr - r->base) >= 2) {
+        // only room for a compressed instruction
+        *ir = v->u16;
+        return (*ir & 3) != 3;
+    }
+    return false;
+}
+
+// Recalculate which regions need stores checked, and the RAM offsets which may hit a watch
+static void update_watches(uvm32_state_t *vmst) {
+#if UVM32_MAX_WATCHES > 0
+#ifdef UVM32_WATCH_RAM
+    uint32_t ramStart = UVM32_MEMORY_SIZE;
+    uint32_t ramEnd = 0;
+#endif
+    for (int i=0;i<UVM32_MAX_REGIONS;i++) {
+        vmst->_regions[i].watched = false;
+    }
+    for (int i=0;i<UVM32_MAX_WATCHES;i++) {
+        const uvm32_watchrange_t *w = &vmst->_watches[i];
+        if (w->start == w->end) {
+            continue;
+        }
+        for (int j=0;j<UVM32_MAX_REGIONS;j++) {
+            uvm32_region_t *r = &vmst->_regions[j];
+            if (r->ptr != NULL && w->start < r->base + r->len && r->base < w->end) {
+                r->watched = true;
             }
-            vmst->_extramDirty = true;
-        } else {
-            setStatusErr(vmst, UVM32_ERR_MEM_WR);
         }
+#ifdef UVM32_WATCH_RAM
+        if (w->end <= MINIRV32_RAM_IMAGE_OFFSET + UVM32_MEMORY_SIZE && w->start >= MINIRV32_RAM_IMAGE_OFFSET) {
+            // widen by 3 so a store starting below the watch but overlapping it is checked
+            uint32_t start = w->start - MINIRV32_RAM_IMAGE_OFFSET;
+            start = start < 3 ? 0 : start - 3;
+            if (start < ramStart) {
+                ramStart = start;
+            }
+            if (w->end - MINIRV32_RAM_IMAGE_OFFSET > ramEnd) {
+                ramEnd = w->end - MINIRV32_RAM_IMAGE_OFFSET;
+            }
+        }
+#endif
+    }
+#ifdef UVM32_WATCH_RAM
+    vmst->_watchRamStart = ramStart;
+    vmst->_watchRamSpan = ramEnd > ramStart ? ramEnd - ramStart : 0;
+#endif
+#endif
+}
+
+int uvm32_watch(uvm32_state_t *vmst, uint32_t addr, uint32_t len, uvm32_watch_t callback, void *userdata) {
+#if UVM32_MAX_WATCHES > 0
+    if (len == 0 || addr + len < addr) {
+        return -1;
+    }
+#ifdef UVM32_WATCH_RAM
+    const bool inRam = addr >= MINIRV32_RAM_IMAGE_OFFSET && len <= UVM32_MEMORY_SIZE && addr - MINIRV32_RAM_IMAGE_OFFSET <= UVM32_MEMORY_SIZE - len;
+#else
+    const bool inRam = false;
+#endif
+    if (!inRam && !(MINIRV32_MMIO_RANGE(addr) && len <= UVM32_MMIO_END - addr)) {
+        return -1;
+    }
+    for (int i=0;i<UVM32_MAX_WATCHES;i++) {
+        uvm32_watchrange_t *w = &vmst->_watches[i];
+        if (w->start == w->end) {
+            w->start = addr;
+            w->end = addr + len;
+            w->callback = callback;
+            w->userdata = userdata;
+            update_watches(vmst);
+            return i;
+        }
+    }
+#endif
+    return -1;
+}
+
+void uvm32_unwatch(uvm32_state_t *vmst, int watch) {
+#if UVM32_MAX_WATCHES > 0
+    if (watch >= 0 && watch < UVM32_MAX_WATCHES) {
+        vmst->_watches[watch].start = 0;
+        vmst->_watches[watch].end = 0;
+        update_watches(vmst);
     }
-	return 0;
+#endif
+}
+
+int uvm32_mapRegion(uvm32_state_t *vmst, uint32_t base, uint8_t *ptr, uint32_t len, uint32_t perm) {
+    int slot = -1;
+
+    if (ptr == NULL || len == 0 || !MINIRV32_MMIO_RANGE(base) || len > UVM32_MMIO_END - base) {
+        return -1;
+    }
+    for (int i=0;i<UVM32_MAX_REGIONS;i++) {
+        const uvm32_region_t *r = &vmst->_regions[i];
+        if (r->ptr == NULL) {
+            if (slot < 0) {
+                slot = i;
+            }
+        } else if (base < r->base + r->len && r->base < base + len) {
+            // overlaps an existing region
+            return -1;
+        }
+    }
+    if (slot >= 0) {
+        vmst->_regions[slot].ptr = ptr;
+        vmst->_regions[slot].base = base;
+        vmst->_regions[slot].len = len;
+        vmst->_regions[slot].perm = perm;
+        vmst->_regions[slot].dirty = false;
+        vmst->_regions[slot].dirtyStart = 0;
+        vmst->_regions[slot].dirtyEnd = 0;
+        vmst->_regions[slot].dirtyBitmap = (uint32_t *)NULL;
+        update_watches(vmst);
+    }
+    return slot;
+}
+
+int uvm32_mapAsset(uvm32_state_t *vmst, const uint8_t *ptr, uint32_t len) {
+    // without UVM32_REGION_W the VM never writes through ptr
+    return uvm32_mapRegion(vmst, UVM32_ASSET_BASE, (uint8_t *)ptr, len, UVM32_REGION_R);
+}
+
+void uvm32_unmapRegion(uvm32_state_t *vmst, int region) {
+    if (region >= 0 && region < UVM32_MAX_REGIONS) {
+        vmst->_regions[region].ptr = (uint8_t *)NULL;
+        update_watches(vmst);
+    }
+}
+
+bool uvm32_regionDirty(const uvm32_state_t *vmst, int region) {
+    if (region >= 0 && region < UVM32_MAX_REGIONS) {
+        return vmst->_regions[region].ptr != NULL && vmst->_regions[region].dirty;
+    }
+    return false;
+}
+
+// Clear bits first..last inclusive
+static void clear_dirty_blocks(uvm32_region_t *r, uint32_t first, uint32_t last) {
+    for (uint32_t b = first; b <= last; b++) {
+        r->dirtyBitmap[b >> 5] &= ~(1u << (b & 31));
+    }
+}
+
+bool uvm32_regionDirtyRange(uvm32_state_t *vmst, int region, uint32_t *offset, uint32_t *len) {
+    if (region < 0 || region >= UVM32_MAX_REGIONS || vmst->_regions[region].ptr == NULL) {
+        return false;
+    }
+    uvm32_region_t *r = &vmst->_regions[region];
+    if (r->dirtyStart == r->dirtyEnd) {
+        return false;
+    }
+    *offset = r->dirtyStart;
+    *len = r->dirtyEnd - r->dirtyStart;
+    if (r->dirtyBitmap != NULL) {
+        clear_dirty_blocks(r, r->dirtyStart >> r->dirtyShift, (r->dirtyEnd - 1) >> r->dirtyShift);
+    }
+    r->dirtyStart = 0;
+    r->dirtyEnd = 0;
+    return true;
+}
+
+bool uvm32_regionTrackDirty(uvm32_state_t *vmst, int region, uint32_t *bitmap, uint32_t words, uint32_t blockShift) {
+    if (region < 0 || region >= UVM32_MAX_REGIONS || vmst->_regions[region].ptr == NULL) {
+        return false;
+    }
+    uvm32_region_t *r = &vmst->_regions[region];
+    if (bitmap != NULL) {
+        if (blockShift > 31 || (((r->len - 1) >> blockShift) >> 5) >= words) {
+            return false;
+        }
+        UVM32_MEMSET(bitmap, 0x00, words * sizeof(uint32_t));
+        if (r->dirtyStart != r->dirtyEnd) {
+            // carry over anything written before tracking started
+            for (uint32_t b = r->dirtyStart >> blockShift; b <= (r->dirtyEnd - 1) >> blockShift; b++) {
+                bitmap[b >> 5] |= 1u << (b & 31);
+            }
+        }
+    }
+    r->dirtyBitmap = bitmap;
+    r->dirtyShift = blockShift;
+    return true;
+}
+
+bool uvm32_regionNextDirty(uvm32_state_t *vmst, int region, uint32_t *offset, uint32_t *len) {
+    if (region < 0 || region >= UVM32_MAX_REGIONS || vmst->_regions[region].ptr == NULL) {
+        return false;
+    }
+    uvm32_region_t *r = &vmst->_regions[region];
+    if (r->dirtyBitmap == NULL) {
+        return uvm32_regionDirtyRange(vmst, region, offset, len);
+    }
+    if (r->dirtyStart == r->dirtyEnd) {
+        return false;
+    }
+    // only blocks inside the dirty range can be set
+    const uint32_t *bm = r->dirtyBitmap;
+    const uint32_t last = (r->dirtyEnd - 1) >> r->dirtyShift;
+    uint32_t b = r->dirtyStart >> r->dirtyShift;
+    while (b <= last) {
+        uint32_t w = bm[b >> 5] >> (b & 31);
+        if (w == 0) {
+            // skip rest of word
+            b = (b | 31) + 1;
+            continue;
+        }
+        while (!(w & 1)) {
+            w >>= 1;
+            b++;
+        }
+        break;
+    }
+    if (b > last) {
+        r->dirtyStart = 0;
+        r->dirtyEnd = 0;
+        return false;
+    }
+    uint32_t e = b;
+    while (e < last && (bm[(e + 1) >> 5] & (1u << ((e + 1) & 31)))) {
+        e++;
+    }
+    clear_dirty_blocks(r, b, e);
+
+    uint64_t end = ((uint64_t)e + 1) << r->dirtyShift;
+    *offset = b << r->dirtyShift;
+    *len = (end > r->len ? r->len : (uint32_t)end) - *offset;
+    if (e == last) {
+        r->dirtyStart = 0;
+        r->dirtyEnd = 0;
+    } else {
+        r->dirtyStart = (uint32_t)end;
+    }
+    return true;
 }
 
 void uvm32_extram(uvm32_state_t *vmst, uint8_t *ram, uint32_t len) {
-    vmst->_extram = ram;
-    vmst->_extramLen = len;
+    // replace whatever is mapped at UVM32_EXTRAM_BASE
+    uvm32_region_t *r = find_region(vmst, UVM32_EXTRAM_BASE);
+    if (r != NULL) {
+        r->ptr = (uint8_t *)NULL;
+    }
+    if (ram != NULL && len > 0) {
+        uvm32_mapRegion(vmst, UVM32_EXTRAM_BASE, ram, len, UVM32_REGION_RWX);
+    } else {
+        update_watches(vmst);
+    }
 }
 
 bool uvm32_extramDirty(uvm32_state_t *vmst) {
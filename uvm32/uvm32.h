@@ -56,13 +56,41 @@ typedef union __attribute__((packed)) {
 #define MINIRV32_NO_ATOMICS
 #define MINIRV32_NO_BREAKPOINT_NO_INTERRUPTS
 #define MINI_RV32_RAM_SIZE UVM32_MEMORY_SIZE
-#define MINIRV32_POSTEXEC(pc, ir, retval) {if (retval > 0) return retval;}
-#define MINIRV32_HANDLE_MEM_LOAD_CONTROL( addy, rval ) rval = _uvm32_extramLoad(userdata, addy, ( ir >> 12 ) & 0x7);
-#define MINIRV32_HANDLE_MEM_STORE_CONTROL( addy, val ) if( _uvm32_extramStore(userdata, addy, val, ( ir >> 12 ) & 0x7) ) return val;
+#define MINIRV32_MMIO_RANGE(n) (UVM32_EXTRAM_BASE <= (n) && (n) < UVM32_MMIO_END)
+#define MINIRV32_RETIRE( n ) _uvm32_retire(userdata, n);
+#define MINIRV32_HANDLE_MEM_LOAD_CONTROL( addy, rval ) if( !_uvm32_extramLoad(userdata, addy, ( ir >> 12 ) & 0x7, &rval) ) trap = (5+1);
+// a store to a watched address sets count to end the step after this instruction
+#define MINIRV32_HANDLE_MEM_STORE_CONTROL( addy, val ) switch( _uvm32_extramStore(userdata, addy, val, ( ir >> 12 ) & 0x7) ) { case 0: trap = (7+1); break; case 2: count = icount + 1; break; }
+#define MINIRV32_HANDLE_FETCH_CONTROL( addy, ir ) if( !_uvm32_extramFetch(userdata, addy, &ir) ) trap = (1+1);
 #define MINIRV32_CUSTOM_MEMORY_BUS
+#define MINIRV32_HANDLE_COUNTER_READ( csrno, icount, rval ) if( !_uvm32_counterRead(userdata, csrno, icount, &rval) ) trap = (2+1);
+#ifdef UVM32_EXT_CUSTOM
+#define MINIRV32_HANDLE_CUSTOM( ir, rs1, rs2, rval ) if( !_uvm32_customOp(userdata, ir, rs1, rs2, &rval) ) trap = (2+1);
+#endif
+#ifdef UVM32_EXT_C
+#define MINIRV32_EXT_C
+#endif
+#ifdef UVM32_EXT_ZB
+#define MINIRV32_EXT_ZB
+#endif
+#ifdef UVM32_EXT_F
+#define MINIRV32_EXT_F
+#endif
+#ifdef UVM32_EXT_ZK
+#define MINIRV32_EXT_ZK
+#endif
+#ifdef UVM32_RV32E
+#define MINIRV32_RV32E
+#endif
+#ifdef UVM32_WATCH_RAM
+#define MINIRV32_STORE4( ofs, val ) do { ((uvm32_val_t *)(&image[ofs]))->u32 = val; if( _uvm32_ramWatch(userdata, ofs, val, 4) ) count = icount + 1; } while(0)
+#define MINIRV32_STORE2( ofs, val ) do { ((uvm32_val_t *)(&image[ofs]))->u16 = val; if( _uvm32_ramWatch(userdata, ofs, val & 0xffff, 2) ) count = icount + 1; } while(0)
+#define MINIRV32_STORE1( ofs, val ) do { ((uvm32_val_t *)(&image[ofs]))->u8 = val; if( _uvm32_ramWatch(userdata, ofs, val & 0xff, 1) ) count = icount + 1; } while(0)
+#else
 #define MINIRV32_STORE4( ofs, val ) ((uvm32_val_t *)(&image[ofs]))->u32 = val
 #define MINIRV32_STORE2( ofs, val ) ((uvm32_val_t *)(&image[ofs]))->u16 = val
 #define MINIRV32_STORE1( ofs, val ) ((uvm32_val_t *)(&image[ofs]))->u8 = val
+#endif
 #define MINIRV32_LOAD4( ofs ) ((uvm32_val_t *)(&image[ofs]))->u32
 #define MINIRV32_LOAD2( ofs ) ((uvm32_val_t *)(&image[ofs]))->u16
 #define MINIRV32_LOAD1( ofs ) ((uvm32_val_t *)(&image[ofs]))->u8
@@ -71,8 +99,17 @@ typedef union __attribute__((packed)) {
 #ifndef MINIRV32_IMPLEMENTATION
 #define MINIRV32_STEPPROTO
 #else
-static uint32_t _uvm32_extramLoad(void *userdata, uint32_t addr, uint32_t accessTyp);
+static void _uvm32_retire(void *userdata, uint32_t count);
+static bool _uvm32_extramLoad(void *userdata, uint32_t addr, uint32_t accessTyp, uint32_t *val);
 static uint32_t _uvm32_extramStore(void *userdata, uint32_t addr, uint32_t val, uint32_t accessTyp);
+#ifdef UVM32_WATCH_RAM
+static bool _uvm32_ramWatch(void *userdata, uint32_t ofs, uint32_t val, uint32_t len);
+#endif
+static bool _uvm32_extramFetch(void *userdata, uint32_t addr, uint32_t *ir);
+#ifdef UVM32_EXT_CUSTOM
+static bool _uvm32_customOp(void *userdata, uint32_t ir, uint32_t rs1, uint32_t rs2, uint32_t *rd);
+#endif
+static bool _uvm32_counterRead(void *userdata, uint32_t csrno, uint32_t icount, uint32_t *val);
 #endif
 #include "mini-rv32ima.h"
 
@@ -99,6 +136,8 @@ typedef enum {
     UVM32_EVT_ERR,      /*! Error has occurred, details in uvm32_evt_t data.err field */
     UVM32_EVT_SYSCALL,  /*! A syscall has been requested, details in uvm32__evt_t data.syscall field */
     UVM32_EVT_END,      /*! The program has ended by making a UVM32_SYSCALL_HALT */
+    UVM32_EVT_WATCH,    /*! VM code has stored to an address watched with uvm32_watch(), details in uvm32_evt_t data.watch field */
+    UVM32_EVT_WAITING,  /*! VM code is waiting with UVM32_SYSCALL_WAIT, details in uvm32_evt_t data.wait field */
 } uvm32_evt_typ_t;
 
 /*! Details for an error event */
@@ -115,15 +154,34 @@ Typically, a host will switch on `code` to decide how to parse the syscall. Then
 typedef struct {
     uint32_t code;           /*! Syscall number, eg. UVM32_SYSCALL_YIELD */
     uint32_t *_ret;          /*! Value to be returned to caller, private, do not use directly */
-    uint32_t *_params[2];    /*! The syscall's two parameters, private, do not use directly */
+    uint32_t *_params[3];    /*! The syscall's three parameters, private, do not use directly */
+    uint32_t idle;           /*! Number of times in a row this syscall has been made by an idle loop, see `UVM32_IDLE_DETECT`. Always 0 without it */
 } uvm32_evt_syscall_t;
 
+/*! Details for a watch event, the store has been completed */
+typedef struct {
+    int watch;          /*! Watch number, from uvm32_watch() */
+    uint32_t addr;      /*! Address written */
+    uint32_t val;       /*! Value written, 8 and 16 bit stores are zero extended */
+} uvm32_evt_watch_t;
+
+/*! uvm32_evt_wait_t deadline when VM code waits without a timeout */
+#define UVM32_DEADLINE_NONE UINT64_MAX
+
+/*! Details for a waiting event. Nothing runs until uvm32_run() finds the deadline has passed or an interrupt in `events` pending, so the host may park the VM until then. Calling uvm32_run() sooner is harmless, it returns UVM32_EVT_WAITING again having run nothing */
+typedef struct {
+    uint64_t deadline;  /*! Clock time at which the wait ends, or UVM32_DEADLINE_NONE. Without a clock, this is the timeout and the wait ends on the next uvm32_run(), as it does with a virtual clock set by uvm32_setVirtualClock() */
+    uint32_t events;    /*! Mask of interrupts which end the wait, see uvm32_interrupt(). Always 0 without `UVM32_INTERRUPTS` */
+} uvm32_evt_wait_t;
+
 /*! An event passed from uvm32 to host when code must be paused */
 typedef struct {
     uvm32_evt_typ_t typ;                /*! The type of this event */
     union {
         uvm32_evt_syscall_t syscall;    /*! Only valid when typ == UVM32_EVT_SYSCALL */
         uvm32_evt_err_t err;            /*! Only valid when typ == UVM32_EVT_ERR */
+        uvm32_evt_watch_t watch;        /*! Only valid when typ == UVM32_EVT_WATCH */
+        uvm32_evt_wait_t wait;          /*! Only valid when typ == UVM32_EVT_WAITING */
     } data;
 } uvm32_evt_t;
 
@@ -133,9 +191,85 @@ typedef enum {
     UVM32_STATUS_RUNNING,
     UVM32_STATUS_ERROR,
     UVM32_STATUS_ENDED,
+    UVM32_STATUS_WAITING,
 } uvm32_status_t;
 
 
+/*! Number of custom instruction major opcodes, custom-0 to custom-3 */
+#define UVM32_NUM_CUSTOM_OPS 4
+
+/*! Host handler for a custom instruction. `funct3` and `funct7` are the fields of the R-type instruction, `rs1` and `rs2` are the values of its source registers. The return value is written to rd. Handlers are called inline, the VM does not pause */
+typedef uint32_t (*uvm32_custom_op_t)(void *userdata, uint32_t funct3, uint32_t funct7, uint32_t rs1, uint32_t rs2);
+
+/*! Host clock read by the guest's `time` CSR. Returns a free running count in host chosen units, the included hosts use microseconds */
+typedef uint64_t (*uvm32_clock_t)(void *userdata);
+
+/*! Maximum number of address ranges which can be watched at once, 0 leaves out watches and their checks on stores */
+#ifndef UVM32_MAX_WATCHES
+#define UVM32_MAX_WATCHES 4
+#endif
+#if UVM32_MAX_WATCHES == 0 && defined(UVM32_WATCH_RAM)
+#error "UVM32_WATCH_RAM needs UVM32_MAX_WATCHES above 0"
+#endif
+
+/*! Maximum number of external RAM regions which can be mapped at once */
+#ifndef UVM32_MAX_REGIONS
+#define UVM32_MAX_REGIONS 4
+#endif
+
+/*! Access permissions for external RAM regions, combine with | */
+#define UVM32_REGION_R      1   /*! VM code may read */
+#define UVM32_REGION_W      2   /*! VM code may write */
+#define UVM32_REGION_X      4   /*! VM code may execute */
+#define UVM32_REGION_RWX    (UVM32_REGION_R | UVM32_REGION_W | UVM32_REGION_X)
+
+/*! A block of host memory mapped into the VM, private, use uvm32_mapRegion() */
+typedef struct {
+    uint8_t *ptr;           /*! Host memory, or NULL if unused */
+    uint32_t base;          /*! Address in VM */
+    uint32_t len;           /*! Length in bytes */
+    uint32_t perm;          /*! UVM32_REGION_R etc. */
+    bool dirty;             /*! VM code has written to the region since last run */
+    uint32_t dirtyStart;    /*! Offset of first byte written since uvm32_regionDirtyRange() */
+    uint32_t dirtyEnd;      /*! Offset after last byte written, equal to dirtyStart when none */
+    uint32_t *dirtyBitmap;  /*! One bit per written block, or NULL, see uvm32_regionTrackDirty() */
+    uint32_t dirtyShift;    /*! Blocks are 1 << dirtyShift bytes */
+#if UVM32_MAX_WATCHES > 0
+    bool watched;           /*! A watch overlaps the region, so stores must be checked */
+#endif
+} uvm32_region_t;
+
+#ifdef UVM32_INTERRUPTS
+/*! Number of interrupts, 0 to UVM32_NUM_IRQS-1, which the host can raise with uvm32_interrupt() */
+#define UVM32_NUM_IRQS 32
+#endif
+
+#ifndef UVM32_IDLE_MAX_INSTRS
+#define UVM32_IDLE_MAX_INSTRS 256   /*! Longest loop, in instructions, treated as idle by `UVM32_IDLE_DETECT` */
+#endif
+
+#ifndef UVM32_IDLE_SYSCALLS
+#define UVM32_IDLE_SYSCALLS 4       /*! Most syscalls in one loop treated as idle by `UVM32_IDLE_DETECT` */
+#endif
+
+/*! A recently made syscall, private */
+typedef struct {
+    uint32_t pc;            /*! Address of the ecall */
+    uint32_t regs;          /*! Hash of the registers when it was made */
+    uint64_t instret;       /*! _instret when it was made */
+} uvm32_idle_t;
+
+/*! Called when VM code stores `val` to watched address `addr` */
+typedef void (*uvm32_watch_t)(void *userdata, uint32_t addr, uint32_t val);
+
+/*! A watched address range, private, use uvm32_watch() */
+typedef struct {
+    uint32_t start;         /*! First address watched */
+    uint32_t end;           /*! Address after last watched, equal to start when unused */
+    uvm32_watch_t callback; /*! Called on store, or NULL to return UVM32_EVT_WATCH */
+    void *userdata;
+} uvm32_watchrange_t;
+
 /*! State of uvm32. Each VM requires an instance of uvm32_state_t. All members of the struct are private and should only be accessed through provided functions */
 typedef struct {
     uvm32_status_t _status;                 /*! Current VM running state */
@@ -146,9 +280,42 @@ typedef struct {
 #ifdef UVM32_STACK_PROTECTION
     uint8_t *_stack_canary;                 /*! Location of stack canary */
 #endif
-    uint8_t *_extram;                       /*! External RAM pointer, or NULL */
-    uint32_t _extramLen;                    /*! Length of external RAM */
-    bool _extramDirty;                      /*! Flag to indicate VM code has modified extram since last run */
+    uvm32_region_t _regions[UVM32_MAX_REGIONS];  /*! External RAM regions */
+    uint32_t _lastRegion;                   /*! Index of most recently accessed region */
+    bool _extramDirty;                      /*! Flag to indicate VM code has modified any region since last run */
+#if UVM32_MAX_WATCHES > 0
+    uvm32_watchrange_t _watches[UVM32_MAX_WATCHES];    /*! Watched address ranges */
+    bool _watchHit;                         /*! A store has raised UVM32_EVT_WATCH, end the run */
+#endif
+#ifdef UVM32_WATCH_RAM
+    uint32_t _watchRamStart;                /*! Offsets into _memory which may hit a RAM watch */
+    uint32_t _watchRamSpan;
+#endif
+    uint64_t _instret;                      /*! Total number of instructions executed */
+#ifdef UVM32_EXT_CUSTOM
+    uvm32_custom_op_t _customOp[UVM32_NUM_CUSTOM_OPS];      /*! Handlers for custom-0..3, or NULL */
+    void *_customOpUserdata[UVM32_NUM_CUSTOM_OPS];          /*! Passed to each custom handler */
+#endif
+#ifdef UVM32_INTERRUPTS
+    uint32_t _irqHandler;                   /*! VM address of interrupt handler, or 0 */
+    uint32_t _irqEnabled;                   /*! Mask of interrupts VM code will take */
+    uint32_t _irqPending;                   /*! Mask of interrupts raised and not yet taken */
+    bool _irqActive;                        /*! Handler is running, _irqContext holds the interrupted code's registers */
+    struct MiniRV32IMAState _irqContext;    /*! Registers restored when the handler returns */
+#endif
+#ifdef UVM32_IDLE_DETECT
+    uvm32_idle_t _idle[UVM32_IDLE_SYSCALLS];    /*! Recent syscalls, to find loops repeating them */
+    uint32_t _idleNext;                     /*! Entry in _idle to reuse next */
+    uint32_t _idleCount;                    /*! Syscalls in a row repeated with nothing changed */
+#endif
+    uint64_t _waitDeadline;                 /*! Clock time UVM32_SYSCALL_WAIT ends, or UVM32_DEADLINE_NONE */
+#ifdef UVM32_INTERRUPTS
+    uint32_t _waitEvents;                   /*! Mask of interrupts which end UVM32_SYSCALL_WAIT */
+#endif
+    uvm32_clock_t _clock;                   /*! Clock for the time CSR, or NULL */
+    void *_clockUserdata;                   /*! Passed to the clock */
+    uint32_t _virtualRate;                  /*! Instructions per second of the virtual clock, or 0 to use _clock */
+    uint64_t _virtualSkip;                  /*! Microseconds added to the virtual clock by waits and uvm32_skipClock() */
     uint32_t garbage;                       /*! Used for returning valid pointer when operations fail */
 } uvm32_state_t;
 
@@ -177,6 +344,7 @@ typedef struct {
 typedef enum {
     ARG0,           /*! The first argument of a syscall */
     ARG1,           /*! The second argument of a syscall */
+    ARG2,           /*! The third argument of a syscall, only set by syscall3() */
     RET,            /*! The return value of a syscall */
 } uvm32_arg_t;
 
@@ -189,19 +357,80 @@ const char *uvm32_arg_getcstr(uvm32_state_t *vmst, uvm32_evt_t *evt, uvm32_arg_t
 /*! Write a syscall argument as a uint32_t value */
 void uvm32_arg_setval(uvm32_state_t *vmst, uvm32_evt_t *evt, uvm32_arg_t, uint32_t val);
 
-/*! Read a syscall argument pair (ptr, length) as a slice */
+/*! Read a syscall argument pair (ptr, length) as a slice. Memory in a region without `UVM32_REGION_R` is an error (`UVM32_ERR_MEM_RD`), as it is for VM code, and an empty slice is returned */
 uvm32_slice_t uvm32_arg_getslice(uvm32_state_t *vmst, uvm32_evt_t *evt, uvm32_arg_t argPtr, uvm32_arg_t argLen);
 
+/*! Read a syscall argument pair (ptr, length) as a slice the host will write to. As uvm32_arg_getslice(), but memory in a region without `UVM32_REGION_W` (eg. the asset window) is an error (`UVM32_ERR_MEM_WR`) and an empty slice is returned */
+uvm32_slice_t uvm32_arg_getslice_w(uvm32_state_t *vmst, uvm32_evt_t *evt, uvm32_arg_t argPtr, uvm32_arg_t argLen);
+
 /*! Read a syscall argument pointer as a slice of known length */
 uvm32_slice_t uvm32_arg_getslice_fixed(uvm32_state_t *vmst, uvm32_evt_t *evt, uvm32_arg_t arg, uint32_t len);
 
+/*! Get `len` bytes of VM memory at VM address `addr` as a slice, for data reached through a pointer held in a syscall argument. An invalid range is handled as for uvm32_arg_getslice() */
+uvm32_slice_t uvm32_getslice(uvm32_state_t *vmst, uint32_t addr, uint32_t len);
 
-/*! Setup a block of memory to act as external RAM, it will be available on in VM code at address `UVM32_EXTRAM_BASE`. The memory is not copied, so the caller must ensure it remains available until `uvm32_extram()` is called to setup a different region or the VM is ended. */
+/*! Get `len` bytes of VM memory at VM address `addr` as a slice the host will write to. An invalid or read-only range is handled as for uvm32_arg_getslice_w() */
+uvm32_slice_t uvm32_getslice_w(uvm32_state_t *vmst, uint32_t addr, uint32_t len);
+
+/*! Mark `len` bytes at VM address `addr` as written, for a host which writes to a region on behalf of VM code (eg. through a slice). Dirty flags, ranges and bitmaps are updated as if VM code had stored there. Ranges outside any region are ignored */
+void uvm32_markDirty(uvm32_state_t *vmst, uint32_t addr, uint32_t len);
+
+
+/*! Setup a block of memory to act as external RAM, it will be available on in VM code at address `UVM32_EXTRAM_BASE`, readable, writable and executable. The memory is not copied, so the caller must ensure it remains available until `uvm32_extram()` is called to setup a different region or the VM is ended. Passing NULL removes it. This is shorthand for uvm32_mapRegion() at `UVM32_EXTRAM_BASE` */
 void uvm32_extram(uvm32_state_t *vmst, uint8_t *extram, uint32_t len);
 
-/*! Check to see if the external RAM is marked as dirty. If the VM code writes to the external RAM, this flag is set. The flag is automatically cleared next time uvm32_run() is called */
+/*! Check to see if the external RAM is marked as dirty. If the VM code writes to the external RAM, or any other region, this flag is set. The flag is automatically cleared next time uvm32_run() is called */
 bool uvm32_extramDirty(uvm32_state_t *vmst);
 
+/*! Map `len` bytes of host memory at `ptr` into the VM at address `base`, with permissions `perm` (`UVM32_REGION_R`, `UVM32_REGION_W`, `UVM32_REGION_X` combined). The region must lie between `UVM32_EXTRAM_BASE` and `UVM32_MMIO_END` and must not overlap another region. VM accesses outside of any region, or without permission, are errors. The memory is not copied, so the caller must keep it available until the region is unmapped or the VM is ended. Returns the region number, or -1 if it could not be mapped. Up to `UVM32_MAX_REGIONS` may be mapped at once */
+int uvm32_mapRegion(uvm32_state_t *vmst, uint32_t base, uint8_t *ptr, uint32_t len, uint32_t perm);
+
+/*! Get the part of `region` written by VM code since the last call, as an offset and length from the start of the region, and clear it. Unlike uvm32_regionDirty() this accumulates over any number of calls to uvm32_run(), so a host can write back or copy only what changed. Returns false if nothing has been written */
+bool uvm32_regionDirtyRange(uvm32_state_t *vmst, int region, uint32_t *offset, uint32_t *len);
+
+/*! Track writes to `region` block by block in `bitmap`, which is supplied by the host and is not copied. Blocks are `1 << blockShift` bytes (eg. 12 for 4K pages) and `bitmap` must have `words` of 32 bits, enough for one bit per block. Use uvm32_regionNextDirty() to visit written blocks. Pass NULL to stop tracking. Returns false if the bitmap is too small */
+bool uvm32_regionTrackDirty(uvm32_state_t *vmst, int region, uint32_t *bitmap, uint32_t words, uint32_t blockShift);
+
+/*! Find the next run of consecutive blocks of `region` written by VM code, as an offset and length from the start of the region, and clear it. Call repeatedly to visit every run in address order, until it returns false. Without a bitmap from uvm32_regionTrackDirty(), the whole of uvm32_regionDirtyRange() is returned as one run */
+bool uvm32_regionNextDirty(uvm32_state_t *vmst, int region, uint32_t *offset, uint32_t *len);
+
+#ifdef UVM32_INTERRUPTS
+/*! Raise interrupt `irq`, 0 to UVM32_NUM_IRQS-1. If VM code has set a handler with UVM32_SYSCALL_IRQHANDLER and enabled the interrupt with UVM32_SYSCALL_IRQENABLE, the next uvm32_run() starts by calling the handler with a mask of the interrupts being taken. When the handler returns, the interrupted code resumes with all registers restored. Interrupts raised while the handler runs, or while disabled, stay pending. Returns false if `irq` is out of range */
+bool uvm32_interrupt(uvm32_state_t *vmst, uint32_t irq);
+#endif
+
+/*! Watch `len` bytes at VM address `addr`, in a mapped region or, when built with `UVM32_WATCH_RAM`, in RAM. When VM code stores to the range `callback` is called with the address and value, and the VM continues. If `callback` is NULL, uvm32_run() instead returns straight after the store with a `UVM32_EVT_WATCH` event. Returns the watch number, or -1 if it could not be added. Up to `UVM32_MAX_WATCHES` may be set at once, with 0 this always fails */
+int uvm32_watch(uvm32_state_t *vmst, uint32_t addr, uint32_t len, uvm32_watch_t callback, void *userdata);
+
+/*! Remove a watch added by uvm32_watch() */
+void uvm32_unwatch(uvm32_state_t *vmst, int watch);
+
+/*! Map `len` bytes of immutable host data at `ptr` into the VM at address `UVM32_ASSET_BASE`, read-only. VM code can find the length with `UVM32_SYSCALL_ASSETLEN`. The data is never written or marked dirty, so the same buffer (for example an mmap'd file) may be mapped into any number of VMs at once. The memory is not copied, so the caller must keep it available until the region is unmapped or the VM is ended. Returns the region number, or -1 if it could not be mapped */
+int uvm32_mapAsset(uvm32_state_t *vmst, const uint8_t *ptr, uint32_t len);
+
+/*! Remove a region mapped by uvm32_mapRegion() */
+void uvm32_unmapRegion(uvm32_state_t *vmst, int region);
+
+/*! Check to see if VM code has written to `region`. As with uvm32_extramDirty(), the flag is cleared next time uvm32_run() is called */
+bool uvm32_regionDirty(const uvm32_state_t *vmst, int region);
+
+#ifdef UVM32_EXT_CUSTOM
+/*! Register `handler` for the custom instruction major opcode custom-`n`, where `n` is 0-3. `userdata` is passed on each call. Executing a custom instruction with no handler registered is an error, as for any other illegal instruction. Pass NULL to remove a handler. Returns false if `n` is out of range. Only available with `UVM32_EXT_CUSTOM` */
+bool uvm32_setCustomOp(uvm32_state_t *vmst, uint32_t n, uvm32_custom_op_t handler, void *userdata);
+#endif
+
+/*! Set the clock read by the guest through the `time`/`timeh` CSRs (rdtime). With no clock set, reading `time` is an error. The `cycle` and `instret` CSRs need no setup, both count instructions retired */
+void uvm32_setClock(uvm32_state_t *vmst, uvm32_clock_t clock, void *userdata);
+
+/*! Use a virtual clock in place of the one set by uvm32_setClock(). It counts microseconds, worked out from the instructions retired at `rate` instructions per second, so VM code runs as fast as the host allows and sees the same times on every run. A timed UVM32_SYSCALL_WAIT ends on the next uvm32_run(), moving the clock on to its deadline. Pass 0 to go back to the host clock */
+void uvm32_setVirtualClock(uvm32_state_t *vmst, uint32_t rate);
+
+/*! Move the virtual clock on by `us` microseconds, as though VM code had been idle for that long. Does nothing without a virtual clock */
+void uvm32_skipClock(uvm32_state_t *vmst, uint64_t us);
+
+/*! Read the clock as VM code sees it through the `time` CSR, virtual or set by uvm32_setClock(), or 0 if there is none. Hosts should answer their own time syscalls, such as UVM32_SYSCALL_MILLIS, from this */
+uint64_t uvm32_getClock(const uvm32_state_t *vmst);
+
 /*! Get const pointer to raw memory, for debugging */
 const uint8_t *uvm32_getMemory(const uvm32_state_t *vmst);
 /*! Get program counter for, for debugging */